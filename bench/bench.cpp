@@ -0,0 +1,316 @@
+// micro-benchmarks of the grammar primitives, every case is generated with a
+// fixed seed so the table can be compared between commits. Hardware counters
+// are read with `perf_event_open` where it is allowed, otherwise only the
+// wall-clock time is shown.
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+
+#if defined(__linux__) && __has_include(<linux/perf_event.h>)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define S2UJSON_BENCH_PERF
+#endif
+
+namespace {
+
+struct Counters {
+  double nanoseconds = 0;
+  // negative if not available
+  double cycles = -1;
+  double instructions = -1;
+  double branches = -1;
+  double branch_misses = -1;
+};
+
+/**
+ * @brief a group of hardware counters, `available` is false if the kernel
+ * doesn't allow them
+ *
+ */
+class Perf_Group {
+ public:
+  Perf_Group() {
+#ifdef S2UJSON_BENCH_PERF
+    const std::uint64_t configs[4] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES};
+    for (int i = 0; i < 4; i++) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof(attr);
+      attr.config = configs[i];
+      attr.disabled = i == 0;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP;
+      fds[i] = static_cast<int>(
+          syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], 0));
+      if (fds[i] < 0) {
+        close_all();
+        return;
+      }
+    }
+    available = true;
+#endif
+  }
+  ~Perf_Group() { close_all(); }
+  Perf_Group(const Perf_Group &) = delete;
+  Perf_Group &operator=(const Perf_Group &) = delete;
+
+  inline void start() {
+#ifdef S2UJSON_BENCH_PERF
+    if (!available) return;
+    ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+  }
+  inline void stop(Counters &counters) {
+#ifdef S2UJSON_BENCH_PERF
+    if (!available) return;
+    ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    std::uint64_t values[5] = {};
+    if (read(fds[0], values, sizeof(values)) != sizeof(values)) return;
+    counters.cycles = static_cast<double>(values[1]);
+    counters.instructions = static_cast<double>(values[2]);
+    counters.branches = static_cast<double>(values[3]);
+    counters.branch_misses = static_cast<double>(values[4]);
+#else
+    (void)counters;
+#endif
+  }
+
+  bool available = false;
+
+ private:
+  inline void close_all() {
+#ifdef S2UJSON_BENCH_PERF
+    for (auto &fd : fds) {
+      if (fd >= 0) close(fd);
+      fd = -1;
+    }
+#endif
+  }
+  int fds[4] = {-1, -1, -1, -1};
+};
+
+// keep the compiler from removing the work
+template <typename T>
+inline void keep(const T &value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+struct Case {
+  const char *name;
+  std::string input;
+  // parse the whole input once
+  std::function<void(const std::string &)> run;
+};
+
+/**
+ * @brief run `item` a few times and keep the counters of the median run,
+ * which is steadier than the mean
+ *
+ */
+Counters measure(Perf_Group &perf, const Case &item) {
+  constexpr int runs = 9;
+  std::vector<Counters> results(runs);
+  item.run(item.input);  // warm up
+  for (auto &result : results) {
+    auto start = std::chrono::steady_clock::now();
+    perf.start();
+    item.run(item.input);
+    perf.stop(result);
+    result.nanoseconds = std::chrono::duration<double, std::nano>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  }
+  std::sort(results.begin(), results.end(),
+            [](const Counters &left, const Counters &right) {
+              return left.nanoseconds < right.nanoseconds;
+            });
+  return results[runs / 2];
+}
+
+// a list of `count` values made by `make`, with a space after each
+std::string repeat(std::size_t count,
+                   const std::function<std::string(std::mt19937 &)> &make) {
+  std::mt19937 random(20240607);
+  std::string result;
+  for (std::size_t i = 0; i < count; i++) {
+    result += make(random);
+    result.push_back(' ');
+  }
+  return result;
+}
+
+std::string random_digits(std::mt19937 &random, int length) {
+  std::string result(1, static_cast<char>('1' + random() % 9));
+  for (int i = 1; i < length; i++) {
+    result.push_back(static_cast<char>('0' + random() % 10));
+  }
+  return result;
+}
+
+// the primitives parse one value at the tokenizer, the space after it is
+// skipped
+template <typename Parse>
+std::function<void(const std::string &)> each(Parse parse) {
+  return [parse](const std::string &input) mutable {
+    _JSON_Tokenizer tokenizer(input.data(), input.data() + input.size());
+    while (tokenizer.peek() != '\0') {
+      keep(parse(tokenizer));
+      tokenizer.skip_space();
+    }
+  };
+}
+
+std::vector<Case> make_cases() {
+  constexpr std::size_t count = 1 << 16;
+  std::vector<Case> cases;
+  cases.push_back({"literal true",
+                   repeat(count, [](std::mt19937 &) { return "true"; }),
+                   each([](_JSON_Tokenizer &tokenizer) {
+                     return tokenizer.parse_true();
+                   })});
+  cases.push_back({"literal false",
+                   repeat(count, [](std::mt19937 &) { return "false"; }),
+                   each([](_JSON_Tokenizer &tokenizer) {
+                     return tokenizer.parse_false();
+                   })});
+  cases.push_back({"literal null",
+                   repeat(count, [](std::mt19937 &) { return "null"; }),
+                   each([](_JSON_Tokenizer &tokenizer) {
+                     return tokenizer.parse_null();
+                   })});
+  auto number = each([](_JSON_Tokenizer &tokenizer) {
+    return tokenizer.parse_double();
+  });
+  cases.push_back({"number int",
+                   repeat(count,
+                          [](std::mt19937 &random) {
+                            return random_digits(random, 1 + random() % 9);
+                          }),
+                   number});
+  cases.push_back({"number decimal",
+                   repeat(count,
+                          [](std::mt19937 &random) {
+                            return "-" + random_digits(random, 3) + "." +
+                                   random_digits(random, 6);
+                          }),
+                   number});
+  cases.push_back({"number exponent",
+                   repeat(count,
+                          [](std::mt19937 &random) {
+                            return random_digits(random, 1) + "." +
+                                   random_digits(random, 15) + "e-" +
+                                   std::to_string(random() % 300);
+                          }),
+                   number});
+  // the string is reused, like the tokenizer does for object keys
+  auto string = each([result = std::string()](
+                         _JSON_Tokenizer &tokenizer) mutable {
+    tokenizer.parse_string(result);
+    return result.size();
+  });
+  cases.push_back({"string ascii",
+                   repeat(count,
+                          [](std::mt19937 &random) {
+                            std::string result = "\"";
+                            for (int i = random() % 64; i >= 0; i--) {
+                              result.push_back(
+                                  static_cast<char>('a' + random() % 26));
+                            }
+                            return result + "\"";
+                          }),
+                   string});
+  cases.push_back({"string escapes",
+                   repeat(count,
+                          [](std::mt19937 &random) {
+                            const char *escapes[] = {"\\n", "\\t", "\\\"",
+                                                     "\\\\", "\\/", "ab"};
+                            std::string result = "\"";
+                            for (int i = random() % 16; i >= 0; i--) {
+                              result += escapes[random() % 6];
+                            }
+                            return result + "\"";
+                          }),
+                   string});
+  cases.push_back({"string surrogates",
+                   repeat(count,
+                          [](std::mt19937 &random) {
+                            std::string result = "\"";
+                            for (int i = random() % 8; i >= 0; i--) {
+                              result += "\\ud83d\\ude00\\u00e9";
+                            }
+                            return result + "\"";
+                          }),
+                   string});
+  // nested 512 deep, far from any depth limit
+  std::string arrays;
+  std::string objects;
+  for (int i = 0; i < 512; i++) {
+    arrays += "[1,";
+    objects += "{\"k\":";
+  }
+  arrays += "1";
+  objects += "1";
+  for (int i = 0; i < 512; i++) {
+    arrays += "]";
+    objects += "}";
+  }
+  auto parse = [](const std::string &input) {
+    for (int i = 0; i < 64; i++) keep(s2ujson::JSON_parse(input));
+  };
+  cases.push_back({"nesting array", arrays, parse});
+  cases.push_back({"nesting object", objects, parse});
+  return cases;
+}
+
+void print_counter(double value, double bytes) {
+  if (value < 0) {
+    std::printf(" %9s", "-");
+  } else {
+    std::printf(" %9.3f", value / bytes);
+  }
+}
+
+}  // namespace
+
+int main() {
+  Perf_Group perf;
+  std::printf("%-18s %9s %9s %9s %9s %9s %9s\n", "case", "bytes", "MB/s",
+              "ns/B", "cycles/B", "instr/B", "miss%");
+  for (auto &item : make_cases()) {
+    Counters result = measure(perf, item);
+    // the nesting cases parse their input many times
+    double bytes = static_cast<double>(item.input.size()) *
+                   (std::strncmp(item.name, "nesting", 7) == 0 ? 64 : 1);
+    std::printf("%-18s %9zu %9.1f", item.name, item.input.size(),
+                bytes / result.nanoseconds * 1000);
+    print_counter(result.nanoseconds, bytes);
+    print_counter(result.cycles, bytes);
+    print_counter(result.instructions, bytes);
+    if (result.branches > 0) {
+      std::printf(" %9.3f\n", result.branch_misses / result.branches * 100);
+    } else {
+      std::printf(" %9s\n", "-");
+    }
+  }
+  if (!perf.available) {
+    std::printf("hardware counters are not available, wall clock only\n");
+  }
+  return 0;
+}
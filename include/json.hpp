@@ -11,1134 +11,7933 @@
 
 #ifndef _JSON_HPP_
 #define _JSON_HPP_
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <exception>
+#include <functional>
 #include <initializer_list>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <map>
 #include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
 #include <utility>
 #include <variant>
 #include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if __has_include(<sys/uio.h>)
+#include <sys/uio.h>
+#define S2UJSON_HAS_WRITEV
+#endif
+#if __has_include(<sys/mman.h>) && __has_include(<fcntl.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define S2UJSON_HAS_MMAP
+#endif
 
-namespace s2ujson {
-
-// forward declaration
-class JSON_Object;
-
+// string helper
 /**
- * @brief used to represent all the data type in JSON
+ * @brief count how many bytes from `begin` can be copied as they are inside a
+ * JSON string, which means they are not `"`, `\` or control chars. Non-ASCII
+ * bytes also stop the count if `stop_at_non_ascii` is set
  *
+ * @param begin
+ * @param end
+ * @param stop_at_non_ascii
+ * @return std::size_t
  */
-enum class value_t { NULL_DATA, TRUE, FALSE, NUMBER, STRING, ARRAY, OBJECT };
+inline static std::size_t _JSON_simd_plain_length(
+    const char *begin, const char *end, bool stop_at_non_ascii = true) {
+  const char *iter = begin;
+#if defined(__SSE2__)
+  const __m128i quote = _mm_set1_epi8('\"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i space = _mm_set1_epi8(0x20);
+  const __m128i control_max = _mm_set1_epi8(0x1F);
+  const __m128i zero = _mm_setzero_si128();
+  for (; end - iter >= 16; iter += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(iter));
+    __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                   _mm_cmpeq_epi8(chunk, backslash));
+    if (stop_at_non_ascii) {
+      // signed compare, so bytes >= 0x80 are also "less than" 0x20
+      special = _mm_or_si128(special, _mm_cmplt_epi8(chunk, space));
+    } else {
+      // unsigned `chunk <= 0x1F`
+      special = _mm_or_si128(
+          special, _mm_cmpeq_epi8(_mm_subs_epu8(chunk, control_max), zero));
+    }
+    int mask = _mm_movemask_epi8(special);
+    if (mask != 0) return (iter - begin) + __builtin_ctz(mask);
+  }
+#endif
+  for (; iter != end; iter++) {
+    unsigned char ch = static_cast<unsigned char>(*iter);
+    if (ch == '\"' || ch == '\\' || ch < 0x20 ||
+        (stop_at_non_ascii && ch >= 0x80)) {
+      break;
+    }
+  }
+  return iter - begin;
+}
 
 /**
- * @brief The class which holds all the data, include 'Object'.
- * @details Is basically a wrapper of 'std::variant'. All the 'exceptions' that
- * threw by 'std::variant' need you to handle, if you do something incorrectly
+ * @brief length of the well-formed UTF-8 sequence at `begin`, or 0 if it is
+ * malformed (overlong, surrogate, above U+10FFFF or truncated)
  *
+ * @param begin
+ * @param end
+ * @return int
  */
-class JSON_Data {
-  // use to achieve initialization of array by using initializer_list
-  using var = std::variant<std::nullptr_t, bool, double, int, std::string>;
-
- public:
-  // All the Constructors
-  constexpr JSON_Data() { set(nullptr); }
-  constexpr explicit JSON_Data(const bool d_bool) { set(d_bool); }
-  constexpr JSON_Data(const double d_number) { set(d_number); }
-  constexpr JSON_Data(const int d_number) { set(d_number); }
-  constexpr JSON_Data(const std::string &d_string) { set(d_string); }
-  constexpr JSON_Data(const char *ptr) { set(std::string(ptr)); }
-  constexpr JSON_Data(const std::vector<JSON_Data> &d_array) { set(d_array); }
-  constexpr JSON_Data(const JSON_Object &d_object) { set(d_object); }
-  constexpr JSON_Data(const std::nullptr_t n_ptr) { set(n_ptr); };
-  constexpr JSON_Data(std::initializer_list<var> list) { operator=(list); }
-  constexpr JSON_Data(
-      std::initializer_list<std::pair<std::string, JSON_Data>> list) {
-    operator=(list);
+inline static int _JSON_utf8_sequence_length(const unsigned char *begin,
+                                             const unsigned char *end) {
+  unsigned char lead = begin[0];
+  int length;
+  unsigned char low = 0x80, high = 0xBF;
+  if (lead < 0x80) {
+    return 1;
+  } else if (lead >= 0xC2 && lead <= 0xDF) {
+    length = 2;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    length = 3;
+    if (lead == 0xE0) low = 0xA0;
+    if (lead == 0xED) high = 0x9F;
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    length = 4;
+    if (lead == 0xF0) low = 0x90;
+    if (lead == 0xF4) high = 0x8F;
+  } else {
+    return 0;
   }
-
-  // All the getter
-  inline std::nullptr_t &get_null() { return std::get<std::nullptr_t>(data); }
-  inline bool &get_bool() { return std::get<bool>(data); }
-  inline double &get_double() {
-    if (std::holds_alternative<int>(data)) {
-      set(static_cast<double>(std::get<int>(data)));
-    }
-    return std::get<double>(data);
+  if (end - begin < length) return 0;
+  if (begin[1] < low || begin[1] > high) return 0;
+  for (int i = 2; i < length; i++) {
+    if (begin[i] < 0x80 || begin[i] > 0xBF) return 0;
   }
-  inline int &get_int() {
-    if (std::holds_alternative<double>(data)) {
-      set(static_cast<int>(std::get<double>(data)));
+  return length;
+}
+
+/**
+ * @brief append `str` to `output` as a quoted and escaped JSON string.
+ * @details runs without anything to escape are found by
+ * `_JSON_simd_plain_length` and copied as a block. If `escape_unicode` is set,
+ * non-ASCII chars are written as `\uXXXX` (with surrogate pairs), which needs
+ * `str` to be valid UTF-8.
+ *
+ * @param output
+ * @param str
+ * @param escape_unicode
+ */
+inline static void _JSON_escape_string(std::string &output,
+                                       std::string_view str,
+                                       bool escape_unicode = false) {
+  static const char hex_digits[] = "0123456789ABCDEF";
+  auto write_u = [&](unsigned int hex) {
+    char buffer[6] = {'\\',
+                      'u',
+                      hex_digits[(hex >> 12) & 0xF],
+                      hex_digits[(hex >> 8) & 0xF],
+                      hex_digits[(hex >> 4) & 0xF],
+                      hex_digits[hex & 0xF]};
+    output.append(buffer, 6);
+  };
+  const char *iter = str.data();
+  const char *end = iter + str.size();
+  output.push_back('\"');
+  while (true) {
+    std::size_t plain = _JSON_simd_plain_length(iter, end, escape_unicode);
+    output.append(iter, plain);
+    iter += plain;
+    if (iter == end) break;
+    unsigned char ch = static_cast<unsigned char>(*iter);
+    switch (ch) {
+      case '\"':
+        output.append("\\\"", 2);
+        break;
+      case '\\':
+        output.append("\\\\", 2);
+        break;
+      case '\b':
+        output.append("\\b", 2);
+        break;
+      case '\f':
+        output.append("\\f", 2);
+        break;
+      case '\n':
+        output.append("\\n", 2);
+        break;
+      case '\r':
+        output.append("\\r", 2);
+        break;
+      case '\t':
+        output.append("\\t", 2);
+        break;
+      default:
+        if (ch < 0x20) {
+          write_u(ch);
+          break;
+        }
+        {
+          int length = _JSON_utf8_sequence_length(
+              reinterpret_cast<const unsigned char *>(iter),
+              reinterpret_cast<const unsigned char *>(end));
+          if (length == 0) throw std::invalid_argument("invalid UTF-8");
+          unsigned int code = ch & (0x7F >> length);
+          for (int i = 1; i < length; i++) {
+            code = (code << 6) | (static_cast<unsigned char>(iter[i]) & 0x3F);
+          }
+          if (code >= 0x10000) {
+            code -= 0x10000;
+            write_u(0xD800 + (code >> 10));
+            write_u(0xDC00 + (code & 0x3FF));
+          } else {
+            write_u(code);
+          }
+          iter += length;
+          continue;
+        }
     }
-    return std::get<int>(data);
-  }
-  inline std::string &get_string() { return std::get<std::string>(data); }
-  inline std::vector<JSON_Data> &get_array() {
-    return std::get<std::vector<JSON_Data>>(data);
-  }
-  inline JSON_Object &get_object() {
-    return *std::get<std::shared_ptr<JSON_Object>>(data);
+    iter++;
   }
+  output.push_back('\"');
+}
 
-  // All the type check
-  inline const value_t &get_type() { return type; };
-  inline bool is_null() const { return type == value_t::NULL_DATA; }
-  inline bool is_boolean() const {
-    return (type == value_t::TRUE || type == value_t::FALSE);
+// hash helper
+inline static std::uint64_t _JSON_hash_mix(std::uint64_t x) {
+  // the finalizer of splitmix64
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ULL;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBULL;
+  x ^= x >> 31;
+  return x;
+}
+inline static std::uint64_t _JSON_hash_combine(std::uint64_t seed,
+                                               std::uint64_t value) {
+  return _JSON_hash_mix(seed ^ (value + 0x9E3779B97F4A7C15ULL + (seed << 6) +
+                                (seed >> 2)));
+}
+inline static std::uint64_t _JSON_hash_bytes(std::uint64_t seed,
+                                             std::string_view bytes) {
+  const char *iter = bytes.data();
+  std::size_t size = bytes.size();
+  for (; size >= 8; iter += 8, size -= 8) {
+    std::uint64_t chunk;
+    std::memcpy(&chunk, iter, 8);
+    seed = _JSON_hash_combine(seed, chunk);
   }
-  inline bool is_number() const { return type == value_t::NUMBER; }
-  inline bool is_string() const { return type == value_t::STRING; }
-  inline bool is_array() const { return type == value_t::ARRAY; }
-  inline bool is_object() const { return type == value_t::OBJECT; }
+  std::uint64_t tail = 0;
+  std::memcpy(&tail, iter, size);
+  return _JSON_hash_combine(seed, tail ^ (std::uint64_t(bytes.size()) << 56));
+}
 
-  // All the setter
-  inline void set(const std::nullptr_t) {
-    type = value_t::NULL_DATA;
-    data = nullptr;
-  }
-  inline void set(bool d_bool) {
-    if (d_bool) {
-      type = value_t::TRUE;
-    } else {
-      type = value_t::FALSE;
-    }
-    data = d_bool;
-  }
-  inline void set(double d_number) {
-    type = value_t::NUMBER;
-    data = d_number;
-  }
-  inline void set(int d_number) {
-    type = value_t::NUMBER;
-    data = d_number;
+#if defined(S2UJSON_CACHED_HASH) || defined(S2UJSON_CACHED_DUMP)
+#ifdef S2UJSON_CACHED_DUMP
+// the shortest text of an array or object which is cached, shorter ones are
+// written again as fast as they are copied
+#ifndef S2UJSON_CACHED_DUMP_MIN_SIZE
+#define S2UJSON_CACHED_DUMP_MIN_SIZE 128
+#endif
+#endif
+
+/**
+ * @brief the caches of an array or object: its hash and the JSON text from
+ * its last `dump`. They are used while `version` is the one they were made
+ * at. A change to the array or object, or to a node under it, increases the
+ * version of its block and of the blocks of its parents, see
+ * `_JSON_cache_changed`.
+ * @details the blocks are counted references: the array or object owns one,
+ * and each child and the block of each child array or object points to the
+ * block of its parent, so a child outliving its parent points to a block
+ * which is still there. The parent pointers are set by readers, which can
+ * run at the same time, so they are atomic, as is the rest which readers
+ * fill. The text is only set once it is complete and is not changed after,
+ * it is swapped with the atomic functions of `std::shared_ptr`. Copies of a
+ * node start without a block, and it is not counted by `memory_usage`.
+ *
+ */
+struct _JSON_Cache_Block {
+  struct text {
+    std::string bytes;
+    bool escape_unicode;
+    std::uint64_t version;
+  };
+
+  std::atomic<std::size_t> references{1};
+  std::atomic<std::uint64_t> version{1};
+  // changed since the last hash or dump, which told the parents already
+  std::atomic<bool> dirty{false};
+  // a node under it, or the node itself, was handed out or shared at the last
+  // hash or dump, so the parents keep no cache over it
+  std::atomic<bool> tainted{false};
+  std::atomic<_JSON_Cache_Block *> parent{nullptr};
+#ifdef S2UJSON_CACHED_HASH
+  // the hash made at `hash_version`
+  std::atomic<std::uint64_t> hash{0};
+  std::atomic<std::uint64_t> hash_version{0};
+#endif
+#ifdef S2UJSON_CACHED_DUMP
+  std::shared_ptr<const text> dump;
+#endif
+};
+
+inline void _JSON_cache_release(_JSON_Cache_Block *block) noexcept {
+  while (block != nullptr &&
+         block->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    _JSON_Cache_Block *parent = block->parent.load(std::memory_order_relaxed);
+    delete block;
+    block = parent;
   }
-  inline void set(const std::string &d_string) {
-    type = value_t::STRING;
-    data = d_string;
+}
+// point `link` at `block`
+inline void _JSON_cache_link(std::atomic<_JSON_Cache_Block *> &link,
+                             _JSON_Cache_Block *block) {
+  _JSON_Cache_Block *old = link.load(std::memory_order_acquire);
+  if (old == block) return;
+  if (block != nullptr) {
+    block->references.fetch_add(1, std::memory_order_relaxed);
   }
-  inline void set(const std::vector<JSON_Data> &d_array) {
-    type = value_t::ARRAY;
-    data = d_array;
+  if (link.compare_exchange_strong(old, block, std::memory_order_acq_rel)) {
+    _JSON_cache_release(old);
+  } else {
+    _JSON_cache_release(block);
   }
-  inline void set(const JSON_Object &d_object) {
-    type = value_t::OBJECT;
-    data = std::make_shared<JSON_Object>(d_object);
+}
+// point `link` at `block` if it points nowhere, true if it points at `block`
+inline bool _JSON_cache_claim(std::atomic<_JSON_Cache_Block *> &link,
+                              _JSON_Cache_Block *block) {
+  _JSON_Cache_Block *old = nullptr;
+  block->references.fetch_add(1, std::memory_order_relaxed);
+  if (link.compare_exchange_strong(old, block, std::memory_order_acq_rel)) {
+    return true;
   }
-
-  /**
-   * @brief a special setter which used to provied usage like `data.get<bool>()`
-   *
-   * @tparam T
-   * @return const T&
-   */
-  template <typename T>
-  inline const T &get() {
-    return std::get<T>(data);
+  _JSON_cache_release(block);
+  return old == block;
+}
+/**
+ * @brief a change under `block`, which drops its caches and those of its
+ * parents. The walk up stops at a dirty block, its parents were told by the
+ * change which made it dirty, and no cache was made over it since.
+ *
+ * @param block
+ */
+inline void _JSON_cache_changed(_JSON_Cache_Block *block) noexcept {
+  while (block != nullptr) {
+    block->version.fetch_add(1, std::memory_order_relaxed);
+    if (block->dirty.exchange(true, std::memory_order_relaxed)) return;
+    block = block->parent.load(std::memory_order_relaxed);
   }
+}
 
-  // All overloaded `=` to do `object["key"] = something` or `object["key"] =
-  // {{"name", "val"}}` or `object["key"] = {1, "good", false, nullptr}`
-  inline JSON_Data &operator=(std::nullptr_t) {
-    set(nullptr);
-    return *this;
-  }
-  inline JSON_Data &operator=(const bool d_bool) {
-    set(d_bool);
+/**
+ * @brief the cache links of a node: `parent` is the block of the array or
+ * object holding it, `block` is its own, for an array or object. A change to
+ * the node is told to both, so a reference to the node kept from before a
+ * `dump`, or another handle to a shared `JSON_Object`, still drops the
+ * caches over it, and only those. A node is `exposed` once it handed out a
+ * non-const reference to its value, which can change it without the node
+ * knowing. No cache is kept over an exposed node until it gets a new value,
+ * which ends the references handed out before.
+ *
+ */
+class _JSON_Cache_Node {
+ public:
+  _JSON_Cache_Node() = default;
+  // a copy is a new node, which is in no container
+  _JSON_Cache_Node(const _JSON_Cache_Node &) {}
+  // the node moved from is emptied, the block goes with the value
+  _JSON_Cache_Node(_JSON_Cache_Node &&other) noexcept
+      : block(other.take()) {}
+  _JSON_Cache_Node &operator=(const _JSON_Cache_Node &) {
+    changed();
+    exposed = false;
     return *this;
   }
-  inline JSON_Data &operator=(const double d_number) {
-    set(d_number);
+  _JSON_Cache_Node &operator=(_JSON_Cache_Node &&other) noexcept {
+    if (this == &other) return *this;
+    changed();
+    _JSON_cache_release(block.exchange(other.take()));
+    exposed = false;
     return *this;
   }
-  inline JSON_Data &operator=(const int d_number) {
-    set(d_number);
-    return *this;
+  ~_JSON_Cache_Node() {
+    _JSON_cache_changed(parent.load(std::memory_order_relaxed));
+    _JSON_cache_release(parent.load(std::memory_order_relaxed));
+    _JSON_cache_release(block.load(std::memory_order_relaxed));
   }
-  inline JSON_Data &operator=(const std::string &d_string) {
-    set(d_string);
-    return *this;
+
+  inline void changed() noexcept {
+    _JSON_cache_changed(block.load(std::memory_order_relaxed));
+    _JSON_cache_changed(parent.load(std::memory_order_relaxed));
   }
-  inline JSON_Data &operator=(const std::string &&d_string) {
-    return operator=(d_string);
+  // the own block, made on the first hash or dump
+  inline _JSON_Cache_Block &own() const {
+    _JSON_Cache_Block *current = block.load(std::memory_order_acquire);
+    if (current != nullptr) return *current;
+    auto *made = new _JSON_Cache_Block();
+    if (block.compare_exchange_strong(current, made,
+                                      std::memory_order_acq_rel)) {
+      return *made;
+    }
+    delete made;
+    return *current;
   }
-  inline JSON_Data &operator=(const char *ptr) {
-    return operator=(std::string(ptr));
+
+  mutable std::atomic<_JSON_Cache_Block *> parent{nullptr};
+  mutable std::atomic<_JSON_Cache_Block *> block{nullptr};
+  bool exposed = false;
+
+ private:
+  // the block of a value moved out, whose old parent is told of it
+  inline _JSON_Cache_Block *take() noexcept {
+    _JSON_cache_changed(parent.load(std::memory_order_relaxed));
+    _JSON_Cache_Block *taken = block.exchange(nullptr);
+    if (taken != nullptr) {
+      _JSON_Cache_Block *old = taken->parent.exchange(nullptr);
+      _JSON_cache_changed(old);
+      _JSON_cache_release(old);
+    }
+    return taken;
   }
-  inline JSON_Data &operator=(const std::vector<JSON_Data> &d_array) {
-    set(d_array);
-    return *this;
+};
+
+/**
+ * @brief the hashing or dumping of an array or object whose cache can't be
+ * used. Its children are linked to its block as they are read, and what is
+ * made is kept only if none of them is tainted.
+ *
+ */
+class _JSON_Cache_Pass {
+ public:
+  _JSON_Cache_Pass(_JSON_Cache_Block &block, bool clean)
+      : block(block), clean(clean) {
+    block.dirty.store(false, std::memory_order_relaxed);
+    version = block.version.load(std::memory_order_relaxed);
   }
-  inline JSON_Data &operator=(const std::vector<JSON_Data> &&d_array) {
-    return operator=(d_array);
+  ~_JSON_Cache_Pass() {
+    block.tainted.store(!clean, std::memory_order_relaxed);
   }
-  inline JSON_Data &operator=(const JSON_Object &d_object) {
-    set(d_object);
-    return *this;
+  _JSON_Cache_Pass(const _JSON_Cache_Pass &) = delete;
+  _JSON_Cache_Pass &operator=(const _JSON_Cache_Pass &) = delete;
+
+#ifdef S2UJSON_CACHED_HASH
+  inline void keep_hash(std::uint64_t hash) const {
+    if (!clean) return;
+    block.hash.store(hash, std::memory_order_relaxed);
+    block.hash_version.store(version, std::memory_order_release);
   }
-  inline JSON_Data &operator=(const JSON_Object &&d_object) {
-    return operator=(d_object);
+#endif
+#ifdef S2UJSON_CACHED_DUMP
+  // keep what was written to `output` from `begin`, unless there is a text
+  // of this version for the other `escape_unicode`
+  inline void keep_text(const std::string &output, std::size_t begin,
+                        bool escape_unicode) const {
+    if (!clean || output.size() - begin < S2UJSON_CACHED_DUMP_MIN_SIZE) return;
+    auto cached =
+        std::atomic_load_explicit(&block.dump, std::memory_order_acquire);
+    if (cached != nullptr && cached->version == version) return;
+    cached = std::make_shared<_JSON_Cache_Block::text>(
+        _JSON_Cache_Block::text{output.substr(begin), escape_unicode,
+                                version});
+    std::atomic_store_explicit(&block.dump, std::move(cached),
+                               std::memory_order_release);
   }
-  JSON_Data &operator=(
-      std::initializer_list<std::pair<std::string, JSON_Data>> list);
-  JSON_Data &operator=(std::initializer_list<var> list);
-
-  // All overloaded `[]` to do `object["key1"]["key2"] = something"
-  JSON_Data &operator[](std::string &&key);
-  JSON_Data &operator[](std::string &key);
-
-  /**
-   * @brief output the JSON string of this data
-   * @return std::string
-   */
-  std::string to_string();
+#endif
 
- private:
-  /**
-   * @brief output array style JSON string for array
-   *
-   * @return std::string
-   */
-  std::string array_to_string();
-  /**
-   * @brief get the data out of var
-   *
-   * @param d_var
-   * @return JSON_Data
-   */
-  JSON_Data convert(var d_var);
+  _JSON_Cache_Block &block;
+  bool clean;
 
  private:
-  std::variant<std::nullptr_t, bool, double, int, std::string,
-               std::vector<JSON_Data>, std::shared_ptr<JSON_Object>>
-      data;
-  value_t type = value_t::NULL_DATA;
+  std::uint64_t version;
 };
-template <>
-inline const int &JSON_Data::get<int>() {
-  if (std::holds_alternative<double>(data)) {
-    set(static_cast<int>(std::get<double>(data)));
+
+#ifdef S2UJSON_CACHED_HASH
+// the cached hash of `block`, 0 if there is none
+inline std::uint64_t _JSON_cache_hash(const _JSON_Cache_Block &block) {
+  if (block.hash_version.load(std::memory_order_acquire) !=
+      block.version.load(std::memory_order_relaxed)) {
+    return 0;
   }
-  return std::get<int>(data);
+  return block.hash.load(std::memory_order_relaxed);
 }
-template <>
-inline const double &JSON_Data::get<double>() {
-  if (std::holds_alternative<int>(data)) {
-    set(static_cast<double>(std::get<int>(data)));
+#endif
+#ifdef S2UJSON_CACHED_DUMP
+// append the cached text of `block` to `output`, if there is one
+inline bool _JSON_cache_append(const _JSON_Cache_Block &block,
+                               std::string &output, bool escape_unicode) {
+  auto cached =
+      std::atomic_load_explicit(&block.dump, std::memory_order_acquire);
+  if (cached == nullptr || cached->escape_unicode != escape_unicode ||
+      cached->version != block.version.load(std::memory_order_relaxed)) {
+    return false;
   }
-  return std::get<double>(data);
+  output.append(cached->bytes);
+  return true;
 }
-}  // namespace s2ujson
+#endif
+#endif
+
+// forward declaration
+class _JSON_Patch;
+class _JSON_Parse_Pool;
 
 /**
- * @brief a working `data structure` to let the user can read the data in the
- * order they added
- * @deprecated working in progress
+ * @brief truncate `number` to `T`, which is `std::int64_t` or
+ * `std::uint64_t`, `std::out_of_range` is thrown if it doesn't fit
+ *
+ * @tparam T
+ * @param number
+ * @return T
  */
-// class JSON_Object_Storage {
-//  public:
-//   explicit JSON_Object_Storage() = default;
-//   inline void insert(const std::string &key, JSON_Data &data) {
-//     key_to_pos.insert(std::make_pair(key, key_to_pos.size()));
-//     if (real_data.size() >= key_to_pos.size()) {
-//       real_data[key_to_pos.size() - 1] = data;
-//     } else {
-//       real_data.push_back(data);
-//     }
-//   }
-//   inline void insert(const std::string &key, JSON_Data &&data) {
-//     insert(key, data);
-//   }
-
-//   inline JSON_Data &find(const std::string &key) {
-//     return real_data[key_to_pos.find(key)->second];
-//   }
-
-//   inline JSON_Data &find(const int pos) { return real_data[pos]; }
+template <typename T>
+inline static T _JSON_double_to_integer(double number) {
+  // 2^63 and 2^64 are exact as double, the max values are not
+  bool in_range = std::is_signed_v<T>
+                      ? number >= -9223372036854775808.0 &&
+                            number < 9223372036854775808.0
+                      : number > -1.0 && number < 18446744073709551616.0;
+  if (!in_range) {
+    throw std::out_of_range("number is out of range");
+  }
+  return static_cast<T>(number);
+}
 
-//   inline bool is_key_invalid(const std::string &key) {
-//     return key_to_pos.find(key) == key_to_pos.end();
-//   }
+// the result of `get<T>() const`, numbers are converted on return so they are
+// returned by value
+template <typename T>
+struct _JSON_const_get {
+  using type = const T &;
+};
+template <>
+struct _JSON_const_get<int> {
+  using type = int;
+};
+template <>
+struct _JSON_const_get<double> {
+  using type = double;
+};
+template <>
+struct _JSON_const_get<std::int64_t> {
+  using type = std::int64_t;
+};
+template <>
+struct _JSON_const_get<std::uint64_t> {
+  using type = std::uint64_t;
+};
 
-//   std::vector<std::pair<std::string, JSON_Data>> get_Storage_In_Order() {
-//     std::vector<std::pair<std::string, JSON_Data>> result(key_to_pos.size());
-//     for (auto i : key_to_pos) {
-//       result[i.second] = std::make_pair(i.first, real_data[i.second]);
-//     }
-//     return result;
-//   }
+// the result of `try_get<T>()`, the scalars are converted so they are returned
+// as `std::optional`, the others are pointed to
+template <typename T>
+struct _JSON_try_get {
+  using type = const T *;
+};
+template <>
+struct _JSON_try_get<std::nullptr_t> {
+  using type = std::optional<std::nullptr_t>;
+};
+template <>
+struct _JSON_try_get<bool> {
+  using type = std::optional<bool>;
+};
+template <>
+struct _JSON_try_get<int> {
+  using type = std::optional<int>;
+};
+template <>
+struct _JSON_try_get<double> {
+  using type = std::optional<double>;
+};
+template <>
+struct _JSON_try_get<std::int64_t> {
+  using type = std::optional<std::int64_t>;
+};
+template <>
+struct _JSON_try_get<std::uint64_t> {
+  using type = std::optional<std::uint64_t>;
+};
 
-//  private:
-//   std::map<std::string, int> key_to_pos;
-//   std::vector<JSON_Data> real_data;
-// };
 namespace s2ujson {
-class JSON_Object {
- public:
-  using iterator = std::map<std::string, JSON_Data>::iterator;
-  using const_iterator = std::map<std::string, JSON_Data>::const_iterator;
-  using reverse_iterator = std::map<std::string, JSON_Data>::reverse_iterator;
-  using const_reverse_iterator =
-      std::map<std::string, JSON_Data>::const_reverse_iterator;
 
+// forward declaration
+class JSON_Object;
+class JSON_Data;
+
+/**
+ * @brief used to represent all the data type in JSON
+ *
+ */
+enum class value_t { NULL_DATA, TRUE, FALSE, NUMBER, STRING, ARRAY, OBJECT };
+
+/**
+ * @brief a number kept as the text it was parsed from. It is only converted
+ * when it is read, so integers keep their exact value whatever their size, and
+ * the text is written back as it was.
+ *
+ */
+class JSON_Number {
  public:
-  // All Constructor
-  explicit JSON_Object() = default;
-  JSON_Object(std::initializer_list<std::pair<std::string, JSON_Data>> list);
+  JSON_Number() = default;
+  explicit JSON_Number(std::string_view raw) : raw(raw) {}
 
-  // All add
-  inline void add(const std::string &key) {
-    object.insert(std::make_pair(key, JSON_Data()));
+  inline const std::string &get_raw() const { return raw; }
+  // if the text has no fraction or exponent
+  inline bool is_integer() const {
+    return raw.find_first_of(".eE") == std::string::npos;
   }
-  // inline void add(const std::string &&key) { add(key); }
-  inline void add(const std::string &key, std::nullptr_t) {
-    object.insert(std::make_pair(key, JSON_Data()));
+
+  /**
+   * @brief convert to `double`
+   * @details `std::out_of_range` is thrown if it is out of the range of
+   * `double`
+   *
+   * @return double
+   */
+  inline double to_double() const {
+    double result = 0;
+    auto [end, error] =
+        std::from_chars(raw.data(), raw.data() + raw.size(), result);
+    if (error == std::errc::result_out_of_range) {
+      throw std::out_of_range("number is out of range");
+    }
+    if (error != std::errc() || end != raw.data() + raw.size()) {
+      throw std::invalid_argument("number is not correct");
+    }
+    return result;
   }
-  // inline void add(const std::string &&key, std::nullptr_t) {
-  //   add(key, nullptr);
-  // }
-  inline void add(const std::string &key, const bool d_bool) {
-    object.insert(std::make_pair(key, JSON_Data(d_bool)));
+  /**
+   * @brief convert to `T`, which is `std::int64_t` or `std::uint64_t`. It is
+   * exact for integers, anything else is converted through `double` and
+   * truncated. `std::out_of_range` is thrown if it doesn't fit in `T`
+   *
+   * @tparam T
+   * @return T
+   */
+  template <typename T>
+  inline T to_integer() const {
+    const char *begin = raw.data(), *end = raw.data() + raw.size();
+    if (is_integer()) {
+      if (std::is_unsigned_v<T> && raw == "-0") return 0;
+      T result = 0;
+      auto [last, error] = std::from_chars(begin, end, result);
+      if (error == std::errc() && last == end) return result;
+      // from_chars doesn't take a minus sign for unsigned types
+      if (error == std::errc::result_out_of_range ||
+          (std::is_unsigned_v<T> && raw[0] == '-')) {
+        throw std::out_of_range("number is out of range");
+      }
+      throw std::invalid_argument("number is not correct");
+    }
+    return _JSON_double_to_integer<T>(to_double());
   }
-  // inline void add(const std::string &&key, const bool d_bool) {
-  //   add(key, d_bool);
-  // }
-  inline void add(const std::string &key, const int d_number) {
-    object.insert(std::make_pair(key, JSON_Data(d_number)));
+  inline std::int64_t to_int64() const { return to_integer<std::int64_t>(); }
+  inline std::uint64_t to_uint64() const {
+    return to_integer<std::uint64_t>();
   }
-  inline void add(const std::string &key, const double d_number) {
-    object.insert(std::make_pair(key, JSON_Data(d_number)));
+  inline void shrink_to_fit() { raw.shrink_to_fit(); }
+
+ private:
+  std::string raw;
+};
+
+/**
+ * @brief a read-only view of `size()` contiguous values of `T`, like the
+ * `std::span` of C++20
+ *
+ */
+template <typename T>
+class JSON_Span {
+ public:
+  JSON_Span() = default;
+  JSON_Span(const T *data, std::size_t size) : pointer(data), length(size) {}
+
+  inline const T *data() const { return pointer; }
+  inline std::size_t size() const { return length; }
+  inline bool empty() const { return length == 0; }
+  inline const T *begin() const { return pointer; }
+  inline const T *end() const { return pointer + length; }
+  inline const T &operator[](std::size_t index) const {
+    return pointer[index];
   }
-  // inline void add(const std::string &&key, const double d_number) {
-  //   add(key, d_number);
-  // }
-  inline void add(const std::string &key, const std::string &d_string) {
-    object.insert(std::make_pair(key, JSON_Data(d_string)));
+
+ private:
+  const T *pointer = nullptr;
+  std::size_t length = 0;
+};
+
+/**
+ * @brief an array whose values are all `double` or all `std::int64_t`, kept
+ * in one contiguous buffer instead of a `JSON_Data` for each number.
+ * @details it is never changed, so copies of a `JSON_Data` share it. Getting
+ * the array of a `JSON_Data` by a non-const reference turns it into a plain
+ * array first. There is no `std::vector<JSON_Data>` of the values, so
+ * `get_array() const` throws `std::bad_variant_access` for it. Comparing,
+ * hashing, diffing, validating, dumping and `find_pointer` read the values
+ * one at a time, and so can `JSON_Data::array_size` and `JSON_Data::element`.
+ *
+ */
+class JSON_Packed_Array {
+ public:
+  explicit JSON_Packed_Array(std::vector<double> numbers)
+      : numbers(std::move(numbers)) {}
+  explicit JSON_Packed_Array(std::vector<std::int64_t> numbers)
+      : numbers(std::move(numbers)) {}
+  JSON_Packed_Array(const JSON_Packed_Array &) = default;
+  JSON_Packed_Array(JSON_Packed_Array &&) noexcept = default;
+  JSON_Packed_Array &operator=(const JSON_Packed_Array &) = delete;
+
+  // if the values are `std::int64_t`
+  inline bool is_integer() const { return numbers.index() == 1; }
+  inline std::size_t size() const {
+    return is_integer() ? std::get<1>(numbers).size()
+                        : std::get<0>(numbers).size();
   }
-  // inline void add(const std::string &&key, const std::string &d_string) {
-  //   add(key, d_string);
-  // }
-  inline void add(const std::string &key,
-                  const std::vector<JSON_Data> &d_array) {
-    object.insert(std::make_pair(key, JSON_Data(d_array)));
+  inline bool empty() const { return size() == 0; }
+  /**
+   * @brief the values as `T`, which is `double` or `std::int64_t`.
+   * `std::bad_variant_access` is thrown if they are the other one
+   *
+   * @tparam T
+   * @return JSON_Span<T>
+   */
+  template <typename T>
+  inline JSON_Span<T> get() const {
+    auto &values = std::get<std::vector<T>>(numbers);
+    return JSON_Span<T>(values.data(), values.size());
   }
-  // inline void add(const std::string &&key,
-  //                 const std::vector<JSON_Data> &d_array) {
-  //   add(key, d_array);
-  // }
-  inline void add(const std::string &key, const JSON_Object &d_object) {
-    object.insert(std::make_pair(key, JSON_Data(d_object)));
+  inline double get_double(std::size_t index) const {
+    return is_integer() ? static_cast<double>(std::get<1>(numbers)[index])
+                        : std::get<0>(numbers)[index];
   }
-  // inline void add(const std::string &&key, const JSON_Object &d_object) {
-  //   add(key, d_object);
-  // }
-  inline void add(const std::string &key, const JSON_Data &d_data) {
-    object.insert(std::make_pair(key, d_data));
+  /**
+   * @brief the value at `index` as a `JSON_Data`, which is the same as the
+   * one in the plain array of `to_array()`
+   *
+   * @param index
+   * @return JSON_Data
+   */
+  JSON_Data at(std::size_t index) const;
+  /**
+   * @brief append the values from `begin` to `end` to `output` separated by
+   * `,`, with the same text as the numbers of a plain array
+   *
+   * @param output
+   * @param begin
+   * @param end
+   */
+  inline void dump(std::string &output, std::size_t begin,
+                   std::size_t end) const {
+    for (std::size_t i = begin; i < end; i++) {
+      if (i != begin) output.push_back(',');
+      if (is_integer()) {
+        output += std::to_string(std::get<1>(numbers)[i]);
+      } else {
+        output += std::to_string(std::get<0>(numbers)[i]);
+      }
+    }
   }
-  // inline void add(const std::string &&key, const JSON_Data &d_data) {
-  //   add(key, d_data);
-  // }
+  // the values as a plain array, which is a new one each time
+  std::vector<JSON_Data> to_array() const;
+  bool operator==(const JSON_Packed_Array &other) const;
+
+  friend class JSON_Data;
+
+ private:
+  std::variant<std::vector<double>, std::vector<std::int64_t>> numbers;
+};
+
+/**
+ * @brief the heap memory held by a `JSON_Data` or a `JSON_Object`, in bytes
+ *
+ */
+struct JSON_Memory_Usage {
+  // the `JSON_Data` in arrays and objects
+  std::size_t nodes = 0;
+  // the keys of objects, both the `std::string` and what it allocates
+  std::size_t keys = 0;
+  // the characters of strings and lazy numbers which don't fit in the string
+  std::size_t strings = 0;
+  // the links of map nodes, `JSON_Object` and the `std::shared_ptr` of it
+  std::size_t overhead = 0;
+  // capacity of arrays and strings which is not used
+  std::size_t slack = 0;
 
-  // All getter
-  inline std::nullptr_t &get_null(const std::string &key) {
-    is_key_valid(key);
-    return object.find(key)->second.get_null();
+  inline std::size_t total() const {
+    return nodes + keys + strings + overhead + slack;
   }
-  inline std::nullptr_t &get_null(const std::string &&key) {
-    return get_null(key);
+  inline JSON_Memory_Usage &operator+=(const JSON_Memory_Usage &other) {
+    nodes += other.nodes;
+    keys += other.keys;
+    strings += other.strings;
+    overhead += other.overhead;
+    slack += other.slack;
+    return *this;
   }
-  inline bool &get_bool(const std::string &key) {
-    is_key_valid(key);
-    return object.find(key)->second.get_bool();
+};
+}  // namespace s2ujson
+
+// stats
+#ifdef S2UJSON_STATS
+#define _JSON_STATS(statement) statement
+#else
+#define _JSON_STATS(statement)
+#endif
+
+#ifdef S2UJSON_STATS
+namespace s2ujson {
+/**
+ * @brief what `JSON_parse` and `dump` did, only exists with `S2UJSON_STATS`
+ * defined, otherwise nothing is counted at all.
+ * @details `allocations` and `bytes_allocated` are counted by the allocator
+ * hooked with `JSON_set_allocation_counter`, they are 0 without it.
+ * `estimated_allocations` and `estimated_bytes_allocated` are always
+ * estimated from the size of the strings, arrays and objects built and the
+ * growth of the output.
+ *
+ */
+struct JSON_Stats {
+  enum class phase_t { PARSE, SERIALIZE };
+  // the phase of a single call, only meaningful in the callback
+  phase_t phase = phase_t::PARSE;
+  std::size_t calls = 0;
+  std::size_t bytes_consumed = 0;
+  std::size_t bytes_written = 0;
+  // indexed by `value_t`
+  std::size_t nodes[7] = {};
+  std::size_t max_depth = 0;
+  std::size_t string_bytes_unescaped = 0;
+  std::size_t allocations = 0;
+  std::size_t bytes_allocated = 0;
+  std::size_t estimated_allocations = 0;
+  std::size_t estimated_bytes_allocated = 0;
+  std::uint64_t parse_nanoseconds = 0;
+  std::uint64_t serialize_nanoseconds = 0;
+
+  inline std::size_t node_count(value_t type) const {
+    return nodes[static_cast<int>(type)];
   }
-  inline bool &get_bool(const std::string &&key) { return get_bool(key); }
-  inline double &get_double(const std::string &key) {
-    is_key_valid(key);
-    return object.find(key)->second.get_double();
+  inline JSON_Stats &operator+=(const JSON_Stats &other) {
+    calls += other.calls;
+    bytes_consumed += other.bytes_consumed;
+    bytes_written += other.bytes_written;
+    for (int i = 0; i < 7; i++) nodes[i] += other.nodes[i];
+    max_depth = std::max(max_depth, other.max_depth);
+    string_bytes_unescaped += other.string_bytes_unescaped;
+    allocations += other.allocations;
+    bytes_allocated += other.bytes_allocated;
+    estimated_allocations += other.estimated_allocations;
+    estimated_bytes_allocated += other.estimated_bytes_allocated;
+    parse_nanoseconds += other.parse_nanoseconds;
+    serialize_nanoseconds += other.serialize_nanoseconds;
+    return *this;
   }
-  inline int &get_int(const std::string &key) {
-    is_key_valid(key);
-    return object.find(key)->second.get_int();
+};
+// called on the thread that did the work, so it must not throw
+using JSON_Stats_Callback = void (*)(const JSON_Stats &stats);
+// the allocations made by the calling thread so far
+struct JSON_Allocation_Count {
+  std::size_t allocations = 0;
+  std::size_t bytes = 0;
+};
+// reads the counts of a hooked allocator, it must not allocate or throw
+using JSON_Allocation_Counter = JSON_Allocation_Count (*)();
+
+/**
+ * @brief the totals of all the calls made by this thread
+ * @details not `static`, so every translation unit shares the same totals
+ *
+ * @return JSON_Stats&
+ */
+inline JSON_Stats &JSON_stats() {
+  thread_local JSON_Stats stats;
+  return stats;
+}
+inline void JSON_stats_reset() { JSON_stats() = JSON_Stats(); }
+}  // namespace s2ujson
+
+inline std::atomic<s2ujson::JSON_Stats_Callback> &_JSON_stats_callback() {
+  static std::atomic<s2ujson::JSON_Stats_Callback> callback{nullptr};
+  return callback;
+}
+inline std::atomic<s2ujson::JSON_Allocation_Counter> &
+_JSON_allocation_counter() {
+  static std::atomic<s2ujson::JSON_Allocation_Counter> counter{nullptr};
+  return counter;
+}
+
+namespace s2ujson {
+/**
+ * @brief `callback` receives the stats of every call on any thread, pass
+ * `nullptr` to remove it
+ *
+ * @param callback
+ */
+inline void JSON_set_stats_callback(JSON_Stats_Callback callback) {
+  _JSON_stats_callback().store(callback, std::memory_order_relaxed);
+}
+/**
+ * @brief `counter` reads the counts of an allocator hooked by the user, for
+ * example a replaced global `operator new`. The difference between the start
+ * and the end of a call is its `allocations` and `bytes_allocated`. Pass
+ * `nullptr` to remove it
+ *
+ * @param counter
+ */
+inline void JSON_set_allocation_counter(JSON_Allocation_Counter counter) {
+  _JSON_allocation_counter().store(counter, std::memory_order_relaxed);
+}
+}  // namespace s2ujson
+
+/**
+ * @brief collect the stats of a public call. Only the outermost scope of a
+ * thread collects, so nested calls add to the same stats.
+ *
+ */
+class _JSON_Stats_Scope {
+ public:
+  explicit _JSON_Stats_Scope(s2ujson::JSON_Stats::phase_t phase)
+      : owner(current() == nullptr),
+        start(std::chrono::steady_clock::now()) {
+    if (!owner) return;
+    stats.phase = phase;
+    stats.calls = 1;
+    current() = this;
+    counter = _JSON_allocation_counter().load(std::memory_order_relaxed);
+    if (counter != nullptr) allocated = counter();
   }
-  inline double &get_double(std::string &&key) { return get_double(key); }
-  inline int &get_int(std::string &&key) { return get_int(key); }
-  inline const std::string &get_string(const std::string &key) {
-    is_key_valid(key);
-    return object.find(key)->second.get_string();
+  ~_JSON_Stats_Scope() {
+    if (!owner) return;
+    std::uint64_t time =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count();
+    if (stats.phase == s2ujson::JSON_Stats::phase_t::PARSE) {
+      stats.parse_nanoseconds = time;
+    } else {
+      stats.serialize_nanoseconds = time;
+    }
+    if (output != nullptr) {
+      stats.bytes_written += output->size() - output_size;
+      // a growing string doubles its capacity on each allocation
+      for (auto capacity = output->capacity(); capacity > output_capacity;
+           capacity /= 2) {
+        alloc(1, capacity + 1);
+      }
+    }
+    if (counter != nullptr) {
+      s2ujson::JSON_Allocation_Count now = counter();
+      stats.allocations = now.allocations - allocated.allocations;
+      stats.bytes_allocated = now.bytes - allocated.bytes;
+    }
+    current() = nullptr;
+    s2ujson::JSON_stats() += stats;
+    auto callback = _JSON_stats_callback().load(std::memory_order_relaxed);
+    if (callback != nullptr) callback(stats);
   }
-  inline const std::string &get_string(std::string &&key) {
-    return get_string(key);
+  _JSON_Stats_Scope(const _JSON_Stats_Scope &) = delete;
+  _JSON_Stats_Scope &operator=(const _JSON_Stats_Scope &) = delete;
+
+  // the scope collecting on this thread, or nullptr
+  inline static _JSON_Stats_Scope *&current() {
+    thread_local _JSON_Stats_Scope *scope = nullptr;
+    return scope;
   }
-  inline const std::vector<JSON_Data> &get_array(const std::string &key) {
-    is_key_valid(key);
-    return object.find(key)->second.get_array();
+  // count `bytes_written` and the growth of `output`
+  inline void watch(const std::string &output_string) {
+    if (!owner) return;
+    output = &output_string;
+    output_size = output_string.size();
+    output_capacity = output_string.capacity();
   }
-  inline const std::vector<JSON_Data> &get_array(std::string &&key) {
-    return get_array(key);
+  // an estimated allocation
+  inline void alloc(std::size_t count, std::size_t bytes) {
+    stats.estimated_allocations += count;
+    stats.estimated_bytes_allocated += bytes;
   }
-  inline JSON_Object &get_object(const std::string &key) {
-    is_key_valid(key);
-    return (object.find(key)->second.get_object());
+
+  s2ujson::JSON_Stats stats;
+  std::size_t depth = 0;
+
+ private:
+  bool owner;
+  std::chrono::steady_clock::time_point start;
+  const std::string *output = nullptr;
+  std::size_t output_size = 0;
+  std::size_t output_capacity = 0;
+  s2ujson::JSON_Allocation_Counter counter = nullptr;
+  s2ujson::JSON_Allocation_Count allocated;
+};
+
+/**
+ * @brief count the nesting of arrays and objects for `max_depth`
+ *
+ */
+class _JSON_Stats_Depth {
+ public:
+  _JSON_Stats_Depth() : scope(_JSON_Stats_Scope::current()) {
+    if (scope == nullptr) return;
+    scope->depth++;
+    scope->stats.max_depth = std::max(scope->stats.max_depth, scope->depth);
   }
-  inline JSON_Object &get_object(std::string &&key) { return get_object(key); }
-  /**
-   * @brief a special setter which used to provied usage like
-   * `object.get<bool>("key")`
-   *
-   * @tparam T
-   * @return const T&
-   */
-  template <typename T>
-  inline const T &get(const std::string &key) {
-    return object.find(key)->second.get<T>();
+  ~_JSON_Stats_Depth() {
+    if (scope != nullptr) scope->depth--;
   }
+  _JSON_Stats_Depth(const _JSON_Stats_Depth &) = delete;
+  _JSON_Stats_Depth &operator=(const _JSON_Stats_Depth &) = delete;
 
-  // All operator
-  inline JSON_Data &operator[](const std::string &key) {
-    auto iter = object.find(key);
-    if (iter != object.end()) {
-      return iter->second;
+ private:
+  _JSON_Stats_Scope *scope;
+};
+
+inline static void _JSON_stats_node(s2ujson::value_t type) {
+  if (auto scope = _JSON_Stats_Scope::current()) {
+    scope->stats.nodes[static_cast<int>(type)]++;
+  }
+}
+/**
+ * @brief estimate the allocations of a container built by appending, which
+ * doubles its capacity from `initial` up to `capacity`
+ *
+ * @param capacity
+ * @param initial the capacity without allocation
+ * @param element_size
+ */
+inline static void _JSON_stats_growth(std::size_t capacity,
+                                      std::size_t initial,
+                                      std::size_t element_size) {
+  if (auto scope = _JSON_Stats_Scope::current()) {
+    for (; capacity > initial; capacity /= 2) {
+      scope->alloc(1, capacity * element_size);
     }
-    return object.insert(std::make_pair(key, JSON_Data())).first->second;
   }
-  inline JSON_Data &operator[](const std::string &&key) {
-    return operator[](key);
+}
+inline static void _JSON_stats_string(const std::string &string) {
+  if (auto scope = _JSON_Stats_Scope::current()) {
+    scope->stats.string_bytes_unescaped += string.size();
+    _JSON_stats_growth(string.capacity(), std::string().capacity(), 1);
+  }
+}
+inline static void _JSON_stats_max_depth(std::size_t depth) {
+  if (auto scope = _JSON_Stats_Scope::current()) {
+    scope->stats.max_depth = std::max(scope->stats.max_depth, depth);
+  }
+}
+// the map nodes, the keys and the `std::shared_ptr` of a parsed object
+template <typename Object>
+inline static void _JSON_stats_object(const Object &object) {
+  if (auto scope = _JSON_Stats_Scope::current()) {
+    scope->stats.nodes[static_cast<int>(s2ujson::value_t::OBJECT)]++;
+    for (auto i = object.cbegin(); i != object.cend(); i++) {
+      // the value and the links of a red-black tree node
+      scope->alloc(1, sizeof(*i) + 4 * sizeof(void *));
+      _JSON_stats_growth(i->first.capacity(), std::string().capacity(), 1);
+    }
+    scope->alloc(1, sizeof(Object) + 2 * sizeof(long));
   }
+}
+#endif
 
+namespace s2ujson {
+/**
+ * @brief the output of a scatter-gather `dump`. Strings with nothing to
+ * escape are referenced where they are instead of being copied, everything
+ * else is written to a side buffer. The references are only valid while the
+ * dumped data is not changed.
+ *
+ */
+class JSON_Gather_Output {
+ public:
   /**
-   * @brief allow user to use
-   * `JSON_Object object = {{"key","value"},{"key","value"}}`
-   *
-   * @param list
-   * @return JSON_Object&
+   * @param min_reference shorter strings are copied to the side buffer, as
+   * a segment costs more than a small copy
    */
-  JSON_Object &operator=(
-      std::initializer_list<std::pair<std::string, JSON_Data>> list);
+  explicit JSON_Gather_Output(std::size_t min_reference = 64)
+      : min_reference(min_reference) {}
 
+  // keep the capacity for the next `dump`
+  inline void clear() {
+    buffer.clear();
+    references.clear();
+    referenced = 0;
+  }
+  // bytes of the whole output
+  inline std::size_t size() const { return buffer.size() + referenced; }
+  inline std::size_t reference_count() const { return references.size(); }
   /**
-   * @brief return object's JSON string
+   * @brief call `sink(const char *data, std::size_t size)` for each segment
+   * of the output in order, empty segments are skipped
    *
-   * @return std::string
+   * @tparam Sink
+   * @param sink
    */
-  inline std::string to_string() {
-    std::string output_string = "{";
-    for (auto i : object) {
-      output_string +=
-          ("\"" + i.first + "\"" + ":" + i.second.to_string() + ",");
+  template <typename Sink>
+  inline void for_each(Sink &&sink) const {
+    std::size_t position = 0;
+    for (auto &i : references) {
+      if (i.position > position) {
+        sink(buffer.data() + position, i.position - position);
+      }
+      sink(i.data, i.size);
+      position = i.position;
+    }
+    if (buffer.size() > position) {
+      sink(buffer.data() + position, buffer.size() - position);
     }
-    output_string.pop_back();
-    output_string.push_back('}');
-    return output_string;
   }
-
-  // All STL-like access
-  // iterator
-  inline iterator begin() { return object.begin(); }
-  inline const_iterator cbegin() const { return object.cbegin(); };
-  inline iterator end() { return object.end(); }
-  inline const_iterator cend() const { return object.cend(); }
-  inline reverse_iterator rbegin() { return object.rbegin(); }
-  inline const_reverse_iterator crbegin() const { return object.crbegin(); }
-  inline reverse_iterator rend() { return object.rend(); }
-  inline const_reverse_iterator crend() const { return object.crend(); }
-  // capacity
-  inline bool empty() const { return object.empty(); }
-  inline size_t size() const { return object.size(); };
-  inline size_t max_size() const { return object.max_size(); }
-  // modifer
-  inline void clear() { object.clear(); }
-  // finder
-  inline iterator find(const std::string &key) { return object.find(key); }
-  inline const_iterator find(const std::string &key) const {
-    return object.find(key);
+  inline std::string to_string() const {
+    std::string result;
+    result.reserve(size());
+    for_each([&](const char *data, std::size_t size) {
+      result.append(data, size);
+    });
+    return result;
   }
-  inline size_t count(const std::string &key) const {
-    return object.count(key);
+#ifdef S2UJSON_HAS_WRITEV
+  // the segments as a list for `writev`
+  inline void to_iovecs(std::vector<iovec> &result) const {
+    result.clear();
+    for_each([&](const char *data, std::size_t size) {
+      result.push_back({const_cast<char *>(data), size});
+    });
   }
+#endif
 
-  inline bool exist(const std::string &key) const {
-    return object.find(key) != object.end();
-  }
+  friend class JSON_Data;
+  friend class JSON_Object;
 
  private:
-  inline void is_key_valid(const std::string &key) {
-    if (object.find(key) == object.end()) {
-      throw std::invalid_argument("invalid key");
+  // a string written at `position` of the side buffer
+  struct reference {
+    std::size_t position;
+    const char *data;
+    std::size_t size;
+  };
+
+  inline void write_string(const std::string &str, bool escape_unicode) {
+    if (str.size() < min_reference ||
+        _JSON_simd_plain_length(str.data(), str.data() + str.size(),
+                                escape_unicode) != str.size()) {
+      _JSON_escape_string(buffer, str, escape_unicode);
+      return;
     }
+    buffer.push_back('\"');
+    references.push_back({buffer.size(), str.data(), str.size()});
+    referenced += str.size();
+    _JSON_STATS(if (auto scope = _JSON_Stats_Scope::current()) {
+      scope->stats.bytes_written += str.size();
+    });
+    buffer.push_back('\"');
   }
-  inline void is_key_valid(const std::string &&key) { is_key_valid(key); }
 
- private:
-  std::map<std::string, JSON_Data> object;
+  std::string buffer;
+  std::vector<reference> references;
+  std::size_t referenced = 0;
+  std::size_t min_reference;
 };
 
+#ifdef S2UJSON_HAS_WRITEV
 /**
- * @brief specified version of `get` to get the `JSON_Object` ranther than
- * pointer
+ * @brief write all of `output`, a `JSON_Gather_Output` or a
+ * `JSON_Parallel_Output`, to `fd` with `writev`, in batches of a few
+ * segments. Short writes are continued and `EINTR` is retried, other errors
+ * throw `std::system_error`
  *
- * @tparam
- * @return const JSON_Object&
+ * @param fd
+ * @param output
+ * @return std::size_t the bytes written
  */
-template <>
-inline const JSON_Object &JSON_Data::get<JSON_Object>() {
-  return *std::get<std::shared_ptr<JSON_Object>>(data);
-}
-
+template <typename Output>
+inline static std::size_t JSON_writev(int fd, const Output &output) {
+  constexpr int batch_size = 64;
+  iovec batch[batch_size];
+  int count = 0;
+  std::size_t total = 0;
+  auto flush = [&]() {
+    iovec *iter = batch;
+    int left = count;
+    while (left > 0) {
+      ssize_t written = ::writev(fd, iter, left);
+      if (written < 0) {
+        if (errno == EINTR) continue;
+        throw std::system_error(errno, std::generic_category(), "writev");
+      }
+      total += static_cast<std::size_t>(written);
+      auto rest = static_cast<std::size_t>(written);
+      while (left > 0 && rest >= iter->iov_len) {
+        rest -= iter->iov_len;
+        iter++;
+        left--;
+      }
+      if (left > 0) {
+        iter->iov_base = static_cast<char *>(iter->iov_base) + rest;
+        iter->iov_len -= rest;
+      }
+    }
+    count = 0;
+  };
+  output.for_each([&](const char *data, std::size_t size) {
+    batch[count++] = {const_cast<char *>(data), size};
+    if (count == batch_size) flush();
+  });
+  flush();
+  return total;
+}
+#endif
+
+/**
+ * @brief The class which holds all the data, include 'Object'.
+ * @details Is basically a wrapper of 'std::variant'. All the 'exceptions' that
+ * threw by 'std::variant' need you to handle, if you do something incorrectly
+ *
+ */
+class JSON_Data {
+  // use to achieve initialization of array by using initializer_list
+  using var = std::variant<std::nullptr_t, bool, double, int, std::string>;
+
+ public:
+  // All the Constructors
+  JSON_Data() { set(nullptr); }
+  explicit JSON_Data(const bool d_bool) { set(d_bool); }
+  JSON_Data(const double d_number) { set(d_number); }
+  JSON_Data(const int d_number) { set(d_number); }
+  JSON_Data(const std::int64_t d_number) { set(d_number); }
+  JSON_Data(const std::uint64_t d_number) { set(d_number); }
+  JSON_Data(const JSON_Number &d_number) { set(d_number); }
+  JSON_Data(JSON_Number &&d_number) { set(std::move(d_number)); }
+  JSON_Data(const std::string &d_string) { set(d_string); }
+  JSON_Data(const char *ptr) { set(std::string(ptr)); }
+  JSON_Data(const std::vector<JSON_Data> &d_array) { set(d_array); }
+  JSON_Data(const JSON_Object &d_object) { set(d_object); }
+  JSON_Data(std::string &&d_string) { set(std::move(d_string)); }
+  JSON_Data(std::vector<JSON_Data> &&d_array) { set(std::move(d_array)); }
+  JSON_Data(JSON_Object &&d_object) { set(std::move(d_object)); }
+  JSON_Data(JSON_Packed_Array &&d_array) { set(std::move(d_array)); }
+  JSON_Data(const std::nullptr_t n_ptr) { set(n_ptr); };
+  JSON_Data(std::initializer_list<var> list) { operator=(list); }
+  JSON_Data(std::initializer_list<std::pair<std::string, JSON_Data>> list) {
+    operator=(list);
+  }
+  JSON_Data(const JSON_Data &) = default;
+  JSON_Data &operator=(const JSON_Data &) = default;
+#if defined(S2UJSON_CACHED_HASH) || defined(S2UJSON_CACHED_DUMP)
+  // an object moved out leaves its old parent, see `_JSON_Cache_Node`
+  JSON_Data(JSON_Data &&other) noexcept
+      : data(std::move(other.data)),
+        type(other.type),
+        cache(std::move(other.cache)) {
+    leave_cache();
+  }
+  JSON_Data &operator=(JSON_Data &&other) noexcept {
+    data = std::move(other.data);
+    type = other.type;
+    cache = std::move(other.cache);
+    leave_cache();
+    return *this;
+  }
+#else
+  JSON_Data(JSON_Data &&) = default;
+  JSON_Data &operator=(JSON_Data &&) = default;
+#endif
+  // deep data is destroyed without recursion, see `release_children`
+  ~JSON_Data();
+
+  // All the getter
+  inline std::nullptr_t &get_null() { return std::get<std::nullptr_t>(data); }
+  // the non-const getters hand out a reference which can change the value,
+  // see `_JSON_Cache_Node`
+  inline bool &get_bool() {
+    expose_cache();
+    return std::get<bool>(data);
+  }
+  inline double &get_double() {
+    if (!std::holds_alternative<double>(data)) {
+      set(static_cast<const JSON_Data *>(this)->get_double());
+    }
+    expose_cache();
+    return std::get<double>(data);
+  }
+  inline int &get_int() {
+    if (!std::holds_alternative<int>(data)) {
+      set(static_cast<const JSON_Data *>(this)->get_int());
+    }
+    expose_cache();
+    return std::get<int>(data);
+  }
+  inline std::string &get_string() {
+    expose_cache();
+    return std::get<std::string>(data);
+  }
+  // a packed array is turned into a plain one
+  inline std::vector<JSON_Data> &get_array() {
+    auto &array = plain_array();
+    expose_cache();
+    return array;
+  }
+  inline JSON_Object &get_object() {
+    return *std::get<std::shared_ptr<JSON_Object>>(data);
+  }
+
+  // All the const getter, they never change the data, so a document can be
+  // read by many threads at the same time. Numbers are converted on return.
+  inline std::nullptr_t get_null() const {
+    return std::get<std::nullptr_t>(data);
+  }
+  inline bool get_bool() const { return std::get<bool>(data); }
+  double get_double() const;
+  inline int get_int() const {
+    if (std::holds_alternative<int>(data)) return std::get<int>(data);
+    if (std::holds_alternative<double>(data)) {
+      return static_cast<int>(std::get<double>(data));
+    }
+    return static_cast<int>(get_int64());
+  }
+  /**
+   * @brief the exact value of an integer, parsed lazily or set as
+   * `std::int64_t`. Other numbers are truncated.
+   * @details `std::out_of_range` is thrown if it doesn't fit in
+   * `std::int64_t`
+   *
+   * @return std::int64_t
+   */
+  std::int64_t get_int64() const;
+  // same as `get_int64`, for `std::uint64_t`
+  std::uint64_t get_uint64() const;
+  inline const std::string &get_string() const {
+    return std::get<std::string>(data);
+  }
+  /**
+   * @brief the elements of an array. A packed array has no
+   * `std::vector<JSON_Data>`, so `std::bad_variant_access` is thrown for it:
+   * read it with `array_size` and `element`, or the spans of `get_packed()`
+   *
+   * @return const std::vector<JSON_Data>&
+   */
+  inline const std::vector<JSON_Data> &get_array() const {
+    return std::get<std::vector<JSON_Data>>(data);
+  }
+  inline const JSON_Packed_Array &get_packed() const {
+    return *std::get<std::shared_ptr<const JSON_Packed_Array>>(data);
+  }
+  // the number of elements of an array, packed or not
+  inline std::size_t array_size() const {
+    return is_packed() ? get_packed().size()
+                       : std::get<std::vector<JSON_Data>>(data).size();
+  }
+  /**
+   * @brief the element at `index` of an array, packed or not. The element of
+   * a packed array is made in `scratch`
+   *
+   * @param index
+   * @param scratch
+   * @return const JSON_Data&
+   */
+  inline const JSON_Data &element(std::size_t index,
+                                  JSON_Data &scratch) const {
+    if (is_packed()) {
+      scratch = get_packed().at(index);
+      return scratch;
+    }
+    return std::get<std::vector<JSON_Data>>(data)[index];
+  }
+  inline const JSON_Object &get_object() const {
+    return *std::get<std::shared_ptr<JSON_Object>>(data);
+  }
+  /**
+   * @brief this data as `T`, empty if it is another type, without throwing.
+   * The scalars are returned as `std::optional<T>`. For the integer types it
+   * is empty unless the number is an integer which fits `T`, for `double`
+   * unless it fits a `double`. `std::string`, `std::vector<JSON_Data>`,
+   * `JSON_Object`, `JSON_Packed_Array` and `JSON_Data` itself are returned as
+   * `const T *`. A packed array is only a `JSON_Packed_Array`, so its plain
+   * array isn't built
+   *
+   * @tparam T
+   * @return typename _JSON_try_get<T>::type
+   */
+  template <typename T>
+  inline typename _JSON_try_get<T>::type try_get() const {
+    if constexpr (std::is_same_v<T, JSON_Data>) {
+      return this;
+    } else if constexpr (std::is_same_v<T, std::nullptr_t>) {
+      if (is_null()) return nullptr;
+    } else if constexpr (std::is_same_v<T, bool>) {
+      if (is_boolean()) return std::get<bool>(data);
+    } else if constexpr (std::is_same_v<T, double>) {
+      if (auto number = std::get_if<JSON_Number>(&data)) {
+        auto &raw = number->get_raw();
+        double result = 0;
+        auto [last, error] =
+            std::from_chars(raw.data(), raw.data() + raw.size(), result);
+        if (error == std::errc() && last == raw.data() + raw.size()) {
+          return result;
+        }
+      } else if (is_number()) {
+        return get_double();
+      }
+    } else if constexpr (std::is_same_v<T, int> ||
+                         std::is_same_v<T, std::int64_t> ||
+                         std::is_same_v<T, std::uint64_t>) {
+      if (is_number()) return try_get_integer<T>();
+    } else if constexpr (std::is_same_v<T, JSON_Object>) {
+      auto object = std::get_if<std::shared_ptr<JSON_Object>>(&data);
+      if (object != nullptr) return object->get();
+    } else if constexpr (std::is_same_v<T, std::vector<JSON_Data>>) {
+      if (is_array() && !is_packed()) return &get_array();
+    } else if constexpr (std::is_same_v<T, JSON_Packed_Array>) {
+      if (is_packed()) return &get_packed();
+    } else {
+      return std::get_if<T>(&data);
+    }
+    return {};
+  }
+  /**
+   * @brief the value at a JSON Pointer (RFC 6901), nullptr if there is none.
+   * Each token is looked up as it is read, so the pointer isn't split into
+   * strings. `std::invalid_argument` is thrown if the pointer is invalid.
+   * An element of a packed array has no `JSON_Data` to point to, so
+   * `std::bad_variant_access` is thrown if the pointer ends at one: use the
+   * overload with a scratch value for those
+   *
+   * @param pointer
+   * @return const JSON_Data*
+   */
+  inline const JSON_Data *find_pointer(std::string_view pointer) const {
+    return find_pointer(pointer, nullptr);
+  }
+  /**
+   * @brief same as `find_pointer(pointer)`, but an element of a packed array
+   * is made in `scratch` and a pointer to it is returned
+   *
+   * @param pointer
+   * @param scratch
+   * @return const JSON_Data*
+   */
+  inline const JSON_Data *find_pointer(std::string_view pointer,
+                                       JSON_Data &scratch) const {
+    return find_pointer(pointer, &scratch);
+  }
+
+  // All the type check
+  inline const value_t &get_type() const { return type; };
+  inline bool is_null() const { return type == value_t::NULL_DATA; }
+  inline bool is_boolean() const {
+    return (type == value_t::TRUE || type == value_t::FALSE);
+  }
+  inline bool is_number() const { return type == value_t::NUMBER; }
+  inline bool is_string() const { return type == value_t::STRING; }
+  inline bool is_array() const { return type == value_t::ARRAY; }
+  // an array kept as a `JSON_Packed_Array`
+  inline bool is_packed() const {
+    return std::holds_alternative<std::shared_ptr<const JSON_Packed_Array>>(
+        data);
+  }
+  inline bool is_object() const { return type == value_t::OBJECT; }
+
+  // All the setter
+  inline void set(const std::nullptr_t) {
+    invalidate_cache();
+    type = value_t::NULL_DATA;
+    data = nullptr;
+  }
+  inline void set(bool d_bool) {
+    invalidate_cache();
+    if (d_bool) {
+      type = value_t::TRUE;
+    } else {
+      type = value_t::FALSE;
+    }
+    data = d_bool;
+  }
+  inline void set(double d_number) {
+    invalidate_cache();
+    type = value_t::NUMBER;
+    data = d_number;
+  }
+  inline void set(int d_number) {
+    invalidate_cache();
+    type = value_t::NUMBER;
+    data = d_number;
+  }
+  inline void set(std::int64_t d_number) {
+    invalidate_cache();
+    type = value_t::NUMBER;
+    data = d_number;
+  }
+  inline void set(std::uint64_t d_number) {
+    invalidate_cache();
+    type = value_t::NUMBER;
+    data = d_number;
+  }
+  inline void set(const JSON_Number &d_number) {
+    invalidate_cache();
+    type = value_t::NUMBER;
+    data = d_number;
+  }
+  inline void set(JSON_Number &&d_number) {
+    invalidate_cache();
+    type = value_t::NUMBER;
+    data = std::move(d_number);
+  }
+  inline void set(const std::string &d_string) {
+    invalidate_cache();
+    type = value_t::STRING;
+    data = d_string;
+  }
+  inline void set(const std::vector<JSON_Data> &d_array) {
+    invalidate_cache();
+    type = value_t::ARRAY;
+    data = d_array;
+  }
+  inline void set(const JSON_Object &d_object) {
+    invalidate_cache();
+    type = value_t::OBJECT;
+    data = std::make_shared<JSON_Object>(d_object);
+  }
+  // move version of the setters, so nothing is copied
+  inline void set(std::string &&d_string) {
+    invalidate_cache();
+    type = value_t::STRING;
+    data = std::move(d_string);
+  }
+  inline void set(std::vector<JSON_Data> &&d_array) {
+    invalidate_cache();
+    type = value_t::ARRAY;
+    data = std::move(d_array);
+  }
+  inline void set(JSON_Object &&d_object) {
+    invalidate_cache();
+    type = value_t::OBJECT;
+    data = std::make_shared<JSON_Object>(std::move(d_object));
+  }
+  inline void set(JSON_Packed_Array &&d_array) {
+    invalidate_cache();
+    type = value_t::ARRAY;
+    data = std::make_shared<const JSON_Packed_Array>(std::move(d_array));
+  }
+
+  /**
+   * @brief a special setter which used to provied usage like `data.get<bool>()`
+   *
+   * @tparam T
+   * @return const T&
+   */
+  template <typename T>
+  inline const T &get() {
+    return std::get<T>(data);
+  }
+  /**
+   * @brief const version of `get`, `get<int>` and `get<double>` return the
+   * converted value instead of changing the data
+   *
+   * @tparam T
+   * @return const T&, or T for `int` and `double`
+   */
+  template <typename T>
+  inline typename _JSON_const_get<T>::type get() const {
+    return std::get<T>(data);
+  }
+
+  // All overloaded `=` to do `object["key"] = something` or `object["key"] =
+  // {{"name", "val"}}` or `object["key"] = {1, "good", false, nullptr}`
+  inline JSON_Data &operator=(std::nullptr_t) {
+    set(nullptr);
+    return *this;
+  }
+  inline JSON_Data &operator=(const bool d_bool) {
+    set(d_bool);
+    return *this;
+  }
+  inline JSON_Data &operator=(const double d_number) {
+    set(d_number);
+    return *this;
+  }
+  inline JSON_Data &operator=(const int d_number) {
+    set(d_number);
+    return *this;
+  }
+  inline JSON_Data &operator=(const std::int64_t d_number) {
+    set(d_number);
+    return *this;
+  }
+  inline JSON_Data &operator=(const std::uint64_t d_number) {
+    set(d_number);
+    return *this;
+  }
+  inline JSON_Data &operator=(const JSON_Number &d_number) {
+    set(d_number);
+    return *this;
+  }
+  inline JSON_Data &operator=(const std::string &d_string) {
+    set(d_string);
+    return *this;
+  }
+  inline JSON_Data &operator=(const std::string &&d_string) {
+    return operator=(d_string);
+  }
+  inline JSON_Data &operator=(const char *ptr) {
+    return operator=(std::string(ptr));
+  }
+  inline JSON_Data &operator=(const std::vector<JSON_Data> &d_array) {
+    set(d_array);
+    return *this;
+  }
+  inline JSON_Data &operator=(const std::vector<JSON_Data> &&d_array) {
+    return operator=(d_array);
+  }
+  inline JSON_Data &operator=(const JSON_Object &d_object) {
+    set(d_object);
+    return *this;
+  }
+  inline JSON_Data &operator=(const JSON_Object &&d_object) {
+    return operator=(d_object);
+  }
+  JSON_Data &operator=(
+      std::initializer_list<std::pair<std::string, JSON_Data>> list);
+  JSON_Data &operator=(std::initializer_list<var> list);
+
+  // All overloaded `[]` to do `object["key1"]["key2"] = something"
+  JSON_Data &operator[](std::string_view key);
+  // const version never adds the key, `std::invalid_argument` is thrown if
+  // it doesn't exist
+  const JSON_Data &operator[](std::string_view key) const;
+
+  /**
+   * @brief output the JSON string of this data
+   * @param escape_unicode write non-ASCII chars as `\uXXXX`
+   * @return std::string
+   */
+  std::string to_string(bool escape_unicode = false) const;
+  /**
+   * @brief append the JSON string of this data to `output`
+   *
+   * @param output
+   * @param escape_unicode write non-ASCII chars as `\uXXXX`
+   */
+  void dump(std::string &output, bool escape_unicode = false) const;
+  /**
+   * @brief scatter-gather version of `dump`, see `JSON_Gather_Output`
+   *
+   * @param output
+   * @param escape_unicode write non-ASCII chars as `\uXXXX`
+   */
+  void dump(JSON_Gather_Output &output, bool escape_unicode = false) const;
+
+  /**
+   * @brief deep copy of this data
+   * @details copying a `JSON_Data` only copies the `std::shared_ptr` of an
+   * object, so the copy shares the object with this data. `clone` doesn't.
+   *
+   * @return JSON_Data
+   */
+  JSON_Data clone() const;
+
+  /**
+   * @brief apply a JSON Patch (RFC 6902), which is an array of operations,
+   * to this data in place.
+   * @details the values are moved in and out of the document, so only the
+   * parts of the document that are replaced or removed are kept aside to undo
+   * the patch. If any operation fails, the document is restored and
+   * `std::invalid_argument` is thrown.
+   *
+   * @param patch
+   */
+  void apply_patch(const JSON_Data &patch);
+  // the values in `patch` are moved into the document instead of copied
+  void apply_patch(JSON_Data &&patch);
+  /**
+   * @brief apply a JSON Merge Patch (RFC 7396) to this data in place, with
+   * the same guarantee as `apply_patch`
+   *
+   * @param patch
+   */
+  void apply_merge_patch(const JSON_Data &patch);
+  // the values in `patch` are moved into the document instead of copied
+  void apply_merge_patch(JSON_Data &&patch);
+
+  /**
+   * @brief deep comparison, numbers are compared by value, so `1` equals to
+   * `1.0`. Integers are compared exactly up to 64 bits.
+   *
+   * @param other
+   * @return true
+   * @return false
+   */
+  bool operator==(const JSON_Data &other) const;
+  inline bool operator!=(const JSON_Data &other) const {
+    return !operator==(other);
+  }
+  /**
+   * @brief 64-bit structural hash, data which are `==` have the same hash.
+   * @details with `S2UJSON_CACHED_HASH` defined, the hash of arrays and
+   * objects is cached in the node. A change drops the cached hashes of the
+   * changed node and of its parents only, also when it is made through a
+   * reference kept from before the last `hash()` or through a `JSON_Object`
+   * shared with another document, see `_JSON_Cache_Node`. No hash is cached
+   * over a value handed out by a non-const getter, until it is set again.
+   *
+   * @return std::uint64_t
+   */
+  std::uint64_t hash() const;
+
+  /**
+   * @brief the heap memory held by this data, not including the data itself
+   * @details the sizes of the allocations are estimated from the layout of
+   * the standard library, the allocator's own overhead is not included. An
+   * object shared by copies is counted for each of them.
+   *
+   * @return JSON_Memory_Usage
+   */
+  JSON_Memory_Usage memory_usage() const;
+  /**
+   * @brief release the unused capacity of all the arrays, strings and keys,
+   * which is left from parsing or editing. The data is not changed.
+   *
+   */
+  void shrink_to_fit();
+
+ private:
+  /**
+   * @brief append array style JSON string for array
+   *
+   * @param output
+   * @param escape_unicode
+   */
+  void array_dump(std::string &output, bool escape_unicode) const;
+  /**
+   * @brief get the data out of var
+   *
+   * @param d_var
+   * @return JSON_Data
+   */
+  JSON_Data convert(var d_var);
+  // `find_pointer`, throwing at an element of a packed array if `scratch` is
+  // nullptr
+  const JSON_Data *find_pointer(std::string_view pointer,
+                                JSON_Data *scratch) const;
+  // the value is replaced, which ends the references handed out before
+  inline void invalidate_cache() {
+#if defined(S2UJSON_CACHED_HASH) || defined(S2UJSON_CACHED_DUMP)
+    cache.changed();
+    cache.exposed = false;
+#endif
+  }
+  // a non-const reference to the value is handed out
+  inline void expose_cache() {
+#if defined(S2UJSON_CACHED_HASH) || defined(S2UJSON_CACHED_DUMP)
+    cache.changed();
+    cache.exposed = true;
+#endif
+  }
+  // the array to change, a packed array is turned into a plain one
+  inline std::vector<JSON_Data> &plain_array() {
+#if defined(S2UJSON_CACHED_HASH) || defined(S2UJSON_CACHED_DUMP)
+    cache.changed();
+#endif
+    if (auto packed = std::get_if<std::shared_ptr<const JSON_Packed_Array>>(
+            &data)) {
+      data = (*packed)->to_array();
+    }
+    return std::get<std::vector<JSON_Data>>(data);
+  }
+#if defined(S2UJSON_CACHED_HASH) || defined(S2UJSON_CACHED_DUMP)
+  /**
+   * @brief link this node to the block of the array or object holding it,
+   * once it is hashed or dumped
+   *
+   * @param parent
+   * @return false if the parent can't keep a cache over this node
+   */
+  bool enter_cache(_JSON_Cache_Block &parent) const;
+  // drop the parent link of the object held alone, which was moved here
+  void leave_cache() noexcept;
+#endif
+  std::uint64_t compute_hash() const;
+  /**
+   * @brief move the arrays and objects in this data to `pending`, so they
+   * are destroyed by the loop in the destructor instead of recursively
+   *
+   * @param pending
+   */
+  void release_children(std::vector<JSON_Data> &pending);
+  /**
+   * @brief the value of a number used by `==` and `hash`. Integers in the
+   * range of `std::int64_t` and `std::uint64_t` are kept exact, whatever
+   * they are stored as, others are kept as double.
+   *
+   */
+  struct number_key {
+    bool integral;
+    bool negative;
+    std::uint64_t magnitude;
+    double value;
+  };
+  number_key get_number_key() const;
+  // the value as the integer type `T`, empty if it is not an integer or
+  // doesn't fit `T`
+  template <typename T>
+  inline std::optional<T> try_get_integer() const {
+    number_key key = get_number_key();
+    if (!key.integral) return {};
+    if (!key.negative) {
+      if (key.magnitude > static_cast<std::uint64_t>(
+                              std::numeric_limits<T>::max())) {
+        return {};
+      }
+      return static_cast<T>(key.magnitude);
+    }
+    if constexpr (std::is_signed_v<T>) {
+      // the magnitude of the min value is max + 1
+      if (key.magnitude - 1 <= static_cast<std::uint64_t>(
+                                   std::numeric_limits<T>::max())) {
+        return -static_cast<T>(key.magnitude - 1) - 1;
+      }
+    }
+    return {};
+  }
+
+  friend class JSON_Object;
+  friend class ::_JSON_Patch;
+  friend class ::_JSON_Parse_Pool;
+
+ private:
+  std::variant<std::nullptr_t, bool, double, int, std::string,
+               std::vector<JSON_Data>, std::shared_ptr<JSON_Object>,
+               std::int64_t, std::uint64_t, JSON_Number,
+               std::shared_ptr<const JSON_Packed_Array>>
+      data;
+  value_t type = value_t::NULL_DATA;
+#if defined(S2UJSON_CACHED_HASH) || defined(S2UJSON_CACHED_DUMP)
+  // the own block is only used by arrays, objects have their own
+  _JSON_Cache_Node cache;
+#endif
+};
+template <>
+inline const int &JSON_Data::get<int>() {
+  return get_int();
+}
+template <>
+inline const double &JSON_Data::get<double>() {
+  return get_double();
+}
+template <>
+inline int JSON_Data::get<int>() const {
+  return get_int();
+}
+template <>
+inline double JSON_Data::get<double>() const {
+  return get_double();
+}
+template <>
+inline std::int64_t JSON_Data::get<std::int64_t>() const {
+  return get_int64();
+}
+template <>
+inline std::uint64_t JSON_Data::get<std::uint64_t>() const {
+  return get_uint64();
+}
+template <>
+inline const std::vector<JSON_Data> &JSON_Data::get<std::vector<JSON_Data>>() {
+  return plain_array();
+}
+template <>
+inline const std::vector<JSON_Data> &JSON_Data::get<std::vector<JSON_Data>>()
+    const {
+  return get_array();
+}
+}  // namespace s2ujson
+
+/**
+ * @brief a working `data structure` to let the user can read the data in the
+ * order they added
+ * @deprecated working in progress
+ */
+// class JSON_Object_Storage {
+//  public:
+//   explicit JSON_Object_Storage() = default;
+//   inline void insert(const std::string &key, JSON_Data &data) {
+//     key_to_pos.insert(std::make_pair(key, key_to_pos.size()));
+//     if (real_data.size() >= key_to_pos.size()) {
+//       real_data[key_to_pos.size() - 1] = data;
+//     } else {
+//       real_data.push_back(data);
+//     }
+//   }
+//   inline void insert(const std::string &key, JSON_Data &&data) {
+//     insert(key, data);
+//   }
+
+//   inline JSON_Data &find(const std::string &key) {
+//     return real_data[key_to_pos.find(key)->second];
+//   }
+
+//   inline JSON_Data &find(const int pos) { return real_data[pos]; }
+
+//   inline bool is_key_invalid(const std::string &key) {
+//     return key_to_pos.find(key) == key_to_pos.end();
+//   }
+
+//   std::vector<std::pair<std::string, JSON_Data>> get_Storage_In_Order() {
+//     std::vector<std::pair<std::string, JSON_Data>> result(key_to_pos.size());
+//     for (auto i : key_to_pos) {
+//       result[i.second] = std::make_pair(i.first, real_data[i.second]);
+//     }
+//     return result;
+//   }
+
+//  private:
+//   std::map<std::string, int> key_to_pos;
+//   std::vector<JSON_Data> real_data;
+// };
+namespace s2ujson {
+class JSON_Object {
+ public:
+  // `std::less<>` finds keys by `std::string_view` without a copy
+  using map_type = std::map<std::string, JSON_Data, std::less<>>;
+  using iterator = map_type::iterator;
+  using const_iterator = map_type::const_iterator;
+  using reverse_iterator = map_type::reverse_iterator;
+  using const_reverse_iterator = map_type::const_reverse_iterator;
+
+ public:
+  // All Constructor
+  explicit JSON_Object() = default;
+  JSON_Object(std::initializer_list<std::pair<std::string, JSON_Data>> list);
+
+  // All add
+  inline void add(const std::string &key) {
+    invalidate_cache();
+    object.insert(std::make_pair(key, JSON_Data()));
+  }
+  // inline void add(const std::string &&key) { add(key); }
+  inline void add(const std::string &key, std::nullptr_t) {
+    invalidate_cache();
+    object.insert(std::make_pair(key, JSON_Data()));
+  }
+  // inline void add(const std::string &&key, std::nullptr_t) {
+  //   add(key, nullptr);
+  // }
+  inline void add(const std::string &key, const bool d_bool) {
+    invalidate_cache();
+    object.insert(std::make_pair(key, JSON_Data(d_bool)));
+  }
+  // inline void add(const std::string &&key, const bool d_bool) {
+  //   add(key, d_bool);
+  // }
+  inline void add(const std::string &key, const int d_number) {
+    invalidate_cache();
+    object.insert(std::make_pair(key, JSON_Data(d_number)));
+  }
+  inline void add(const std::string &key, const double d_number) {
+    invalidate_cache();
+    object.insert(std::make_pair(key, JSON_Data(d_number)));
+  }
+  // inline void add(const std::string &&key, const double d_number) {
+  //   add(key, d_number);
+  // }
+  inline void add(const std::string &key, const std::string &d_string) {
+    invalidate_cache();
+    object.insert(std::make_pair(key, JSON_Data(d_string)));
+  }
+  // inline void add(const std::string &&key, const std::string &d_string) {
+  //   add(key, d_string);
+  // }
+  inline void add(const std::string &key,
+                  const std::vector<JSON_Data> &d_array) {
+    invalidate_cache();
+    object.insert(std::make_pair(key, JSON_Data(d_array)));
+  }
+  // inline void add(const std::string &&key,
+  //                 const std::vector<JSON_Data> &d_array) {
+  //   add(key, d_array);
+  // }
+  inline void add(const std::string &key, const JSON_Object &d_object) {
+    invalidate_cache();
+    object.insert(std::make_pair(key, JSON_Data(d_object)));
+  }
+  // inline void add(const std::string &&key, const JSON_Object &d_object) {
+  //   add(key, d_object);
+  // }
+  inline void add(const std::string &key, const JSON_Data &d_data) {
+    invalidate_cache();
+    object.insert(std::make_pair(key, d_data));
+  }
+  inline void add(std::string &&key, JSON_Data &&d_data) {
+    invalidate_cache();
+    object.emplace(std::move(key), std::move(d_data));
+  }
+  // inline void add(const std::string &&key, const JSON_Data &d_data) {
+  //   add(key, d_data);
+  // }
+
+  // All getter, `std::invalid_argument` is thrown if the key doesn't exist
+  inline std::nullptr_t &get_null(std::string_view key) {
+    return at_key(key).get_null();
+  }
+  inline bool &get_bool(std::string_view key) {
+    return at_key(key).get_bool();
+  }
+  inline double &get_double(std::string_view key) {
+    return at_key(key).get_double();
+  }
+  inline int &get_int(std::string_view key) {
+    return at_key(key).get_int();
+  }
+  inline const std::string &get_string(std::string_view key) {
+    return at_key(key).get<std::string>();
+  }
+  inline const std::vector<JSON_Data> &get_array(std::string_view key) {
+    return at_key(key).get<std::vector<JSON_Data>>();
+  }
+  inline JSON_Object &get_object(std::string_view key) {
+    return at_key(key).get_object();
+  }
+  /**
+   * @brief a special setter which used to provied usage like
+   * `object.get<bool>("key")`
+   *
+   * @tparam T
+   * @return const T&
+   */
+  template <typename T>
+  inline const T &get(std::string_view key) {
+    return at_key(key).get<T>();
+  }
+
+  // All const getter, they never change the data, see the const getters of
+  // `JSON_Data`. `std::invalid_argument` is thrown if the key doesn't exist
+  inline std::nullptr_t get_null(std::string_view key) const {
+    return at_key(key).get_null();
+  }
+  inline bool get_bool(std::string_view key) const {
+    return at_key(key).get_bool();
+  }
+  inline double get_double(std::string_view key) const {
+    return at_key(key).get_double();
+  }
+  inline int get_int(std::string_view key) const {
+    return at_key(key).get_int();
+  }
+  inline const std::string &get_string(std::string_view key) const {
+    return at_key(key).get_string();
+  }
+  inline const std::vector<JSON_Data> &get_array(std::string_view key) const {
+    return at_key(key).get_array();
+  }
+  inline const JSON_Object &get_object(std::string_view key) const {
+    return at_key(key).get_object();
+  }
+  template <typename T>
+  inline typename _JSON_const_get<T>::type get(std::string_view key) const {
+    return at_key(key).get<T>();
+  }
+  /**
+   * @brief the value of `key` as `T` with one lookup and no exception, see
+   * `JSON_Data::try_get`. It is empty if the key doesn't exist
+   *
+   * @tparam T
+   * @param key
+   * @return std::optional<T> for the scalars, `const T *` for the others
+   */
+  template <typename T>
+  inline typename _JSON_try_get<T>::type try_get(std::string_view key) const {
+    auto iter = object.find(key);
+    if (iter == object.end()) return {};
+    return iter->second.try_get<T>();
+  }
+
+  // All operator
+  inline JSON_Data &operator[](std::string_view key) {
+    auto iter = object.find(key);
+    if (iter != object.end()) return iter->second;
+    invalidate_cache();
+    return object.emplace(std::string(key), JSON_Data()).first->second;
+  }
+  // const version never adds the key, `std::invalid_argument` is thrown if
+  // it doesn't exist
+  inline const JSON_Data &operator[](std::string_view key) const {
+    return at_key(key);
+  }
+
+  /**
+   * @brief allow user to use
+   * `JSON_Object object = {{"key","value"},{"key","value"}}`
+   *
+   * @param list
+   * @return JSON_Object&
+   */
+  JSON_Object &operator=(
+      std::initializer_list<std::pair<std::string, JSON_Data>> list);
+
+  /**
+   * @brief return object's JSON string
+   *
+   * @param escape_unicode write non-ASCII chars as `\uXXXX`
+   * @return std::string
+   */
+  inline std::string to_string(bool escape_unicode = false) const {
+    std::string output_string;
+    dump(output_string, escape_unicode);
+    return output_string;
+  }
+  /**
+   * @brief append object's JSON string to `output`
+   *
+   * @param output
+   * @param escape_unicode write non-ASCII chars as `\uXXXX`
+   */
+  inline void dump(std::string &output, bool escape_unicode = false) const {
+    _JSON_STATS(_JSON_Stats_Scope scope(JSON_Stats::phase_t::SERIALIZE));
+    _JSON_STATS(scope.watch(output));
+#ifdef S2UJSON_CACHED_DUMP
+    auto &block = cache.own();
+    if (_JSON_cache_append(block, output, escape_unicode)) return;
+    std::size_t begin = output.size();
+    _JSON_Cache_Pass pass(block, true);
+#endif
+    _JSON_STATS(_JSON_Stats_Depth depth);
+    _JSON_STATS(_JSON_stats_node(value_t::OBJECT));
+    output.push_back('{');
+    for (auto &i : object) {
+      _JSON_escape_string(output, i.first, escape_unicode);
+      output.push_back(':');
+      i.second.dump(output, escape_unicode);
+#ifdef S2UJSON_CACHED_DUMP
+      pass.clean &= i.second.enter_cache(block);
+#endif
+      output.push_back(',');
+    }
+    if (output.back() == ',') output.pop_back();
+    output.push_back('}');
+#ifdef S2UJSON_CACHED_DUMP
+    pass.keep_text(output, begin, escape_unicode);
+#endif
+  }
+  /**
+   * @brief scatter-gather version of `dump`, see `JSON_Gather_Output`
+   *
+   * @param output
+   * @param escape_unicode write non-ASCII chars as `\uXXXX`
+   */
+  inline void dump(JSON_Gather_Output &output,
+                   bool escape_unicode = false) const {
+    _JSON_STATS(_JSON_Stats_Scope scope(JSON_Stats::phase_t::SERIALIZE));
+    _JSON_STATS(scope.watch(output.buffer));
+    _JSON_STATS(_JSON_Stats_Depth depth);
+    _JSON_STATS(_JSON_stats_node(value_t::OBJECT));
+    output.buffer.push_back('{');
+    for (auto &i : object) {
+      output.write_string(i.first, escape_unicode);
+      output.buffer.push_back(':');
+      i.second.dump(output, escape_unicode);
+      output.buffer.push_back(',');
+    }
+    if (output.buffer.back() == ',') output.buffer.pop_back();
+    output.buffer.push_back('}');
+  }
+
+  // All STL-like access
+  // iterator
+  inline iterator begin() {
+    return object.begin();
+  }
+  inline const_iterator begin() const { return object.cbegin(); }
+  inline const_iterator cbegin() const { return object.cbegin(); };
+  inline iterator end() {
+    return object.end();
+  }
+  inline const_iterator end() const { return object.cend(); }
+  inline const_iterator cend() const { return object.cend(); }
+  inline reverse_iterator rbegin() {
+    return object.rbegin();
+  }
+  inline const_reverse_iterator crbegin() const { return object.crbegin(); }
+  inline reverse_iterator rend() {
+    return object.rend();
+  }
+  inline const_reverse_iterator crend() const { return object.crend(); }
+  // capacity
+  inline bool empty() const { return object.empty(); }
+  inline size_t size() const { return object.size(); };
+  inline size_t max_size() const { return object.max_size(); }
+  // modifer
+  inline void clear() {
+    invalidate_cache();
+    object.clear();
+  }
+  inline size_t erase(std::string_view key) {
+    invalidate_cache();
+    auto iter = object.find(key);
+    if (iter == object.end()) return 0;
+    object.erase(iter);
+    return 1;
+  }
+  inline iterator erase(const_iterator pos) {
+    invalidate_cache();
+    return object.erase(pos);
+  }
+  // take the member at `pos` out with its node, which `insert` puts back
+  // without allocating
+  inline map_type::node_type extract(const_iterator pos) {
+    invalidate_cache();
+    return object.extract(pos);
+  }
+  inline void insert(map_type::node_type &&node) {
+    invalidate_cache();
+    object.insert(std::move(node));
+  }
+  // finder
+  inline iterator find(std::string_view key) {
+    return object.find(key);
+  }
+  inline const_iterator find(std::string_view key) const {
+    return object.find(key);
+  }
+  inline size_t count(std::string_view key) const {
+    return object.count(key);
+  }
+
+  inline bool exist(std::string_view key) const {
+    return object.find(key) != object.end();
+  }
+
+  /**
+   * @brief deep comparison, see `JSON_Data::operator==`
+   *
+   * @param other
+   * @return true
+   * @return false
+   */
+  inline bool operator==(const JSON_Object &other) const {
+    if (this == &other) return true;
+    if (size() != other.size()) return false;
+#ifdef S2UJSON_CACHED_HASH
+    std::uint64_t left = cached_hash(), right = other.cached_hash();
+    if (left != 0 && right != 0 && left != right) return false;
+#endif
+    for (auto i = object.cbegin(), j = other.object.cbegin();
+         i != object.cend(); i++, j++) {
+      if (i->first != j->first || i->second != j->second) return false;
+    }
+    return true;
+  }
+  inline bool operator!=(const JSON_Object &other) const {
+    return !operator==(other);
+  }
+  /**
+   * @brief 64-bit structural hash, see `JSON_Data::hash`
+   *
+   * @return std::uint64_t
+   */
+  inline std::uint64_t hash() const {
+#ifdef S2UJSON_CACHED_HASH
+    auto &block = cache.own();
+    std::uint64_t result = _JSON_cache_hash(block);
+    if (result != 0) return result;
+    _JSON_Cache_Pass pass(block, true);
+#endif
+    std::uint64_t seed = 0x6F626A656374ULL;  // "object"
+    for (auto &i : object) {
+      seed = _JSON_hash_bytes(seed, i.first);
+      seed = _JSON_hash_combine(seed, i.second.hash());
+#ifdef S2UJSON_CACHED_HASH
+      pass.clean &= i.second.enter_cache(block);
+#endif
+    }
+    if (seed == 0) seed = 1;
+#ifdef S2UJSON_CACHED_HASH
+    pass.keep_hash(seed);
+#endif
+    return seed;
+  }
+
+  /**
+   * @brief the heap memory held by this object, see `JSON_Data::memory_usage`
+   *
+   * @return JSON_Memory_Usage
+   */
+  JSON_Memory_Usage memory_usage() const;
+  // see `JSON_Data::shrink_to_fit`
+  void shrink_to_fit();
+
+ private:
+  inline JSON_Data &at_key(std::string_view key) {
+    auto iter = object.find(key);
+    if (iter == object.end()) {
+      throw std::invalid_argument("invalid key");
+    }
+    return iter->second;
+  }
+  inline const JSON_Data &at_key(std::string_view key) const {
+    auto iter = object.find(key);
+    if (iter == object.end()) {
+      throw std::invalid_argument("invalid key");
+    }
+    return iter->second;
+  }
+  inline void invalidate_cache() {
+#if defined(S2UJSON_CACHED_HASH) || defined(S2UJSON_CACHED_DUMP)
+    cache.changed();
+#endif
+  }
+#ifdef S2UJSON_CACHED_HASH
+  // the cached hash, 0 if there is none
+  inline std::uint64_t cached_hash() const {
+    auto *block = cache.block.load(std::memory_order_acquire);
+    return block == nullptr ? 0 : _JSON_cache_hash(*block);
+  }
+#endif
+
+  friend class JSON_Data;
+  friend class ::_JSON_Parse_Pool;
+
+ private:
+  map_type object;
+#if defined(S2UJSON_CACHED_HASH) || defined(S2UJSON_CACHED_DUMP)
+  // changes to the members reach it through their links, see
+  // `_JSON_Cache_Node`
+  _JSON_Cache_Node cache;
+#endif
+};
+
+/**
+ * @brief specified version of `get` to get the `JSON_Object` ranther than
+ * pointer
+ *
+ * @tparam
+ * @return const JSON_Object&
+ */
+template <>
+inline const JSON_Object &JSON_Data::get<JSON_Object>() {
+  return *std::get<std::shared_ptr<JSON_Object>>(data);
+}
+template <>
+inline const JSON_Object &JSON_Data::get<JSON_Object>() const {
+  return *std::get<std::shared_ptr<JSON_Object>>(data);
+}
+
 inline JSON_Data &JSON_Data::operator=(
     std::initializer_list<std::pair<std::string, JSON_Data>> list) {
-  JSON_Object object;
+  JSON_Object object;
+  for (auto i : list) {
+    object.add(i.first, i.second);
+  }
+  set(object);
+  return *this;
+}
+
+inline JSON_Data &JSON_Data::operator=(std::initializer_list<var> list) {
+  std::vector<JSON_Data> array(list.size());
+  int pos = 0;
+  for (auto i : list) {
+    array[pos++] = convert(i);
+  }
+  set(array);
+  return *this;
+}
+
+inline JSON_Data &JSON_Data::operator[](std::string_view key) {
+  if (type != value_t::OBJECT) {
+    // if not exist create one
+    set(JSON_Object());
+  }
+  return (*std::get<std::shared_ptr<JSON_Object>>(data))[key];
+}
+inline const JSON_Data &JSON_Data::operator[](std::string_view key) const {
+  return get_object()[key];
+}
+
+inline std::string JSON_Data::to_string(bool escape_unicode) const {
+  std::string output_string;
+  dump(output_string, escape_unicode);
+  return output_string;
+}
+inline void JSON_Data::dump(std::string &output, bool escape_unicode) const {
+  _JSON_STATS(_JSON_Stats_Scope scope(JSON_Stats::phase_t::SERIALIZE));
+  _JSON_STATS(scope.watch(output));
+  _JSON_STATS(if (type != value_t::OBJECT) _JSON_stats_node(type));
+  switch (type) {
+    case value_t::NULL_DATA:
+      output.append("null", 4);
+      return;
+    case value_t::TRUE:
+      output.append("true", 4);
+      return;
+    case value_t::FALSE:
+      output.append("false", 5);
+      return;
+    case value_t::NUMBER:
+      if (std::holds_alternative<int>(data)) {
+        output += std::to_string(std::get<int>(data));
+      } else if (std::holds_alternative<double>(data)) {
+        output += std::to_string(std::get<double>(data));
+      } else if (std::holds_alternative<std::int64_t>(data)) {
+        output += std::to_string(std::get<std::int64_t>(data));
+      } else if (std::holds_alternative<std::uint64_t>(data)) {
+        output += std::to_string(std::get<std::uint64_t>(data));
+      } else {
+        output += std::get<JSON_Number>(data).get_raw();
+      }
+      return;
+    case value_t::STRING:
+      _JSON_escape_string(output, std::get<std::string>(data), escape_unicode);
+      return;
+    case value_t::ARRAY:
+      array_dump(output, escape_unicode);
+      return;
+    case value_t::OBJECT:
+      std::get<std::shared_ptr<JSON_Object>>(data)->dump(output,
+                                                          escape_unicode);
+      return;
+    default:
+      throw std::invalid_argument("not implented");
+  }
+}
+inline void JSON_Data::dump(JSON_Gather_Output &output,
+                            bool escape_unicode) const {
+  switch (type) {
+    case value_t::STRING: {
+      _JSON_STATS(_JSON_Stats_Scope scope(JSON_Stats::phase_t::SERIALIZE));
+      _JSON_STATS(scope.watch(output.buffer));
+      _JSON_STATS(_JSON_stats_node(type));
+      output.write_string(std::get<std::string>(data), escape_unicode);
+      return;
+    }
+    case value_t::ARRAY: {
+      // a packed array is numbers only, so it is written to the side buffer
+      if (is_packed()) {
+        dump(output.buffer, escape_unicode);
+        return;
+      }
+      _JSON_STATS(_JSON_Stats_Scope scope(JSON_Stats::phase_t::SERIALIZE));
+      _JSON_STATS(scope.watch(output.buffer));
+      _JSON_STATS(_JSON_Stats_Depth depth);
+      _JSON_STATS(_JSON_stats_node(type));
+      output.buffer.push_back('[');
+      for (auto &i : std::get<std::vector<JSON_Data>>(data)) {
+        i.dump(output, escape_unicode);
+        output.buffer.push_back(',');
+      }
+      if (output.buffer.back() == ',') output.buffer.pop_back();
+      output.buffer.push_back(']');
+      return;
+    }
+    case value_t::OBJECT:
+      std::get<std::shared_ptr<JSON_Object>>(data)->dump(output,
+                                                          escape_unicode);
+      return;
+    default:
+      // the other values are short, they are written to the side buffer
+      dump(output.buffer, escape_unicode);
+  }
+}
+inline void JSON_Data::array_dump(std::string &output,
+                                  bool escape_unicode) const {
+#ifdef S2UJSON_CACHED_DUMP
+  auto &block = cache.own();
+  if (_JSON_cache_append(block, output, escape_unicode)) return;
+  std::size_t begin = output.size();
+  _JSON_Cache_Pass pass(block, !cache.exposed);
+#endif
+  _JSON_STATS(_JSON_Stats_Depth depth);
+  output.push_back('[');
+  if (is_packed()) {
+    get_packed().dump(output, 0, get_packed().size());
+  } else {
+    for (auto &i : std::get<std::vector<JSON_Data>>(data)) {
+      i.dump(output, escape_unicode);
+#ifdef S2UJSON_CACHED_DUMP
+      pass.clean &= i.enter_cache(block);
+#endif
+      output.push_back(',');
+    }
+  }
+  if (output.back() == ',') output.pop_back();
+  output.push_back(']');
+#ifdef S2UJSON_CACHED_DUMP
+  pass.keep_text(output, begin, escape_unicode);
+#endif
+}
+
+inline double JSON_Data::get_double() const {
+  if (std::holds_alternative<double>(data)) return std::get<double>(data);
+  if (std::holds_alternative<int>(data)) {
+    return static_cast<double>(std::get<int>(data));
+  }
+  if (std::holds_alternative<std::int64_t>(data)) {
+    return static_cast<double>(std::get<std::int64_t>(data));
+  }
+  if (std::holds_alternative<std::uint64_t>(data)) {
+    return static_cast<double>(std::get<std::uint64_t>(data));
+  }
+  return std::get<JSON_Number>(data).to_double();
+}
+inline std::int64_t JSON_Data::get_int64() const {
+  if (std::holds_alternative<std::int64_t>(data)) {
+    return std::get<std::int64_t>(data);
+  }
+  if (std::holds_alternative<int>(data)) return std::get<int>(data);
+  if (std::holds_alternative<std::uint64_t>(data)) {
+    auto number = std::get<std::uint64_t>(data);
+    if (number > static_cast<std::uint64_t>(
+                     std::numeric_limits<std::int64_t>::max())) {
+      throw std::out_of_range("number is out of range");
+    }
+    return static_cast<std::int64_t>(number);
+  }
+  if (std::holds_alternative<double>(data)) {
+    return _JSON_double_to_integer<std::int64_t>(std::get<double>(data));
+  }
+  return std::get<JSON_Number>(data).to_int64();
+}
+inline std::uint64_t JSON_Data::get_uint64() const {
+  if (std::holds_alternative<std::uint64_t>(data)) {
+    return std::get<std::uint64_t>(data);
+  }
+  if (std::holds_alternative<int>(data) ||
+      std::holds_alternative<std::int64_t>(data)) {
+    auto number = std::holds_alternative<int>(data)
+                      ? std::get<int>(data)
+                      : std::get<std::int64_t>(data);
+    if (number < 0) throw std::out_of_range("number is out of range");
+    return static_cast<std::uint64_t>(number);
+  }
+  if (std::holds_alternative<double>(data)) {
+    return _JSON_double_to_integer<std::uint64_t>(std::get<double>(data));
+  }
+  return std::get<JSON_Number>(data).to_uint64();
+}
+
+inline JSON_Data::number_key JSON_Data::get_number_key() const {
+  number_key key{false, false, 0, 0};
+  if (std::holds_alternative<int>(data) ||
+      std::holds_alternative<std::int64_t>(data)) {
+    std::int64_t number = std::holds_alternative<int>(data)
+                              ? std::get<int>(data)
+                              : std::get<std::int64_t>(data);
+    key.integral = true;
+    key.negative = number < 0;
+    // negate in unsigned, so the min value doesn't overflow
+    key.magnitude = key.negative ? 0 - static_cast<std::uint64_t>(number)
+                                 : static_cast<std::uint64_t>(number);
+    return key;
+  }
+  if (std::holds_alternative<std::uint64_t>(data)) {
+    key.integral = true;
+    key.magnitude = std::get<std::uint64_t>(data);
+    return key;
+  }
+  if (std::holds_alternative<double>(data)) {
+    key.value = std::get<double>(data);
+  } else {
+    auto &number = std::get<JSON_Number>(data);
+    auto &raw = number.get_raw();
+    if (number.is_integer()) {
+      const char *begin = raw.data() + (raw[0] == '-');
+      const char *end = raw.data() + raw.size();
+      auto [last, error] = std::from_chars(begin, end, key.magnitude);
+      if (error == std::errc() && last == end &&
+          (raw[0] != '-' || key.magnitude <= (1ULL << 63))) {
+        key.integral = true;
+        key.negative = raw[0] == '-' && key.magnitude != 0;
+        return key;
+      }
+    }
+    // too large for 64 bits, `from_chars` gives infinity with an error then
+    key.value = std::strtod(raw.c_str(), nullptr);
+  }
+  // doubles with an integer value are the same as the integer
+  double value = key.value;
+  if (value >= -9223372036854775808.0 && value < 18446744073709551616.0 &&
+      value == std::floor(value)) {
+    key.integral = true;
+    key.negative = value < 0;
+    key.magnitude = static_cast<std::uint64_t>(key.negative ? -value : value);
+  }
+  return key;
+}
+
+inline JSON_Data JSON_Data::convert(var d_var) {
+  switch (d_var.index()) {
+    case 0:
+      return JSON_Data(std::get<std::nullptr_t>(d_var));
+    case 1:
+      return JSON_Data(std::get<bool>(d_var));
+    case 2:
+      return JSON_Data(std::get<double>(d_var));
+    case 3:
+      return JSON_Data(std::get<int>(d_var));
+    case 4:
+      return JSON_Data(std::get<std::string>(d_var));
+    default:
+      throw std::invalid_argument("wrong");
+  }
+}
+
+inline JSON_Data JSON_Data::clone() const {
+  switch (type) {
+    case value_t::ARRAY: {
+      // a packed array is never changed, so it is shared
+      if (is_packed()) return *this;
+      auto &array = std::get<std::vector<JSON_Data>>(data);
+      std::vector<JSON_Data> result;
+      result.reserve(array.size());
+      for (auto &i : array) result.push_back(i.clone());
+      return JSON_Data(std::move(result));
+    }
+    case value_t::OBJECT: {
+      auto &object = *std::get<std::shared_ptr<JSON_Object>>(data);
+      JSON_Object result;
+      for (auto i = object.cbegin(); i != object.cend(); i++) {
+        result[i->first] = i->second.clone();
+      }
+      return JSON_Data(std::move(result));
+    }
+    default:
+      return *this;
+  }
+}
+
+inline bool JSON_Data::operator==(const JSON_Data &other) const {
+  if (is_boolean() || is_null()) return type == other.type;
+  if (type != other.type) return false;
+  switch (type) {
+    case value_t::NUMBER: {
+      auto left = get_number_key();
+      auto right = other.get_number_key();
+      if (left.integral != right.integral) return false;
+      if (!left.integral) return left.value == right.value;
+      return left.negative == right.negative &&
+             left.magnitude == right.magnitude;
+    }
+    case value_t::STRING:
+      return std::get<std::string>(data) == std::get<std::string>(other.data);
+    case value_t::ARRAY: {
+      if (is_packed() && other.is_packed()) {
+        return get_packed() == other.get_packed();
+      }
+      if (array_size() != other.array_size()) return false;
+      JSON_Data left_scratch, right_scratch;
+      for (std::size_t i = 0; i < array_size(); i++) {
+        if (element(i, left_scratch) != other.element(i, right_scratch)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    case value_t::OBJECT: {
+      auto &left = *std::get<std::shared_ptr<JSON_Object>>(data);
+      auto &right = *std::get<std::shared_ptr<JSON_Object>>(other.data);
+      return left == right;
+    }
+    default:
+      return false;
+  }
+}
+
+inline std::uint64_t JSON_Data::hash() const {
+#ifdef S2UJSON_CACHED_HASH
+  if (type == value_t::ARRAY) {
+    auto &block = cache.own();
+    std::uint64_t result = _JSON_cache_hash(block);
+    if (result != 0) return result;
+    _JSON_Cache_Pass pass(block, !cache.exposed);
+    result = compute_hash();
+    // the elements were hashed, which made their blocks
+    if (auto array = std::get_if<std::vector<JSON_Data>>(&data)) {
+      for (auto &i : *array) pass.clean &= i.enter_cache(block);
+    }
+    pass.keep_hash(result);
+    return result;
+  }
+#endif
+  return compute_hash();
+}
+
+inline std::uint64_t JSON_Data::compute_hash() const {
+  std::uint64_t result = 0;
+  switch (type) {
+    case value_t::NULL_DATA:
+    case value_t::TRUE:
+    case value_t::FALSE:
+      result = _JSON_hash_mix(static_cast<std::uint64_t>(type) + 1);
+      break;
+    case value_t::NUMBER: {
+      // `1` and `1.0` are equal, so both are hashed by the same key
+      auto key = get_number_key();
+      std::uint64_t bits = key.magnitude;
+      if (!key.integral) {
+        std::memcpy(&bits, &key.value, sizeof(bits));
+      }
+      result = _JSON_hash_combine(0x6E756D626572ULL,  // "number"
+                                  key.integral * 2 + key.negative);
+      result = _JSON_hash_combine(result, bits);
+      break;
+    }
+    case value_t::STRING:
+      result = _JSON_hash_bytes(0x737472696E67ULL,  // "string"
+                                std::get<std::string>(data));
+      break;
+    case value_t::ARRAY:
+      result = 0x6172726179ULL;  // "array"
+      if (is_packed()) {
+        // hashed as the numbers of a plain array, without building it
+        auto &packed = get_packed();
+        for (std::size_t i = 0; i < packed.size(); i++) {
+          result = _JSON_hash_combine(result, packed.at(i).hash());
+        }
+        break;
+      }
+      for (auto &i : std::get<std::vector<JSON_Data>>(data)) {
+        result = _JSON_hash_combine(result, i.hash());
+      }
+      break;
+    case value_t::OBJECT:
+      return std::get<std::shared_ptr<JSON_Object>>(data)->hash();
+  }
+  return result == 0 ? 1 : result;
+}
+
+/**
+ * @brief add the heap memory of `string` to `strings` and `slack`
+ *
+ */
+inline static void _JSON_string_usage(const std::string &string,
+                                      std::size_t &strings,
+                                      std::size_t &slack) {
+  // short strings are kept in the `std::string` itself
+  if (string.capacity() <= std::string().capacity()) return;
+  strings += string.size() + 1;
+  slack += string.capacity() - string.size();
+}
+inline static void _JSON_string_shrink(std::string &string) {
+  if (string.capacity() > string.size() &&
+      string.capacity() > std::string().capacity()) {
+    string.shrink_to_fit();
+  }
+}
+
+inline JSON_Data::~JSON_Data() {
+  if (type != value_t::ARRAY && type != value_t::OBJECT) return;
+  std::vector<JSON_Data> pending;
+  release_children(pending);
+  while (!pending.empty()) {
+    JSON_Data node = std::move(pending.back());
+    pending.pop_back();
+    // `node` has no arrays or objects left when it is destroyed
+    node.release_children(pending);
+  }
+}
+inline void JSON_Data::release_children(std::vector<JSON_Data> &pending) {
+  auto is_container = [](const JSON_Data &data) {
+    return data.type == value_t::ARRAY || data.type == value_t::OBJECT;
+  };
+  auto release = [&](JSON_Data &child) {
+    if (is_container(child)) pending.push_back(std::move(child));
+  };
+  if (auto array = std::get_if<std::vector<JSON_Data>>(&data)) {
+    for (auto &i : *array) release(i);
+  } else if (auto object = std::get_if<std::shared_ptr<JSON_Object>>(&data)) {
+    // a shared object is destroyed by its last owner
+    if (*object == nullptr || object->use_count() != 1) return;
+    for (auto &i : (*object)->object) release(i.second);
+  }
+}
+#if defined(S2UJSON_CACHED_HASH) || defined(S2UJSON_CACHED_DUMP)
+inline bool JSON_Data::enter_cache(_JSON_Cache_Block &parent) const {
+  _JSON_cache_link(cache.parent, &parent);
+  if (cache.exposed) return false;
+  _JSON_Cache_Block *block = nullptr;
+  if (type == value_t::ARRAY) {
+    block = cache.block.load(std::memory_order_acquire);
+  } else if (type == value_t::OBJECT) {
+    auto &object = std::get<std::shared_ptr<JSON_Object>>(data);
+    block = object->cache.block.load(std::memory_order_acquire);
+    // a shared object keeps the link to the first parent it met, the others
+    // keep no cache over it
+    if (block != nullptr && object.use_count() != 1) {
+      return _JSON_cache_claim(block->parent, &parent) &&
+             !block->tainted.load(std::memory_order_relaxed);
+    }
+  } else {
+    return true;
+  }
+  // the block is made when the node is hashed or dumped, which is done
+  // before, by the other pass if it was cached
+  if (block == nullptr) return false;
+  _JSON_cache_link(block->parent, &parent);
+  return !block->tainted.load(std::memory_order_relaxed);
+}
+inline void JSON_Data::leave_cache() noexcept {
+  auto object = std::get_if<std::shared_ptr<JSON_Object>>(&data);
+  if (object == nullptr || *object == nullptr || object->use_count() != 1) {
+    return;
+  }
+  auto *block = (*object)->cache.block.load(std::memory_order_relaxed);
+  if (block != nullptr) _JSON_cache_release(block->parent.exchange(nullptr));
+}
+#endif
+
+inline JSON_Memory_Usage JSON_Data::memory_usage() const {
+  JSON_Memory_Usage usage;
+  if (std::holds_alternative<std::string>(data)) {
+    _JSON_string_usage(std::get<std::string>(data), usage.strings,
+                       usage.slack);
+  } else if (std::holds_alternative<JSON_Number>(data)) {
+    _JSON_string_usage(std::get<JSON_Number>(data).get_raw(), usage.strings,
+                       usage.slack);
+  } else if (std::holds_alternative<std::vector<JSON_Data>>(data)) {
+    auto &array = std::get<std::vector<JSON_Data>>(data);
+    usage.nodes += array.size() * sizeof(JSON_Data);
+    usage.slack += (array.capacity() - array.size()) * sizeof(JSON_Data);
+    for (auto &i : array) usage += i.memory_usage();
+  } else if (std::holds_alternative<std::shared_ptr<JSON_Object>>(data)) {
+    // `std::make_shared` puts the counters next to the object
+    usage.overhead += sizeof(JSON_Object) + 2 * sizeof(long);
+    usage += std::get<std::shared_ptr<JSON_Object>>(data)->memory_usage();
+  } else if (is_packed()) {
+    auto &packed = get_packed();
+    usage.overhead += sizeof(JSON_Packed_Array) + 2 * sizeof(long);
+    std::visit(
+        [&usage](auto &numbers) {
+          using number_type =
+              typename std::decay_t<decltype(numbers)>::value_type;
+          usage.nodes += numbers.size() * sizeof(number_type);
+          usage.slack +=
+              (numbers.capacity() - numbers.size()) * sizeof(number_type);
+        },
+        packed.numbers);
+  }
+  return usage;
+}
+inline void JSON_Data::shrink_to_fit() {
+  // the value doesn't change, so the hash is kept
+  if (std::holds_alternative<std::string>(data)) {
+    _JSON_string_shrink(std::get<std::string>(data));
+  } else if (std::holds_alternative<JSON_Number>(data)) {
+    std::get<JSON_Number>(data).shrink_to_fit();
+  } else if (std::holds_alternative<std::vector<JSON_Data>>(data)) {
+    auto &array = std::get<std::vector<JSON_Data>>(data);
+    array.shrink_to_fit();
+    for (auto &i : array) i.shrink_to_fit();
+  } else if (std::holds_alternative<std::shared_ptr<JSON_Object>>(data)) {
+    std::get<std::shared_ptr<JSON_Object>>(data)->shrink_to_fit();
+  }
+}
+
+inline JSON_Data JSON_Packed_Array::at(std::size_t index) const {
+  if (is_integer()) return JSON_Data(std::get<1>(numbers)[index]);
+  return JSON_Data(std::get<0>(numbers)[index]);
+}
+inline std::vector<JSON_Data> JSON_Packed_Array::to_array() const {
+  std::vector<JSON_Data> result;
+  result.reserve(size());
+  for (std::size_t i = 0; i < size(); i++) result.push_back(at(i));
+  return result;
+}
+inline bool JSON_Packed_Array::operator==(
+    const JSON_Packed_Array &other) const {
+  if (size() != other.size()) return false;
+  if (numbers.index() == other.numbers.index()) {
+    return numbers == other.numbers;
+  }
+  for (std::size_t i = 0; i < size(); i++) {
+    if (at(i) != other.at(i)) return false;
+  }
+  return true;
+}
+
+inline JSON_Memory_Usage JSON_Object::memory_usage() const {
+  JSON_Memory_Usage usage;
+  for (auto &i : object) {
+    // the color and the three links of a red-black tree node
+    usage.overhead += 4 * sizeof(void *);
+    usage.keys += sizeof(std::string);
+    _JSON_string_usage(i.first, usage.keys, usage.slack);
+    usage.nodes += sizeof(JSON_Data);
+    usage += i.second.memory_usage();
+  }
+  return usage;
+}
+inline void JSON_Object::shrink_to_fit() {
+  for (auto i = object.begin(); i != object.end();) {
+    auto next = std::next(i);
+    auto &key = i->first;
+    if (key.capacity() > key.size() &&
+        key.capacity() > std::string().capacity()) {
+      // the key of a map is const, but not the key of an extracted node
+      auto node = object.extract(i);
+      _JSON_string_shrink(node.key());
+      i = object.insert(next, std::move(node));
+    }
+    i->second.shrink_to_fit();
+    i = next;
+  }
+}
+
+inline JSON_Object::JSON_Object(
+    std::initializer_list<std::pair<std::string, JSON_Data>> list) {
+  operator=(list);
+}
+
+inline JSON_Object &JSON_Object::operator=(
+    std::initializer_list<std::pair<std::string, JSON_Data>> list) {
+  invalidate_cache();
   for (auto i : list) {
-    object.add(i.first, i.second);
+    object.insert(std::make_pair(i.first, i.second));
+  }
+  return *this;
+}
+}  // namespace s2ujson
+
+namespace std {
+template <>
+struct hash<s2ujson::JSON_Data> {
+  std::size_t operator()(const s2ujson::JSON_Data &data) const {
+    return static_cast<std::size_t>(data.hash());
+  }
+};
+template <>
+struct hash<s2ujson::JSON_Object> {
+  std::size_t operator()(const s2ujson::JSON_Object &object) const {
+    return static_cast<std::size_t>(object.hash());
+  }
+};
+}  // namespace std
+
+// the max nesting of arrays and objects accepted by default
+#ifndef S2UJSON_MAX_DEPTH
+#define S2UJSON_MAX_DEPTH 1024
+#endif
+
+inline static bool _JSON_is_space(char ch) {
+  return ch == ' ' || ch == '\n' || ch == '\t' || ch == '\r';
+}
+
+namespace s2ujson {
+/**
+ * @brief options of `JSON_parse`
+ *
+ */
+struct JSON_Parse_Options {
+  // keep numbers as `JSON_Number`, the text they are parsed from, so big
+  // integers are exact and they are written back unchanged
+  bool lazy_numbers = false;
+  // keep an array of numbers as a `JSON_Packed_Array` of `double`. With
+  // `lazy_numbers`, only arrays of integers are packed, as `std::int64_t`,
+  // since the text of other numbers would be lost
+  bool packed_numbers = false;
+  // deeper input fails with `std::invalid_argument`, the parser doesn't
+  // recurse, so this only bounds the memory of its stack
+  std::size_t max_depth = S2UJSON_MAX_DEPTH;
+};
+}  // namespace s2ujson
+
+// Exception
+#define invalid_Unicode_HEX std::invalid_argument("Invalid Unicode HEX")
+#define invalid_HEX std::invalid_argument("invalid HEX")
+#define literial_true_is_not_correct \
+  std::invalid_argument("literial \"true\" is not correct")
+#define literial_false_is_not_correct \
+  std::invalid_argument("literial \"false\" is not correct")
+#define literial_null_is_not_correct \
+  std::invalid_argument("literial \"null\" is not correct")
+#define number_is_not_correct std::invalid_argument("number is not correct")
+#define invalid_unicode_surrogate \
+  std::invalid_argument("invalid unicode surrogate")
+#define invalid_string_escapestd std::invalid_argument("invalid string escape")
+#define invalid_string_char std::invalid_argument("invalid string char")
+#define miss_quotation_mark std::invalid_argument("miss quotation mark")
+#define array_is_invalid std::invalid_argument("array is invalid")
+#define object_is_invalid std::invalid_argument("object is invalid")
+#define nesting_is_too_deep std::invalid_argument("nesting is too deep")
+#define invalid_JSON_pointer std::invalid_argument("invalid JSON pointer")
+#define path_is_not_found std::invalid_argument("path is not found")
+#define patch_is_invalid std::invalid_argument("patch is invalid")
+#define patch_test_failed std::invalid_argument("patch test failed")
+#define schema_is_invalid std::invalid_argument("schema is invalid")
+#define json_is_invalid std::invalid_argument("JSON is invalid")
+#define json_does_not_match_schema \
+  std::invalid_argument("JSON doesn't match the schema")
+#define records_are_invalid std::invalid_argument("records are invalid")
+#define column_type_does_not_match \
+  std::invalid_argument("column type doesn't match")
+#define document_is_too_large std::invalid_argument("document is too large")
+#define number_is_not_finite std::invalid_argument("number is not finite")
+
+// tokenizer
+#define number_is_out_of_range std::out_of_range("stod")
+
+// classes of chars, a char can be in many of them
+enum : unsigned char {
+  _JSON_CLASS_SPACE = 1,
+  _JSON_CLASS_DIGIT = 2,
+  // the chars which can end a number
+  _JSON_CLASS_NUMBER_END = 4,
+};
+
+/**
+ * @brief the tables of the tokenizer, indexed by `unsigned char`
+ *
+ */
+struct _JSON_Tables {
+  unsigned char char_class[256] = {};
+  // the value of a hex digit, 0xFF if it is not
+  unsigned char hex[256] = {};
+
+  constexpr _JSON_Tables() {
+    for (int i = 0; i < 256; i++) hex[i] = 0xFF;
+    for (int i = 0; i < 10; i++) {
+      char_class['0' + i] |= _JSON_CLASS_DIGIT;
+      hex['0' + i] = static_cast<unsigned char>(i);
+    }
+    for (int i = 0; i < 6; i++) {
+      hex['a' + i] = hex['A' + i] = static_cast<unsigned char>(10 + i);
+    }
+    for (unsigned char ch : {' ', '\n', '\t', '\r'}) {
+      char_class[ch] |= _JSON_CLASS_SPACE | _JSON_CLASS_NUMBER_END;
+    }
+    for (unsigned char ch : {',', ']', '}', '\0'}) {
+      char_class[ch] |= _JSON_CLASS_NUMBER_END;
+    }
+  }
+};
+inline constexpr _JSON_Tables _JSON_tables{};
+
+inline static bool _JSON_is_class(char ch, unsigned char char_class) {
+  return (_JSON_tables.char_class[static_cast<unsigned char>(ch)] &
+          char_class) != 0;
+}
+
+/**
+ * @brief append `code_point` to `output` as UTF-8
+ *
+ * @tparam Output `std::string` or `_JSON_Insitu_Output`
+ * @param output
+ * @param code_point
+ */
+template <typename Output>
+inline static void _JSON_append_utf8(Output &output, unsigned int code_point) {
+  char buffer[4];
+  std::size_t size;
+  if (code_point <= 0x7F) {
+    buffer[0] = static_cast<char>(code_point);
+    size = 1;
+  } else if (code_point <= 0x7FF) {
+    buffer[0] = static_cast<char>(0xC0 | (code_point >> 6));
+    buffer[1] = static_cast<char>(0x80 | (code_point & 0x3F));
+    size = 2;
+  } else if (code_point <= 0xFFFF) {
+    buffer[0] = static_cast<char>(0xE0 | (code_point >> 12));
+    buffer[1] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    buffer[2] = static_cast<char>(0x80 | (code_point & 0x3F));
+    size = 3;
+  } else {
+    if (code_point > 0x10FFFF) throw invalid_HEX;
+    buffer[0] = static_cast<char>(0xF0 | (code_point >> 18));
+    buffer[1] = static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+    buffer[2] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    buffer[3] = static_cast<char>(0x80 | (code_point & 0x3F));
+    size = 4;
+  }
+  output.append(buffer, size);
+}
+
+/**
+ * @brief writes a decoded string over its own text, which is never shorter,
+ * with the interface of `std::string` that `_JSON_Tokenizer` uses
+ *
+ */
+struct _JSON_Insitu_Output {
+  char *iter;
+  inline void append(const char *data, std::size_t size) {
+    // nothing moves until the first escape
+    if (data != iter) std::memmove(iter, data, size);
+    iter += size;
+  }
+  inline void push_back(char ch) { *iter++ = ch; }
+};
+
+/**
+ * @brief reads the tokens of a JSON text in `[begin, end)` for the parser,
+ * which doesn't need to end with `'\0'`. Nothing is allocated except the
+ * strings it writes to.
+ *
+ */
+class _JSON_Tokenizer {
+ public:
+  _JSON_Tokenizer(const char *begin, const char *end)
+      : iter(begin), end(end) {}
+
+  inline const char *position() const { return iter; }
+  // the char at the position, `'\0'` at the end
+  inline char peek() const { return iter == end ? '\0' : *iter; }
+  inline void advance() { iter++; }
+  inline void skip_space() {
+    while (iter != end && _JSON_is_class(*iter, _JSON_CLASS_SPACE)) iter++;
+  }
+
+  // the literals are compared as a single 4 byte word
+  inline bool parse_true() {
+    if (!match_word("true")) throw literial_true_is_not_correct;
+    iter += 4;
+    return true;
+  }
+  inline bool parse_false() {
+    if (peek() != 'f' || !match_word("alse", 1)) {
+      throw literial_false_is_not_correct;
+    }
+    iter += 5;
+    return false;
+  }
+  inline std::nullptr_t parse_null() {
+    if (!match_word("null")) throw literial_null_is_not_correct;
+    iter += 4;
+    return nullptr;
+  }
+
+  /**
+   * @brief parse the string at the position into `result`, which is
+   * cleared first so its capacity is reused
+   *
+   * @param result
+   */
+  inline void parse_string(std::string &result) {
+    result.clear();
+    decode_string(result);
+  }
+  /**
+   * @brief parse the string at the position over its own text, from
+   * `output`, which is at or before the position in the same buffer
+   *
+   * @param output
+   * @return std::size_t the size of the decoded string
+   */
+  inline std::size_t parse_string_in_place(char *output) {
+    _JSON_Insitu_Output writer{output};
+    decode_string(writer);
+    return static_cast<std::size_t>(writer.iter - output);
+  }
+  /**
+   * @brief decode the string at the position and append it to `result`
+   *
+   * @tparam Output `std::string` or `_JSON_Insitu_Output`
+   * @param result
+   */
+  template <typename Output>
+  inline void decode_string(Output &result) {
+    if (peek() == '\"') iter++;
+    while (true) {
+      // the chars which need no work are copied in one go
+      std::size_t plain = _JSON_simd_plain_length(iter, end, false);
+      result.append(iter, plain);
+      iter += plain;
+      if (iter == end) throw miss_quotation_mark;
+      char ch = *iter;
+      if (ch == '\"') {
+        iter++;
+        return;
+      }
+      if (ch != '\\') throw invalid_string_char;
+      iter++;
+      switch (peek()) {
+        case '\"':
+        case '\\':
+        case '/':
+          result.push_back(*iter);
+          break;
+        case 'b':
+          result.push_back('\b');
+          break;
+        case 'f':
+          result.push_back('\f');
+          break;
+        case 'n':
+          result.push_back('\n');
+          break;
+        case 'r':
+          result.push_back('\r');
+          break;
+        case 't':
+          result.push_back('\t');
+          break;
+        case 'u': {
+          unsigned int code_point = parse_hex4(iter + 1);
+          if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+            iter += 5;
+            if (peek() != '\\') throw invalid_unicode_surrogate;
+            iter++;
+            if (peek() != 'u') throw invalid_unicode_surrogate;
+            unsigned int low = parse_hex4(iter + 1);
+            if (low < 0xDC00 || low > 0xDFFF) throw invalid_unicode_surrogate;
+            code_point =
+                (((code_point - 0xD800) << 10) | (low - 0xDC00)) + 0x10000;
+          }
+          if (code_point == 0) {
+            // the string ends at `\u0000`
+            while (iter != end && *iter != '\"') iter++;
+            if (iter == end) throw miss_quotation_mark;
+            iter++;
+            return;
+          }
+          _JSON_append_utf8(result, code_point);
+          iter += 4;
+          break;
+        }
+        default:
+          throw invalid_string_escapestd;
+      }
+      iter++;
+    }
+  }
+
+  /**
+   * @brief check the grammar of the number at the position
+   *
+   * @return const char* the end of the number
+   */
+  inline const char *scan_number() const {
+    const char *number = iter;
+    auto at = [&]() { return number == end ? '\0' : *number; };
+    auto skip_digits = [&]() {
+      while (_JSON_is_class(at(), _JSON_CLASS_DIGIT)) number++;
+    };
+    if (at() == '-') number++;
+    if (at() == '0') {
+      number++;
+    } else {
+      if (!(at() >= '1' && at() <= '9')) throw number_is_not_correct;
+      skip_digits();
+    }
+    if (at() == '.') {
+      number++;
+      if (!_JSON_is_class(at(), _JSON_CLASS_DIGIT)) throw number_is_not_correct;
+      skip_digits();
+    }
+    if (at() == 'e' || at() == 'E') {
+      number++;
+      if (at() == '+' || at() == '-') number++;
+      if (!_JSON_is_class(at(), _JSON_CLASS_DIGIT)) throw number_is_not_correct;
+      skip_digits();
+    }
+    if (!_JSON_is_class(at(), _JSON_CLASS_NUMBER_END)) {
+      throw number_is_not_correct;
+    }
+    return number;
+  }
+  /**
+   * @brief parse the number at the position as `double`, like `std::stod`
+   * does, `std::out_of_range` is thrown if it doesn't fit
+   *
+   * @return double
+   */
+  inline double parse_double() {
+    const char *number_end = scan_number();
+    double result = 0;
+    auto error = std::from_chars(iter, number_end, result).ec;
+    // `std::stod` also refuses subnormal numbers
+    if (error == std::errc::result_out_of_range ||
+        std::fpclassify(result) == FP_SUBNORMAL) {
+      throw number_is_out_of_range;
+    }
+    iter = number_end;
+    return result;
+  }
+  // the text of the number at the position
+  inline std::string_view parse_raw_number() {
+    const char *number = iter;
+    iter = scan_number();
+    return std::string_view(number, static_cast<std::size_t>(iter - number));
+  }
+
+ private:
+  inline bool match_word(const char (&word)[5], std::size_t offset = 0) {
+    if (static_cast<std::size_t>(end - iter) < 4 + offset) return false;
+    std::uint32_t text, expected;
+    std::memcpy(&text, iter + offset, 4);
+    std::memcpy(&expected, word, 4);
+    return text == expected;
+  }
+  inline unsigned int parse_hex4(const char *hex) const {
+    if (end - hex < 4) throw invalid_Unicode_HEX;
+    unsigned int result = 0;
+    for (int i = 0; i < 4; i++) {
+      unsigned char value =
+          _JSON_tables.hex[static_cast<unsigned char>(hex[i])];
+      if (value == 0xFF) throw invalid_Unicode_HEX;
+      result = (result << 4) | value;
+    }
+    return result;
+  }
+  const char *iter;
+  const char *end;
+};
+
+namespace s2ujson {
+/**
+ * @brief private function that only exist for testing
+ *
+ * @param json
+ * @return true
+ * @return false
+ */
+inline static bool JSON_parse_true(const std::string &json) {
+  _JSON_Tokenizer tokenizer(json.data(), json.data() + json.size());
+  tokenizer.skip_space();
+  return tokenizer.parse_true();
+}
+inline static bool JSON_parse_true(const std::string &&json) {
+  return JSON_parse_true(json);
+}
+/**
+ * @brief private function that only exist for testing
+ *
+ * @param json
+ * @return true
+ * @return false
+ */
+inline static bool JSON_parse_false(const std::string &json) {
+  _JSON_Tokenizer tokenizer(json.data(), json.data() + json.size());
+  tokenizer.skip_space();
+  return tokenizer.parse_false();
+}
+inline static bool JSON_parse_false(const std::string &&json) {
+  return JSON_parse_false(json);
+}
+/**
+ * @brief private function that only exist for testing
+ *
+ * @param json
+ * @return std::nullptr_t
+ */
+inline static std::nullptr_t JSON_parse_null(const std::string &json) {
+  _JSON_Tokenizer tokenizer(json.data(), json.data() + json.size());
+  tokenizer.skip_space();
+  return tokenizer.parse_null();
+}
+inline static std::nullptr_t JSON_parse_null(const std::string &&json) {
+  return JSON_parse_null(json);
+}
+/**
+ * @brief private function that only exist for testing
+ *
+ * @param json
+ * @return double
+ */
+inline static double JSON_parse_number(const std::string &json) {
+  _JSON_Tokenizer tokenizer(json.data(), json.data() + json.size());
+  return tokenizer.parse_double();
+}
+inline static double JSON_parse_number(const std::string &&json) {
+  return JSON_parse_number(json);
+}
+/**
+ * @brief private function that only exist for testing
+ *
+ * @param json
+ * @return std::string
+ */
+inline static std::string JSON_parse_string(const std::string &json) {
+  _JSON_Tokenizer tokenizer(json.data(), json.data() + json.size());
+  std::string result;
+  tokenizer.parse_string(result);
+  return result;
+}
+inline static std::string JSON_parse_string(const std::string &&json) {
+  return JSON_parse_string(json);
+}
+}  // namespace s2ujson
+
+/**
+ * @brief the kind of value which starts with a char
+ *
+ */
+enum class _JSON_value_t : unsigned char {
+  INVALID,
+  NUMBER,
+  STRING,
+  TRUE,
+  FALSE,
+  NULL_DATA,
+  ARRAY,
+  OBJECT
+};
+struct _JSON_Value_Table {
+  _JSON_value_t kind[256] = {};
+  constexpr _JSON_Value_Table() {
+    for (int i = 0; i < 10; i++) kind['0' + i] = _JSON_value_t::NUMBER;
+    kind['-'] = _JSON_value_t::NUMBER;
+    kind['\"'] = _JSON_value_t::STRING;
+    kind['t'] = _JSON_value_t::TRUE;
+    kind['f'] = _JSON_value_t::FALSE;
+    kind['n'] = _JSON_value_t::NULL_DATA;
+    kind['['] = _JSON_value_t::ARRAY;
+    kind['{'] = _JSON_value_t::OBJECT;
+  }
+};
+inline constexpr _JSON_Value_Table _JSON_value_table{};
+
+/**
+ * @brief the strings, arrays, objects and object nodes of the values given
+ * back to a `JSON_Parser`, which are used again by its next parse, so a parse
+ * of the same shape doesn't allocate
+ *
+ */
+class _JSON_Parse_Pool {
+ public:
+  using node_type = s2ujson::JSON_Object::map_type::node_type;
+
+  /**
+   * @brief keep the memory of `value` and everything in it. Objects which
+   * are shared with another value are left to their other owners
+   *
+   * @param value
+   */
+  inline void recycle(s2ujson::JSON_Data &&value) {
+    keep(value);
+    while (!work.empty()) {
+      s2ujson::JSON_Data node = std::move(work.back());
+      work.pop_back();
+      if (auto array = std::get_if<std::vector<s2ujson::JSON_Data>>(
+              &node.data)) {
+        for (auto &i : *array) keep(i);
+        array->clear();
+        arrays.push_back(std::move(*array));
+      } else if (auto object =
+                     std::get_if<std::shared_ptr<s2ujson::JSON_Object>>(
+                         &node.data)) {
+        if (*object == nullptr || object->use_count() != 1) continue;
+        auto &map = (*object)->object;
+        while (!map.empty()) {
+          node_type handle = map.extract(map.begin());
+          keep(handle.mapped());
+          handle.mapped() = s2ujson::JSON_Data();
+          nodes.push_back(std::move(handle));
+        }
+        (*object)->invalidate_cache();
+        objects.push_back(std::move(*object));
+      }
+    }
+  }
+
+  inline std::string string() { return take(strings); }
+  inline std::vector<s2ujson::JSON_Data> array() { return take(arrays); }
+  inline std::shared_ptr<s2ujson::JSON_Object> object() {
+    if (objects.empty()) return std::make_shared<s2ujson::JSON_Object>();
+    return take(objects);
+  }
+  /**
+   * @brief add `key` and `value` to `object` in a node of the pool, `key` is
+   * copied so its buffer is kept by the caller
+   *
+   * @param object
+   * @param key
+   * @param value
+   */
+  inline void add(s2ujson::JSON_Object &object, const std::string &key,
+                  s2ujson::JSON_Data &&value) {
+    if (nodes.empty()) {
+      object.object.emplace(key, std::move(value));
+      return;
+    }
+    node_type node = std::move(nodes.back());
+    nodes.pop_back();
+    node.key() = key;
+    node.mapped() = std::move(value);
+    auto result = object.object.insert(std::move(node));
+    // the first value of a key is kept, like `JSON_Object::add`
+    if (!result.inserted) {
+      recycle(std::move(result.node.mapped()));
+      result.node.mapped() = s2ujson::JSON_Data();
+      nodes.push_back(std::move(result.node));
+    }
+  }
+
+  // an object value which owns `object`
+  inline static s2ujson::JSON_Data wrap(
+      std::shared_ptr<s2ujson::JSON_Object> &&object) {
+    s2ujson::JSON_Data result;
+    result.type = s2ujson::value_t::OBJECT;
+    result.data = std::move(object);
+    return result;
+  }
+
+ private:
+  // strings are kept now, arrays and objects are emptied by `recycle`
+  inline void keep(s2ujson::JSON_Data &value) {
+    if (auto string = std::get_if<std::string>(&value.data)) {
+      string->clear();
+      strings.push_back(std::move(*string));
+    } else if (value.type == s2ujson::value_t::ARRAY ||
+               value.type == s2ujson::value_t::OBJECT) {
+      work.push_back(std::move(value));
+    }
+  }
+  template <typename T>
+  inline static T take(std::vector<T> &pool) {
+    if (pool.empty()) return T();
+    T result = std::move(pool.back());
+    pool.pop_back();
+    return result;
+  }
+
+  std::vector<std::string> strings;
+  std::vector<std::vector<s2ujson::JSON_Data>> arrays;
+  std::vector<std::shared_ptr<s2ujson::JSON_Object>> objects;
+  std::vector<node_type> nodes;
+  // the arrays and objects which are not emptied yet
+  std::vector<s2ujson::JSON_Data> work;
+};
+
+/**
+ * @brief an array or object which is open in `_JSON_parse_container`
+ *
+ */
+struct _JSON_Parse_Frame {
+  bool is_object = false;
+  // a `,` is read, so a value must follow
+  bool after_comma = false;
+  std::size_t count = 0;
+  std::vector<s2ujson::JSON_Data> array;
+  std::shared_ptr<s2ujson::JSON_Object> object;
+  // the key of the value being parsed
+  std::string key;
+  // the pool of the `JSON_Parser`, if there is one
+  _JSON_Parse_Pool *pool = nullptr;
+  // an array which is packed while its values are numbers, they are kept in
+  // `doubles` or `integers` until a value of another kind is added
+  bool pack = false;
+  std::vector<double> doubles;
+  std::vector<std::int64_t> integers;
+
+  // add a number, which is packed if all the values before it are
+  template <typename T>
+  inline void add_number(T number) {
+    if (pack && array.empty()) {
+      count++;
+      if constexpr (std::is_same_v<T, double>) {
+        doubles.push_back(number);
+      } else {
+        integers.push_back(number);
+      }
+    } else {
+      add(s2ujson::JSON_Data(number));
+    }
+  }
+  inline void add(s2ujson::JSON_Data &&value) {
+    count++;
+    if (!is_object) {
+      if (pack) unpack();
+      array.push_back(std::move(value));
+    } else if (pool != nullptr) {
+      pool->add(*object, key, std::move(value));
+    } else {
+      object->add(std::move(key), std::move(value));
+    }
+  }
+  // move the finished array or object out
+  inline s2ujson::JSON_Data take() {
+    if (is_object) {
+      _JSON_STATS(_JSON_stats_object(*object));
+      return _JSON_Parse_Pool::wrap(std::move(object));
+    }
+    _JSON_STATS(_JSON_stats_node(s2ujson::value_t::ARRAY));
+    // the buffers of the numbers stay with the frame
+    if (!doubles.empty()) {
+      s2ujson::JSON_Packed_Array packed(
+          std::vector<double>(doubles.begin(), doubles.end()));
+      doubles.clear();
+      return s2ujson::JSON_Data(std::move(packed));
+    }
+    if (!integers.empty()) {
+      s2ujson::JSON_Packed_Array packed(
+          std::vector<std::int64_t>(integers.begin(), integers.end()));
+      integers.clear();
+      return s2ujson::JSON_Data(std::move(packed));
+    }
+    _JSON_STATS(_JSON_stats_growth(array.capacity(), 0,
+                                   sizeof(s2ujson::JSON_Data)));
+    return s2ujson::JSON_Data(std::move(array));
+  }
+  // move the packed numbers to `array`, before a value of another kind
+  inline void unpack() {
+    pack = false;
+    for (auto i : doubles) array.emplace_back(i);
+    for (auto i : integers) array.emplace_back(i);
+    doubles.clear();
+    integers.clear();
+  }
+};
+
+/**
+ * @brief the frames of `_JSON_parse_container`. Each thread keeps one, so the
+ * memory of the frames is reused by every parse on the thread.
+ *
+ */
+class _JSON_Parse_Stack {
+ public:
+  _JSON_Parse_Stack() { frames.reserve(32); }
+
+  /**
+   * @brief the stack of this thread, or `local` if that is already used
+   *
+   * @param local
+   * @return _JSON_Parse_Stack&
+   */
+  inline static _JSON_Parse_Stack &acquire(_JSON_Parse_Stack &local) {
+    thread_local _JSON_Parse_Stack stack;
+    if (stack.busy) return local;
+    stack.busy = true;
+    return stack;
+  }
+  inline void release() {
+    busy = false;
+    depth = 0;
+  }
+
+  inline _JSON_Parse_Frame &open(bool is_object,
+                                 const s2ujson::JSON_Parse_Options &options) {
+    if (depth >= options.max_depth) throw nesting_is_too_deep;
+    if (depth == frames.size()) frames.emplace_back();
+    auto &frame = frames[depth++];
+    _JSON_STATS(_JSON_stats_max_depth(depth));
+    frame.is_object = is_object;
+    frame.after_comma = false;
+    frame.count = 0;
+    frame.pool = pool;
+    if (!is_object) {
+      frame.pack = options.packed_numbers;
+      frame.doubles.clear();
+      frame.integers.clear();
+      frame.array.clear();
+      // the last array of this frame was moved out
+      if (pool != nullptr && frame.array.capacity() == 0) {
+        frame.array = pool->array();
+      }
+    } else if (frame.object != nullptr) {
+      frame.object->clear();
+    } else if (pool != nullptr) {
+      frame.object = pool->object();
+    } else {
+      frame.object = std::make_shared<s2ujson::JSON_Object>();
+    }
+    return frame;
+  }
+  inline _JSON_Parse_Frame &top() { return frames[depth - 1]; }
+  inline std::size_t size() const { return depth; }
+  inline void pop() { depth--; }
+
+  // the pool of the `JSON_Parser` which owns the stack
+  _JSON_Parse_Pool *pool = nullptr;
+
+ private:
+  std::vector<_JSON_Parse_Frame> frames;
+  std::size_t depth = 0;
+  bool busy = false;
+};
+
+/**
+ * @brief private function that parse the value at the position of
+ * `tokenizer` into `frame`, if it is not an array or object
+ *
+ * @param tokenizer
+ * @param frame
+ * @param options
+ * @return true if the value is an array or object, which is not parsed
+ */
+inline static bool _JSON_parse_scalar(
+    _JSON_Tokenizer &tokenizer, _JSON_Parse_Frame &frame,
+    const s2ujson::JSON_Parse_Options &options) {
+  char ch = tokenizer.peek();
+  switch (_JSON_value_table.kind[static_cast<unsigned char>(ch)]) {
+    case _JSON_value_t::ARRAY:
+    case _JSON_value_t::OBJECT:
+      return true;
+    case _JSON_value_t::STRING: {
+      std::string string = frame.pool ? frame.pool->string() : std::string();
+      tokenizer.parse_string(string);
+      _JSON_STATS(_JSON_stats_node(s2ujson::value_t::STRING));
+      _JSON_STATS(_JSON_stats_string(string));
+      frame.add(s2ujson::JSON_Data(std::move(string)));
+      return false;
+    }
+    case _JSON_value_t::TRUE:
+      frame.add(s2ujson::JSON_Data(tokenizer.parse_true()));
+      _JSON_STATS(_JSON_stats_node(s2ujson::value_t::TRUE));
+      return false;
+    case _JSON_value_t::FALSE:
+      frame.add(s2ujson::JSON_Data(tokenizer.parse_false()));
+      _JSON_STATS(_JSON_stats_node(s2ujson::value_t::FALSE));
+      return false;
+    case _JSON_value_t::NULL_DATA:
+      frame.add(s2ujson::JSON_Data(tokenizer.parse_null()));
+      _JSON_STATS(_JSON_stats_node(s2ujson::value_t::NULL_DATA));
+      return false;
+    default:
+      if (ch == '\0' || ch == ',' || ch == ']' || ch == '}') {
+        if (frame.is_object) throw object_is_invalid;
+        throw array_is_invalid;
+      }
+      if (options.lazy_numbers) {
+        std::string_view raw = tokenizer.parse_raw_number();
+        if (frame.pack) {
+          // only integers which are written back as the same text, so not
+          // `-0` and those with a fraction or exponent
+          std::int64_t integer = 0;
+          auto [last, error] =
+              std::from_chars(raw.data(), raw.data() + raw.size(), integer);
+          if (error == std::errc() && last == raw.data() + raw.size() &&
+              raw != "-0") {
+            frame.add_number(integer);
+            _JSON_STATS(_JSON_stats_node(s2ujson::value_t::NUMBER));
+            return false;
+          }
+        }
+        s2ujson::JSON_Number number(raw);
+        _JSON_STATS(_JSON_stats_growth(number.get_raw().capacity(),
+                                       std::string().capacity(), 1));
+        frame.add(s2ujson::JSON_Data(std::move(number)));
+      } else {
+        frame.add_number(tokenizer.parse_double());
+      }
+      _JSON_STATS(_JSON_stats_node(s2ujson::value_t::NUMBER));
+      return false;
+  }
+}
+
+/**
+ * @brief private function that parse the `array` or `object` at the position
+ * of `tokenizer` without recursion, the open arrays and objects are kept in a
+ * `_JSON_Parse_Stack` instead of the call stack
+ *
+ * @param tokenizer
+ * @param options
+ * @param stack
+ * @return JSON_Data
+ */
+inline static s2ujson::JSON_Data _JSON_parse_container(
+    _JSON_Tokenizer &tokenizer, const s2ujson::JSON_Parse_Options &options,
+    _JSON_Parse_Stack &stack) {
+  // the stack is released when this function ends, even by an exception
+  struct release_guard {
+    _JSON_Parse_Stack &stack;
+    ~release_guard() { stack.release(); }
+  } guard{stack};
+  stack.open(tokenizer.peek() == '{', options);
+  tokenizer.advance();
+  while (true) {
+    auto *frame = &stack.top();
+    tokenizer.skip_space();
+    char ch = tokenizer.peek();
+    if (ch == (frame->is_object ? '}' : ']') && !frame->after_comma) {
+      tokenizer.advance();
+      s2ujson::JSON_Data value = frame->take();
+      stack.pop();
+      if (stack.size() == 0) return value;
+      stack.top().add(std::move(value));
+      continue;
+    }
+    if (frame->count != 0 && !frame->after_comma) {
+      if (ch != ',') {
+        if (frame->is_object) throw object_is_invalid;
+        throw array_is_invalid;
+      }
+      frame->after_comma = true;
+      tokenizer.advance();
+      continue;
+    }
+    frame->after_comma = false;
+    if (frame->is_object) {
+      if (ch != '\"') throw object_is_invalid;
+      tokenizer.parse_string(frame->key);
+      tokenizer.skip_space();
+      if (tokenizer.peek() != ':') throw object_is_invalid;
+      tokenizer.advance();
+      tokenizer.skip_space();
+    }
+    if (_JSON_parse_scalar(tokenizer, *frame, options)) {
+      stack.open(tokenizer.peek() == '{', options);
+      tokenizer.advance();
+    }
+  }
+}
+
+// parse with the stack of this thread
+inline static s2ujson::JSON_Data _JSON_parse_container(
+    _JSON_Tokenizer &tokenizer, const s2ujson::JSON_Parse_Options &options) {
+  _JSON_Parse_Stack local;
+  return _JSON_parse_container(tokenizer, options,
+                               _JSON_Parse_Stack::acquire(local));
+}
+
+/**
+ * @brief private function that parse `array` type in JSON. use
+ * `JSON_parse_array` instead
+ *
+ * @param tokenizer
+ * @param options
+ * @return std::vector<JSON_Data>
+ */
+inline static std::vector<s2ujson::JSON_Data> _JSON_parse_array(
+    _JSON_Tokenizer &tokenizer,
+    const s2ujson::JSON_Parse_Options &options = {}) {
+  if (tokenizer.peek() != '[') throw array_is_invalid;
+  return std::move(_JSON_parse_container(tokenizer, options).get_array());
+}
+namespace s2ujson {
+/**
+ * @brief parse `array` type in JSON.
+ *
+ * @param json
+ * @return std::vector<JSON_Data>
+ */
+inline static std::vector<JSON_Data> JSON_parse_array(const std::string &json) {
+  _JSON_Tokenizer tokenizer(json.data(), json.data() + json.size());
+  return _JSON_parse_array(tokenizer);
+}
+inline static std::vector<JSON_Data> JSON_parse_array(
+    const std::string &&json) {
+  return JSON_parse_array(json);
+}
+}  // namespace s2ujson
+/**
+ * @brief private function that parse `object` type in JSON. use
+ * `JSON_parse_object` instead
+ *
+ * @param tokenizer
+ * @param options
+ * @return JSON_Object
+ */
+inline static s2ujson::JSON_Object _JSON_parse_object(
+    _JSON_Tokenizer &tokenizer,
+    const s2ujson::JSON_Parse_Options &options = {}) {
+  tokenizer.skip_space();
+  if (tokenizer.peek() != '{') throw object_is_invalid;
+  return std::move(_JSON_parse_container(tokenizer, options).get_object());
+}
+namespace s2ujson {
+/**
+ * @brief parse `object` type in JSON.
+ *
+ * @param json
+ * @return JSON_Object
+ */
+inline static JSON_Object JSON_parse_object(const std::string &json) {
+  _JSON_Tokenizer tokenizer(json.data(), json.data() + json.size());
+  return _JSON_parse_object(tokenizer);
+}
+inline static JSON_Object JSON_parse_object(const std::string &&json) {
+  return JSON_parse_object(json);
+}
+}  // namespace s2ujson
+
+inline static s2ujson::JSON_Data _JSON_parse(
+    _JSON_Tokenizer &tokenizer, const s2ujson::JSON_Parse_Options &options) {
+  tokenizer.skip_space();
+  if (tokenizer.peek() != '{' && tokenizer.peek() != '[') {
+    throw array_is_invalid;
+  }
+  return _JSON_parse_container(tokenizer, options);
+}
+namespace s2ujson {
+inline static JSON_Data JSON_parse(const std::string &json,
+                                   const JSON_Parse_Options &options = {}) {
+  _JSON_STATS(_JSON_Stats_Scope scope(JSON_Stats::phase_t::PARSE));
+  _JSON_Tokenizer tokenizer(json.data(), json.data() + json.size());
+  JSON_Data result = _JSON_parse(tokenizer, options);
+  _JSON_STATS(scope.stats.bytes_consumed += tokenizer.position() - json.data());
+  return result;
+}
+
+/**
+ * @brief a parser which keeps its memory between parses. The values given
+ * back by `parse_into` are used again, so once it has parsed a document of
+ * some shape, parsing another one of the same shape doesn't allocate. A
+ * parser is not shared between threads, use one for each thread.
+ *
+ */
+class JSON_Parser {
+ public:
+  JSON_Parser() { stack.pool = &pool; }
+  JSON_Parser(const JSON_Parser &) = delete;
+  JSON_Parser &operator=(const JSON_Parser &) = delete;
+
+  /**
+   * @brief parse `json` into `result`, the old value of `result` is kept by
+   * the parser and its memory is used again
+   *
+   * @param result
+   * @param json
+   * @param options
+   */
+  inline void parse_into(JSON_Data &result, std::string_view json,
+                         const JSON_Parse_Options &options = {}) {
+    recycle(std::move(result));
+    result = JSON_Data();
+    _JSON_STATS(_JSON_Stats_Scope scope(JSON_Stats::phase_t::PARSE));
+    _JSON_Tokenizer tokenizer(json.data(), json.data() + json.size());
+    tokenizer.skip_space();
+    if (tokenizer.peek() != '{' && tokenizer.peek() != '[') {
+      throw array_is_invalid;
+    }
+    result = _JSON_parse_container(tokenizer, options, stack);
+    _JSON_STATS(scope.stats.bytes_consumed +=
+                tokenizer.position() - json.data());
+  }
+  // give the memory of `value` to the parser
+  inline void recycle(JSON_Data &&value) { pool.recycle(std::move(value)); }
+
+  friend class JSON_ArrayReader;
+
+ private:
+  // parse the value of any type at `tokenizer` into `result`
+  inline void parse_value_into(JSON_Data &result, _JSON_Tokenizer &tokenizer,
+                               const JSON_Parse_Options &options) {
+    recycle(std::move(result));
+    result = JSON_Data();
+    if (tokenizer.peek() == '{' || tokenizer.peek() == '[') {
+      result = _JSON_parse_container(tokenizer, options, stack);
+      return;
+    }
+    // a frame of one value, which keeps its capacity
+    scalar.pool = &pool;
+    scalar.array.clear();
+    _JSON_parse_scalar(tokenizer, scalar, options);
+    result = std::move(scalar.array.back());
+  }
+
+  _JSON_Parse_Pool pool;
+  _JSON_Parse_Stack stack;
+  _JSON_Parse_Frame scalar;
+};
+
+/**
+ * @brief a cursor over the elements of a top-level JSON array, which parses
+ * one element at a time. The text is a `std::string_view` (which can be a
+ * `JSON_Mapped_File`) or a `std::istream` read in chunks, so only the
+ * element being parsed is kept in memory. The storage of the previous
+ * element is used again by the next one.
+ *
+ */
+class JSON_ArrayReader {
+ public:
+  explicit JSON_ArrayReader(std::string_view json,
+                            const JSON_Parse_Options &options = {})
+      : text(json), options(options) {}
+  explicit JSON_ArrayReader(std::istream &input,
+                            const JSON_Parse_Options &options = {},
+                            std::size_t chunk_size = 1 << 16)
+      : input(&input), chunk_size(chunk_size), options(options) {}
+  JSON_ArrayReader(const JSON_ArrayReader &) = delete;
+  JSON_ArrayReader &operator=(const JSON_ArrayReader &) = delete;
+
+  /**
+   * @brief parse the next element into `element`, the old value of
+   * `element` is used again
+   *
+   * @param element
+   * @return false if the array has ended, `element` is not changed then
+   */
+  inline bool next(JSON_Data &element) {
+    if (state == state_t::END) return false;
+    char ch = skip_space();
+    if (state == state_t::BEFORE_ARRAY) {
+      if (ch != '[') throw array_is_invalid;
+      position++;
+      state = state_t::FIRST;
+      ch = skip_space();
+    }
+    if (ch == ']' && state != state_t::AFTER_COMMA) {
+      position++;
+      // only spaces can follow the array, like `JSON_validate` requires
+      if (skip_space() != '\0') throw array_is_invalid;
+      state = state_t::END;
+      return false;
+    }
+    if (state == state_t::AFTER_VALUE) {
+      if (ch != ',') throw array_is_invalid;
+      position++;
+      state = state_t::AFTER_COMMA;
+      ch = skip_space();
+    }
+    if (ch == '\0' || ch == ',' || ch == ']') throw array_is_invalid;
+    std::size_t end = scan_value();
+    _JSON_STATS(_JSON_Stats_Scope scope(JSON_Stats::phase_t::PARSE));
+    _JSON_Tokenizer tokenizer(text.data() + position, text.data() + end);
+    parser.parse_value_into(element, tokenizer, options);
+    if (tokenizer.position() != text.data() + end) throw array_is_invalid;
+    _JSON_STATS(scope.stats.bytes_consumed += end - position);
+    position = end;
+    state = state_t::AFTER_VALUE;
+    count++;
+    return true;
+  }
+  // the number of elements read
+  inline std::size_t index() const { return count; }
+
+ private:
+  enum class state_t { BEFORE_ARRAY, FIRST, AFTER_COMMA, AFTER_VALUE, END };
+
+  // the char at `position` after the spaces, `'\0'` at the end of the text
+  inline char skip_space() {
+    while (true) {
+      for (; position < text.size(); position++) {
+        if (!_JSON_is_class(text[position], _JSON_CLASS_SPACE)) {
+          return text[position];
+        }
+      }
+      if (!refill()) return '\0';
+    }
+  }
+  /**
+   * @brief find the end of the value at `position` by its brackets and
+   * quotes only, the value is checked when it is parsed
+   *
+   * @return std::size_t
+   */
+  inline std::size_t scan_value() {
+    std::size_t depth = 0;
+    bool in_string = false, escaped = false;
+    std::size_t scan = position;
+    while (true) {
+      for (; scan < text.size(); scan++) {
+        char ch = text[scan];
+        if (in_string) {
+          if (escaped) {
+            escaped = false;
+          } else if (ch == '\\') {
+            escaped = true;
+          } else if (ch == '\"') {
+            in_string = false;
+            if (depth == 0) return scan + 1;
+          }
+        } else if (ch == '\"') {
+          in_string = true;
+        } else if (ch == '[' || ch == '{') {
+          depth++;
+        } else if (ch == ']' || ch == '}') {
+          if (depth == 0) return scan;
+          if (--depth == 0) return scan + 1;
+        } else if (depth == 0 &&
+                   (ch == ',' || _JSON_is_class(ch, _JSON_CLASS_SPACE))) {
+          return scan;
+        }
+      }
+      std::size_t scanned = scan - position;
+      if (!refill()) break;
+      scan = position + scanned;
+    }
+    // only a number or literal can end with the text, the array can't
+    if (depth != 0 || in_string) throw array_is_invalid;
+    return scan;
+  }
+  // read the next chunk, the text before `position` is dropped
+  inline bool refill() {
+    if (input == nullptr || !*input) return false;
+    buffer.erase(0, position);
+    position = 0;
+    std::size_t size = buffer.size();
+    buffer.resize(size + chunk_size);
+    input->read(&buffer[size], static_cast<std::streamsize>(chunk_size));
+    buffer.resize(size + static_cast<std::size_t>(input->gcount()));
+    text = buffer;
+    return buffer.size() > size;
+  }
+
+  std::string_view text;
+  std::size_t position = 0;
+  std::istream *input = nullptr;
+  std::string buffer;
+  std::size_t chunk_size = 0;
+  state_t state = state_t::BEFORE_ARRAY;
+  std::size_t count = 0;
+  JSON_Parse_Options options;
+  JSON_Parser parser;
+};
+
+#ifdef S2UJSON_HAS_MMAP
+/**
+ * @brief a read-only file mapped into memory, `view` is valid while it lives
+ *
+ */
+class JSON_Mapped_File {
+ public:
+  explicit JSON_Mapped_File(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), path);
+    }
+    struct stat status;
+    if (::fstat(fd, &status) != 0) {
+      int error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(), path);
+    }
+    size = static_cast<std::size_t>(status.st_size);
+    if (size != 0) {
+      void *address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (address == MAP_FAILED) {
+        int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), path);
+      }
+      data = static_cast<const char *>(address);
+      // the elements are read in order
+      ::madvise(address, size, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+  }
+  ~JSON_Mapped_File() {
+    if (data != nullptr) ::munmap(const_cast<char *>(data), size);
+  }
+  JSON_Mapped_File(const JSON_Mapped_File &) = delete;
+  JSON_Mapped_File &operator=(const JSON_Mapped_File &) = delete;
+
+  inline std::string_view view() const { return std::string_view(data, size); }
+
+ private:
+  const char *data = nullptr;
+  std::size_t size = 0;
+};
+#endif
+}  // namespace s2ujson
+
+// validation
+/**
+ * @brief skip the whitespace, long runs (like indentation) are skipped 16
+ * bytes at a time
+ *
+ * @param iter
+ * @param end
+ * @return const char*
+ */
+inline static const char *_JSON_validate_skip_space(const char *iter,
+                                                    const char *end) {
+  if (iter == end || !_JSON_is_space(*iter)) return iter;
+  iter++;
+#if defined(__SSE2__)
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i line_feed = _mm_set1_epi8('\n');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i carriage_return = _mm_set1_epi8('\r');
+  for (; end - iter >= 16; iter += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(iter));
+    __m128i is_space = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, space),
+                     _mm_cmpeq_epi8(chunk, line_feed)),
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, tab),
+                     _mm_cmpeq_epi8(chunk, carriage_return)));
+    int mask = _mm_movemask_epi8(is_space) ^ 0xFFFF;
+    if (mask != 0) return iter + __builtin_ctz(mask);
+  }
+#endif
+  while (iter != end && _JSON_is_space(*iter)) iter++;
+  return iter;
+}
+
+inline static bool _JSON_validate_hex4(const char *iter, const char *end,
+                                       unsigned int &hex) {
+  if (end - iter < 4) return false;
+  hex = 0;
+  for (int i = 0; i < 4; i++) {
+    char ch = iter[i];
+    hex <<= 4;
+    if (ch >= '0' && ch <= '9') {
+      hex |= ch - '0';
+    } else if (ch >= 'a' && ch <= 'f') {
+      hex |= ch - 'a' + 10;
+    } else if (ch >= 'A' && ch <= 'F') {
+      hex |= ch - 'A' + 10;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief check a string which starts at the opening quote
+ *
+ * @param iter
+ * @param end
+ * @return const char* position after the closing quote, nullptr if invalid
+ */
+inline static const char *_JSON_validate_string(const char *iter,
+                                                const char *end) {
+  iter++;
+  while (true) {
+    iter += _JSON_simd_plain_length(iter, end);
+    if (iter == end) return nullptr;
+    unsigned char ch = static_cast<unsigned char>(*iter);
+    if (ch == '\"') return iter + 1;
+    if (ch == '\\') {
+      if (++iter == end) return nullptr;
+      switch (*iter) {
+        case '\"':
+        case '\\':
+        case '/':
+        case 'b':
+        case 'f':
+        case 'n':
+        case 'r':
+        case 't':
+          iter++;
+          break;
+        case 'u': {
+          unsigned int hex;
+          if (!_JSON_validate_hex4(iter + 1, end, hex)) return nullptr;
+          iter += 5;
+          if (hex >= 0xDC00 && hex <= 0xDFFF) return nullptr;
+          if (hex >= 0xD800 && hex <= 0xDBFF) {
+            if (end - iter < 2 || iter[0] != '\\' || iter[1] != 'u')
+              return nullptr;
+            if (!_JSON_validate_hex4(iter + 2, end, hex)) return nullptr;
+            if (hex < 0xDC00 || hex > 0xDFFF) return nullptr;
+            iter += 6;
+          }
+          break;
+        }
+        default:
+          return nullptr;
+      }
+    } else if (ch < 0x20) {
+      return nullptr;
+    } else {
+      int length = _JSON_utf8_sequence_length(
+          reinterpret_cast<const unsigned char *>(iter),
+          reinterpret_cast<const unsigned char *>(end));
+      if (length == 0) return nullptr;
+      iter += length;
+    }
+  }
+}
+
+/**
+ * @brief check the grammar of a number, range is not checked
+ *
+ * @param iter
+ * @param end
+ * @return const char* position after the number, nullptr if invalid
+ */
+inline static const char *_JSON_validate_number(const char *iter,
+                                                const char *end) {
+  auto is_digit = [&](const char *pos) {
+    return pos != end && *pos >= '0' && *pos <= '9';
+  };
+  if (iter != end && *iter == '-') iter++;
+  if (iter != end && *iter == '0') {
+    iter++;
+  } else {
+    if (!is_digit(iter)) return nullptr;
+    while (is_digit(iter)) iter++;
+  }
+  if (iter != end && *iter == '.') {
+    iter++;
+    if (!is_digit(iter)) return nullptr;
+    while (is_digit(iter)) iter++;
+  }
+  if (iter != end && (*iter == 'e' || *iter == 'E')) {
+    iter++;
+    if (iter != end && (*iter == '+' || *iter == '-')) iter++;
+    if (!is_digit(iter)) return nullptr;
+    while (is_digit(iter)) iter++;
+  }
+  return iter;
+}
+
+inline static const char *_JSON_validate_literal(const char *iter,
+                                                 const char *end,
+                                                 std::string_view literal) {
+  if (static_cast<std::size_t>(end - iter) < literal.size() ||
+      std::string_view(iter, literal.size()) != literal) {
+    return nullptr;
+  }
+  return iter + literal.size();
+}
+
+/**
+ * @brief walk through a JSON text and report each token to `handler`, which is
+ * the grammar part shared by validating and reformatting.
+ * @details `handler` needs
+ * - `bool on_begin(bool is_object, bool empty)`
+ * - `bool on_end(bool is_object, bool empty)`
+ * - `bool on_key(std::string_view raw)` (raw string with quotes)
+ * - `bool on_value(std::string_view raw)` (raw string, number or literal)
+ * - `bool on_comma(bool is_object)`
+ *
+ * returning false from any of them stops the walk. Containers are tracked in a
+ * fixed bit stack of `S2UJSON_MAX_DEPTH` levels, so nothing is allocated.
+ *
+ * @tparam Handler
+ * @param json
+ * @param handler
+ * @return true if `json` is valid and the handler never stopped the walk
+ */
+template <typename Handler>
+inline static bool _JSON_walk(std::string_view json, Handler &handler) {
+  const char *iter = json.data();
+  const char *end = iter + json.size();
+  // one bit for each level, set for object and clear for array
+  std::uint64_t in_object[(S2UJSON_MAX_DEPTH + 63) / 64] = {};
+  std::size_t depth = 0;
+  auto push = [&](bool is_object) {
+    if (depth == S2UJSON_MAX_DEPTH) return false;
+    if (is_object) {
+      in_object[depth / 64] |= (std::uint64_t(1) << (depth % 64));
+    } else {
+      in_object[depth / 64] &= ~(std::uint64_t(1) << (depth % 64));
+    }
+    depth++;
+    return true;
+  };
+  auto top_is_object = [&]() {
+    return (in_object[(depth - 1) / 64] >> ((depth - 1) % 64)) & 1;
+  };
+  // parse `"key" :` inside an object
+  auto parse_key = [&]() {
+    iter = _JSON_validate_skip_space(iter, end);
+    if (iter == end || *iter != '\"') return false;
+    const char *key_begin = iter;
+    iter = _JSON_validate_string(iter, end);
+    if (iter == nullptr ||
+        !handler.on_key(std::string_view(key_begin, iter - key_begin))) {
+      return false;
+    }
+    iter = _JSON_validate_skip_space(iter, end);
+    if (iter == end || *iter != ':') return false;
+    iter++;
+    return true;
+  };
+
+  while (true) {
+    // a value is required here
+    iter = _JSON_validate_skip_space(iter, end);
+    if (iter == end) return false;
+    const char *value_begin = iter;
+    bool closed = false;
+    switch (*iter) {
+      case '{':
+      case '[': {
+        bool is_object = *iter == '{';
+        if (!push(is_object)) return false;
+        iter = _JSON_validate_skip_space(iter + 1, end);
+        bool empty = iter != end && *iter == (is_object ? '}' : ']');
+        if (!handler.on_begin(is_object, empty)) return false;
+        if (empty) {
+          iter++;
+          depth--;
+          if (!handler.on_end(is_object, true)) return false;
+          closed = true;
+        } else if (is_object && !parse_key()) {
+          return false;
+        }
+        break;
+      }
+      case '\"':
+        iter = _JSON_validate_string(iter, end);
+        closed = true;
+        break;
+      case 't':
+        iter = _JSON_validate_literal(iter, end, "true");
+        closed = true;
+        break;
+      case 'f':
+        iter = _JSON_validate_literal(iter, end, "false");
+        closed = true;
+        break;
+      case 'n':
+        iter = _JSON_validate_literal(iter, end, "null");
+        closed = true;
+        break;
+      default:
+        iter = _JSON_validate_number(iter, end);
+        closed = true;
+        break;
+    }
+    if (iter == nullptr) return false;
+    if (!closed) continue;
+    if (*value_begin != '{' && *value_begin != '[' &&
+        !handler.on_value(std::string_view(value_begin, iter - value_begin))) {
+      return false;
+    }
+
+    // a value is finished, look for `,` or the end of the containers
+    while (true) {
+      iter = _JSON_validate_skip_space(iter, end);
+      if (depth == 0) return iter == end;
+      if (iter == end) return false;
+      bool is_object = top_is_object();
+      if (*iter == ',') {
+        iter++;
+        if (!handler.on_comma(is_object)) return false;
+        if (is_object && !parse_key()) return false;
+        break;
+      }
+      if (*iter != (is_object ? '}' : ']')) return false;
+      iter++;
+      depth--;
+      if (!handler.on_end(is_object, false)) return false;
+    }
+  }
+}
+
+/**
+ * @brief handler of `_JSON_walk` which accepts everything
+ *
+ */
+struct _JSON_Validate_Handler {
+  bool on_begin(bool, bool) { return true; }
+  bool on_end(bool, bool) { return true; }
+  bool on_key(std::string_view) { return true; }
+  bool on_value(std::string_view) { return true; }
+  bool on_comma(bool) { return true; }
+};
+
+namespace s2ujson {
+/**
+ * @brief check if `json` is a valid JSON text (RFC 8259) with well-formed
+ * UTF-8, without building any `JSON_Data`.
+ * @details any value is accepted at the top level, and numbers are only
+ * checked by grammar. Nesting deeper than `S2UJSON_MAX_DEPTH` is rejected. No
+ * heap allocation is done.
+ *
+ * @param json
+ * @return true
+ * @return false
+ */
+inline static bool JSON_validate(std::string_view json) noexcept {
+  _JSON_Validate_Handler handler;
+  return _JSON_walk(json, handler);
+}
+}  // namespace s2ujson
+
+// reformat
+/**
+ * @brief handler of `_JSON_walk` which writes the tokens again with new
+ * whitespace. Output is collected in a fixed buffer and flushed to `Sink`,
+ * which is called as `sink(const char *data, std::size_t size)`
+ *
+ * @tparam Sink
+ */
+template <typename Sink>
+class _JSON_Reformat_Handler {
+ public:
+  // `indent` < 0 means minify
+  _JSON_Reformat_Handler(Sink &sink, int indent) : sink(sink), indent(indent) {}
+  ~_JSON_Reformat_Handler() { flush(); }
+
+  bool on_begin(bool is_object, bool empty) {
+    put(is_object ? '{' : '[');
+    depth++;
+    if (!empty) new_line();
+    return true;
+  }
+  bool on_end(bool is_object, bool empty) {
+    depth--;
+    if (!empty) new_line();
+    put(is_object ? '}' : ']');
+    return true;
+  }
+  bool on_key(std::string_view raw) {
+    write(raw.data(), raw.size());
+    if (indent < 0) {
+      put(':');
+    } else {
+      write(": ", 2);
+    }
+    return true;
+  }
+  bool on_value(std::string_view raw) {
+    write(raw.data(), raw.size());
+    return true;
+  }
+  bool on_comma(bool) {
+    put(',');
+    new_line();
+    return true;
+  }
+
+  inline void flush() {
+    if (size != 0) sink(static_cast<const char *>(buffer), size);
+    size = 0;
+  }
+
+ private:
+  inline void put(char ch) {
+    if (size == sizeof(buffer)) flush();
+    buffer[size++] = ch;
+  }
+  inline void write(const char *data, std::size_t length) {
+    if (length > sizeof(buffer) - size) {
+      flush();
+      if (length > sizeof(buffer)) {
+        sink(data, length);
+        return;
+      }
+    }
+    std::copy(data, data + length, buffer + size);
+    size += length;
+  }
+  inline void new_line() {
+    if (indent < 0) return;
+    put('\n');
+    for (std::size_t i = 0; i < depth * indent; i++) put(' ');
+  }
+
+  Sink &sink;
+  int indent;
+  std::size_t depth = 0;
+  std::size_t size = 0;
+  char buffer[4096];
+};
+
+template <typename Sink>
+inline static bool _JSON_reformat(std::string_view json, Sink &sink,
+                                  int indent) {
+  _JSON_Reformat_Handler<Sink> handler(sink, indent);
+  return _JSON_walk(json, handler);
+}
+
+namespace s2ujson {
+/**
+ * @brief write `json` without any whitespace to `sink`, without building any
+ * `JSON_Data`. `sink` is called as `sink(const char *data, std::size_t size)`.
+ * @details the input is validated like `JSON_validate` while being written,
+ * so if it is invalid, false is returned and the output is incomplete.
+ *
+ * @tparam Sink
+ * @param json
+ * @param sink
+ * @return true
+ * @return false
+ */
+template <typename Sink, typename = std::enable_if_t<std::is_invocable_v<
+                              Sink &, const char *, std::size_t>>>
+inline static bool JSON_minify(std::string_view json, Sink &&sink) {
+  return _JSON_reformat(json, sink, -1);
+}
+inline static bool JSON_minify(std::string_view json, std::string &output) {
+  return JSON_minify(json, [&](const char *data, std::size_t size) {
+    output.append(data, size);
+  });
+}
+inline static bool JSON_minify(std::string_view json, std::ostream &output) {
+  return JSON_minify(json, [&](const char *data, std::size_t size) {
+    output.write(data, size);
+  });
+}
+
+/**
+ * @brief write `json` to `sink` with one value per line and `indent` spaces
+ * for each level, without building any `JSON_Data`. `sink` is called as
+ * `sink(const char *data, std::size_t size)`.
+ * @details the input is validated like `JSON_validate` while being written,
+ * so if it is invalid, false is returned and the output is incomplete.
+ *
+ * @tparam Sink
+ * @param json
+ * @param sink
+ * @param indent
+ * @return true
+ * @return false
+ */
+template <typename Sink, typename = std::enable_if_t<std::is_invocable_v<
+                              Sink &, const char *, std::size_t>>>
+inline static bool JSON_prettify(std::string_view json, Sink &&sink,
+                                 int indent = 4) {
+  return _JSON_reformat(json, sink, indent < 0 ? 0 : indent);
+}
+inline static bool JSON_prettify(std::string_view json, std::string &output,
+                                 int indent = 4) {
+  return JSON_prettify(
+      json,
+      [&](const char *data, std::size_t size) { output.append(data, size); },
+      indent);
+}
+inline static bool JSON_prettify(std::string_view json, std::ostream &output,
+                                 int indent = 4) {
+  return JSON_prettify(
+      json,
+      [&](const char *data, std::size_t size) { output.write(data, size); },
+      indent);
+}
+}  // namespace s2ujson
+
+// patch
+/**
+ * @brief split a JSON Pointer (RFC 6901) into reference tokens
+ *
+ * @param pointer
+ * @return std::vector<std::string>
+ */
+inline static std::vector<std::string> _JSON_pointer_parse(
+    std::string_view pointer) {
+  std::vector<std::string> tokens;
+  if (pointer.empty()) return tokens;
+  if (pointer[0] != '/') throw invalid_JSON_pointer;
+  for (std::size_t i = 1; i <= pointer.size(); i++) {
+    if (i == 1 || pointer[i - 1] == '/') tokens.emplace_back();
+    if (i == pointer.size() || pointer[i] == '/') continue;
+    if (pointer[i] == '~') {
+      if (i + 1 == pointer.size()) throw invalid_JSON_pointer;
+      if (pointer[i + 1] == '0') {
+        tokens.back().push_back('~');
+      } else if (pointer[i + 1] == '1') {
+        tokens.back().push_back('/');
+      } else {
+        throw invalid_JSON_pointer;
+      }
+      i++;
+    } else {
+      tokens.back().push_back(pointer[i]);
+    }
+  }
+  return tokens;
+}
+
+namespace s2ujson {
+inline const JSON_Data *JSON_Data::find_pointer(std::string_view pointer,
+                                                JSON_Data *scratch) const {
+  if (!pointer.empty() && pointer[0] != '/') throw invalid_JSON_pointer;
+  const JSON_Data *current = this;
+  std::string unescaped;
+  for (std::size_t begin = 1; begin <= pointer.size();) {
+    std::size_t end = std::min(pointer.find('/', begin), pointer.size());
+    std::string_view token = pointer.substr(begin, end - begin);
+    begin = end + 1;
+    if (token.find('~') != std::string_view::npos) {
+      unescaped.clear();
+      for (std::size_t i = 0; i < token.size(); i++) {
+        if (token[i] != '~') {
+          unescaped.push_back(token[i]);
+        } else if (i + 1 < token.size() &&
+                   (token[i + 1] == '0' || token[i + 1] == '1')) {
+          unescaped.push_back(token[++i] == '0' ? '~' : '/');
+        } else {
+          throw invalid_JSON_pointer;
+        }
+      }
+      token = unescaped;
+    }
+    if (current->is_object()) {
+      auto &object = current->get_object();
+      auto iter = object.find(token);
+      if (iter == object.end()) return nullptr;
+      current = &iter->second;
+    } else if (current->is_array()) {
+      std::size_t index = 0;
+      const char *last = token.data() + token.size();
+      if (token.empty() || (token[0] == '0' && token.size() > 1)) {
+        return nullptr;
+      }
+      auto result = std::from_chars(token.data(), last, index);
+      if (result.ec != std::errc() || result.ptr != last ||
+          index >= current->array_size()) {
+        return nullptr;
+      }
+      if (!current->is_packed()) {
+        current = &current->get_array()[index];
+      } else if (scratch == nullptr) {
+        throw std::bad_variant_access();
+      } else {
+        // the elements are numbers, so nothing can follow this token
+        current = &current->element(index, *scratch);
+      }
+    } else {
+      return nullptr;
+    }
+  }
+  return current;
+}
+}  // namespace s2ujson
+
+/**
+ * @brief get the array index of a reference token, `-` means `size`
+ *
+ * @param token
+ * @param size
+ * @param allow_end if the index can be `size`, which is needed by `add`
+ * @return std::size_t
+ */
+inline static std::size_t _JSON_pointer_index(const std::string &token,
+                                              std::size_t size,
+                                              bool allow_end) {
+  std::size_t index = 0;
+  if (token == "-") {
+    index = size;
+  } else {
+    if (token.empty() || (token[0] == '0' && token.size() > 1)) {
+      throw path_is_not_found;
+    }
+    for (char ch : token) {
+      if (ch < '0' || ch > '9' || index > size) throw path_is_not_found;
+      index = index * 10 + (ch - '0');
+    }
+  }
+  if (index > size || (index == size && !allow_end)) throw path_is_not_found;
+  return index;
+}
+
+/**
+ * @brief the engine of `apply_patch` and `apply_merge_patch`.
+ * @details every change made to the document is recorded in an undo log
+ * together with the value it replaced or removed (moved out, not copied). If
+ * the patch is not committed, the destructor plays the log backwards, so the
+ * document is left untouched when an exception is thrown. Everything a
+ * change may allocate is allocated before the change, so the undo doesn't
+ * allocate or throw: a removed member keeps its map node, an array keeps the
+ * capacity of its removed elements, and the indices of the arrays on a path
+ * are kept as numbers.
+ *
+ */
+class _JSON_Patch {
+  using JSON_Data = s2ujson::JSON_Data;
+  using JSON_Object = s2ujson::JSON_Object;
+  using path_t = std::vector<std::string>;
+  using indices_t = std::vector<std::size_t>;
+
+ public:
+  _JSON_Patch(JSON_Data &document, bool move_values)
+      : document(document), move_values(move_values) {}
+  ~_JSON_Patch() {
+    for (auto i = log.rbegin(); i != log.rend(); i++) undo(*i);
+  }
+  inline void commit() { log.clear(); }
+
+  /**
+   * @brief apply an array of RFC 6902 operations
+   *
+   * @param patch
+   */
+  void apply(const JSON_Data &patch) {
+    auto array = std::get_if<std::vector<JSON_Data>>(&patch.data);
+    if (array == nullptr) throw patch_is_invalid;
+    for (auto &operation : *array) {
+      if (!operation.is_object()) throw patch_is_invalid;
+      const JSON_Object &members =
+          *std::get<std::shared_ptr<JSON_Object>>(operation.data);
+      // the operation may be shared with copies of the patch
+      bool movable = owns(move_values, operation);
+      const std::string &op = member_string(members, "op");
+      path_t path = _JSON_pointer_parse(member_string(members, "path"));
+      if (op == "add") {
+        add(path, take(member(members, "value"), movable));
+      } else if (op == "remove") {
+        remove(path, false);
+      } else if (op == "replace") {
+        replace(path, take(member(members, "value"), movable));
+      } else if (op == "move") {
+        path_t from = _JSON_pointer_parse(member_string(members, "from"));
+        if (from == path) {
+          // a no-op, but `from` must still exist
+          resolve(from, from.size());
+          continue;
+        }
+        if (from.size() < path.size() &&
+            std::equal(from.begin(), from.end(), path.begin())) {
+          throw patch_is_invalid;  // can't move a value into itself
+        }
+        JSON_Data value = remove(from, true);
+        try {
+          add(path, std::move(value));
+        } catch (...) {
+          carry = std::move(value);  // for the undo of `remove`
+          throw;
+        }
+      } else if (op == "copy") {
+        path_t from = _JSON_pointer_parse(member_string(members, "from"));
+        add(path, resolve(from, from.size()).clone());
+      } else if (op == "test") {
+        if (resolve(path, path.size()) != member(members, "value")) {
+          throw patch_test_failed;
+        }
+      } else {
+        throw patch_is_invalid;
+      }
+    }
+  }
+
+  /**
+   * @brief apply a RFC 7396 merge patch to the value at `path`
+   *
+   * @param path
+   * @param patch
+   * @param movable if the values of `patch` can be moved out
+   */
+  void merge(path_t &path, const JSON_Data &patch, bool movable) {
+    if (!patch.is_object()) {
+      replace(path, take(patch, movable));
+      return;
+    }
+    if (!resolve(path, path.size()).is_object()) replace(path, JSON_Object());
+    movable = owns(movable, patch);
+    const JSON_Object &members =
+        *std::get<std::shared_ptr<JSON_Object>>(patch.data);
+    for (auto i = members.cbegin(); i != members.cend(); i++) {
+      path.push_back(i->first);
+      bool exist = resolve(path, path.size() - 1).get_object().exist(i->first);
+      if (i->second.is_null()) {
+        if (exist) remove(path, false);
+      } else if (i->second.is_object()) {
+        if (!exist) add(path, JSON_Object());
+        merge(path, i->second, movable);
+      } else {
+        add(path, take(i->second, movable));
+      }
+      path.pop_back();
+    }
+  }
+
+ private:
+  enum class undo_t { ERASE, INSERT, REPLACE };
+  /**
+   * @brief one change to undo. `ERASE` and `REPLACE` leave the value they take
+   * out of the document in `carry`, and an `INSERT` with `from_carry` puts it
+   * back, which is how a `move` is undone without keeping a copy.
+   *
+   */
+  struct undo_entry {
+    undo_t kind;
+    path_t path;
+    // the index of each token of `path` which is in an array
+    indices_t indices;
+    JSON_Data value;
+    // the member removed from an object, with its key
+    JSON_Object::map_type::node_type node;
+    bool from_carry = false;
+  };
+
+  /**
+   * @brief find the value of the first `count` tokens of `path`
+   *
+   * @param path
+   * @param count
+   * @param indices if not null, the index of each token in an array is set
+   * @return JSON_Data&
+   */
+  JSON_Data &resolve(const path_t &path, std::size_t count,
+                     indices_t *indices = nullptr) {
+    if (indices != nullptr) indices->assign(path.size(), 0);
+    JSON_Data *current = &document;
+    for (std::size_t i = 0; i < count; i++) {
+      if (current->is_object()) {
+        auto &object = current->get_object();
+        auto iter = object.find(path[i]);
+        if (iter == object.end()) throw path_is_not_found;
+        current = &iter->second;
+      } else if (current->is_array()) {
+        auto &array = current->plain_array();
+        std::size_t index = _JSON_pointer_index(path[i], array.size(), false);
+        if (indices != nullptr) (*indices)[i] = index;
+        current = &array[index];
+      } else {
+        throw path_is_not_found;
+      }
+    }
+    return *current;
+  }
+  /**
+   * @brief the value at the first `count` tokens of the path of `entry`,
+   * which exists because the log is played backwards
+   *
+   * @param entry
+   * @param count
+   * @return JSON_Data&
+   */
+  JSON_Data &locate(const undo_entry &entry, std::size_t count) noexcept {
+    JSON_Data *current = &document;
+    for (std::size_t i = 0; i < count; i++) {
+      if (current->is_object()) {
+        current = &current->get_object().find(entry.path[i])->second;
+      } else {
+        // the arrays were made plain when the path was resolved
+        current = &current->plain_array()[entry.indices[i]];
+      }
+    }
+    return *current;
+  }
+  // the entry for a change at `path`, with room for it in the log
+  undo_entry prepare(undo_t kind, const path_t &path, indices_t &&indices) {
+    undo_entry entry{kind, path, std::move(indices), JSON_Data(), {}};
+    if (log.size() == log.capacity()) log.reserve(log.size() * 2 + 8);
+    return entry;
+  }
+
+  void add(const path_t &path, JSON_Data &&value) {
+    if (path.empty()) {
+      replace(path, std::move(value));
+      return;
+    }
+    indices_t indices;
+    JSON_Data &parent = resolve(path, path.size() - 1, &indices);
+    if (parent.is_object()) {
+      auto &object = parent.get_object();
+      auto iter = object.find(path.back());
+      if (iter != object.end()) {
+        undo_entry entry = prepare(undo_t::REPLACE, path, std::move(indices));
+        entry.value = std::move(iter->second);
+        iter->second = std::move(value);
+        log.push_back(std::move(entry));
+      } else {
+        undo_entry entry = prepare(undo_t::ERASE, path, std::move(indices));
+        JSON_Data &target = object[path.back()];
+        log.push_back(std::move(entry));
+        target = std::move(value);
+      }
+    } else if (parent.is_array()) {
+      auto &array = parent.plain_array();
+      std::size_t index = _JSON_pointer_index(path.back(), array.size(), true);
+      indices.back() = index;
+      undo_entry entry = prepare(undo_t::ERASE, path, std::move(indices));
+      // `value` is moved only if the insert succeeds
+      array.insert(array.begin() + index, std::move(value));
+      log.push_back(std::move(entry));
+    } else {
+      throw path_is_not_found;
+    }
+  }
+
+  /**
+   * @brief remove the value at `path`
+   *
+   * @param path
+   * @param take_out if the caller takes the value, otherwise it is kept in the
+   * undo log
+   * @return JSON_Data the value if `take_out`
+   */
+  JSON_Data remove(const path_t &path, bool take_out) {
+    if (path.empty()) throw patch_is_invalid;
+    indices_t indices;
+    JSON_Data &parent = resolve(path, path.size() - 1, &indices);
+    JSON_Data value;
+    if (parent.is_object()) {
+      auto &object = parent.get_object();
+      auto iter = object.find(path.back());
+      if (iter == object.end()) throw path_is_not_found;
+      undo_entry entry = prepare(undo_t::INSERT, path, std::move(indices));
+      entry.node = object.extract(iter);
+      if (take_out) value = std::move(entry.node.mapped());
+      entry.from_carry = take_out;
+      log.push_back(std::move(entry));
+    } else if (parent.is_array()) {
+      auto &array = parent.plain_array();
+      std::size_t index = _JSON_pointer_index(path.back(), array.size(), false);
+      indices.back() = index;
+      undo_entry entry = prepare(undo_t::INSERT, path, std::move(indices));
+      // the capacity is kept, so the undo inserts it without allocating
+      if (take_out) {
+        value = std::move(array[index]);
+      } else {
+        entry.value = std::move(array[index]);
+      }
+      array.erase(array.begin() + index);
+      entry.from_carry = take_out;
+      log.push_back(std::move(entry));
+    } else {
+      throw path_is_not_found;
+    }
+    return value;
+  }
+
+  void replace(const path_t &path, JSON_Data &&value) {
+    indices_t indices;
+    JSON_Data &target = resolve(path, path.size(), &indices);
+    undo_entry entry = prepare(undo_t::REPLACE, path, std::move(indices));
+    entry.value = std::move(target);
+    target = std::move(value);
+    log.push_back(std::move(entry));
+  }
+
+  void undo(undo_entry &entry) noexcept {
+    if (entry.kind == undo_t::REPLACE) {
+      JSON_Data &target = locate(entry, entry.path.size());
+      carry = std::move(target);
+      target = std::move(entry.value);
+      return;
+    }
+    JSON_Data &parent = locate(entry, entry.path.size() - 1);
+    if (parent.is_object()) {
+      auto &object = parent.get_object();
+      if (entry.kind == undo_t::ERASE) {
+        auto iter = object.find(entry.path.back());
+        carry = std::move(iter->second);
+        object.erase(iter);
+      } else {
+        if (entry.from_carry) entry.node.mapped() = std::move(carry);
+        object.insert(std::move(entry.node));
+      }
+    } else {
+      auto &array = parent.plain_array();
+      std::size_t index = entry.indices.back();
+      if (entry.kind == undo_t::ERASE) {
+        carry = std::move(array[index]);
+        array.erase(array.begin() + index);
+      } else {
+        JSON_Data &value = entry.from_carry ? carry : entry.value;
+        array.insert(array.begin() + index, std::move(value));
+      }
+    }
+  }
+
+  // a copy of a `JSON_Data` shares its objects, so an object of the patch is
+  // moved from only if nothing else holds it
+  inline static bool owns(bool movable, const JSON_Data &object) {
+    return movable &&
+           std::get<std::shared_ptr<JSON_Object>>(object.data).use_count() ==
+               1;
+  }
+  inline static JSON_Data take(const JSON_Data &value, bool movable) {
+    if (movable) return std::move(const_cast<JSON_Data &>(value));
+    return value.clone();
+  }
+  inline static const JSON_Data &member(const JSON_Object &members,
+                                        const std::string &key) {
+    auto iter = members.find(key);
+    if (iter == members.cend()) throw patch_is_invalid;
+    return iter->second;
+  }
+  inline static const std::string &member_string(const JSON_Object &members,
+                                                 const std::string &key) {
+    auto value = std::get_if<std::string>(&member(members, key).data);
+    if (value == nullptr) throw patch_is_invalid;
+    return *value;
+  }
+
+  JSON_Data &document;
+  bool move_values;
+  std::vector<undo_entry> log;
+  JSON_Data carry;
+};
+
+inline void s2ujson::JSON_Data::apply_patch(const JSON_Data &patch) {
+  _JSON_Patch engine(*this, false);
+  engine.apply(patch);
+  engine.commit();
+}
+inline void s2ujson::JSON_Data::apply_patch(JSON_Data &&patch) {
+  _JSON_Patch engine(*this, true);
+  engine.apply(patch);
+  engine.commit();
+}
+inline void s2ujson::JSON_Data::apply_merge_patch(const JSON_Data &patch) {
+  std::vector<std::string> path;
+  _JSON_Patch engine(*this, false);
+  engine.merge(path, patch, false);
+  engine.commit();
+}
+inline void s2ujson::JSON_Data::apply_merge_patch(JSON_Data &&patch) {
+  std::vector<std::string> path;
+  _JSON_Patch engine(*this, true);
+  engine.merge(path, patch, true);
+  engine.commit();
+}
+
+// diff
+/**
+ * @brief escape a reference token for a JSON Pointer (RFC 6901)
+ *
+ * @param pointer
+ * @param token
+ */
+inline static void _JSON_pointer_append(std::string &pointer,
+                                        std::string_view token) {
+  pointer.push_back('/');
+  for (char ch : token) {
+    if (ch == '~') {
+      pointer.append("~0", 2);
+    } else if (ch == '/') {
+      pointer.append("~1", 2);
+    } else {
+      pointer.push_back(ch);
+    }
+  }
+}
+
+inline static s2ujson::JSON_Data _JSON_diff_operation(const char *op,
+                                                      const std::string &path) {
+  s2ujson::JSON_Object operation;
+  operation["op"] = op;
+  operation["path"] = path;
+  return s2ujson::JSON_Data(std::move(operation));
+}
+
+/**
+ * @brief the engine of `JSON_diff`
+ *
+ */
+class _JSON_Diff {
+  using JSON_Data = s2ujson::JSON_Data;
+
+ public:
+  /**
+   * @brief append the operations turning `from` into `to` at `path`. Each
+   * node is visited once: containers are walked, only scalars are compared
+   *
+   * @param patch
+   * @param path
+   * @param from
+   * @param to
+   */
+  static void diff(std::vector<JSON_Data> &patch, std::string &path,
+                   const JSON_Data &from, const JSON_Data &to) {
+    std::size_t path_size = path.size();
+    if (from.is_object() && to.is_object()) {
+      const auto &left = from.get_object();
+      const auto &right = to.get_object();
+      // copies share the object, which is equal to itself
+      if (&left == &right) return;
+      auto i = left.cbegin();
+      auto j = right.cbegin();
+      // both are sorted by key, so walk them like a merge
+      while (i != left.cend() || j != right.cend()) {
+        if (j == right.cend() || (i != left.cend() && i->first < j->first)) {
+          _JSON_pointer_append(path, i->first);
+          patch.push_back(_JSON_diff_operation("remove", path));
+          i++;
+        } else if (i == left.cend() || j->first < i->first) {
+          _JSON_pointer_append(path, j->first);
+          patch.push_back(_JSON_diff_operation("add", path));
+          patch.back()["value"] = j->second.clone();
+          j++;
+        } else {
+          _JSON_pointer_append(path, i->first);
+          diff(patch, path, i->second, j->second);
+          i++;
+          j++;
+        }
+        path.resize(path_size);
+      }
+    } else if (from.is_array() && to.is_array()) {
+      // packed arrays have no plain array, they are read one element at a
+      // time
+      JSON_Data left_scratch, right_scratch;
+      std::size_t common = std::min(from.array_size(), to.array_size());
+      for (std::size_t i = 0; i < common; i++) {
+        path += "/" + std::to_string(i);
+        diff(patch, path, from.element(i, left_scratch),
+             to.element(i, right_scratch));
+        path.resize(path_size);
+      }
+      for (std::size_t i = common; i < to.array_size(); i++) {
+        path += "/-";
+        patch.push_back(_JSON_diff_operation("add", path));
+        patch.back()["value"] = to.element(i, right_scratch).clone();
+        path.resize(path_size);
+      }
+      for (std::size_t i = from.array_size(); i > common; i--) {
+        path += "/" + std::to_string(i - 1);
+        patch.push_back(_JSON_diff_operation("remove", path));
+        path.resize(path_size);
+      }
+    } else if (from != to) {
+      patch.push_back(_JSON_diff_operation("replace", path));
+      patch.back()["value"] = to.clone();
+    }
+  }
+};
+
+namespace s2ujson {
+/**
+ * @brief make a JSON Patch (RFC 6902) which turns `from` into `to`, so
+ * `from.apply_patch(JSON_diff(from, to))` makes `from == to`.
+ * @details both are walked once, so it takes time proportional to their
+ * size: arrays and objects are diffed member by member, and only scalars
+ * and values of different types are compared. An object shared by both is
+ * skipped.
+ *
+ * @param from
+ * @param to
+ * @return JSON_Data
+ */
+inline static JSON_Data JSON_diff(const JSON_Data &from, const JSON_Data &to) {
+  std::vector<JSON_Data> patch;
+  std::string path;
+  _JSON_Diff::diff(patch, path, from, to);
+  return JSON_Data(std::move(patch));
+}
+}  // namespace s2ujson
+
+
+// schema
+// the types of JSON Schema as bits, "number" also accepts integers
+enum : std::uint8_t {
+  _JSON_SCHEMA_NULL = 1,
+  _JSON_SCHEMA_BOOLEAN = 2,
+  _JSON_SCHEMA_INTEGER = 4,
+  _JSON_SCHEMA_NUMBER = 8,
+  _JSON_SCHEMA_STRING = 16,
+  _JSON_SCHEMA_ARRAY = 32,
+  _JSON_SCHEMA_OBJECT = 64,
+  _JSON_SCHEMA_ANY = 127
+};
+
+enum class _JSON_Schema_Format : std::uint8_t {
+  NONE,
+  DATE,
+  TIME,
+  DATE_TIME,
+  EMAIL,
+  IPV4,
+  UUID
+};
+
+// read `count` digits at `pos` of `text` into `value`
+inline static bool _JSON_format_digits(std::string_view text, std::size_t pos,
+                                       std::size_t count, int &value) {
+  if (pos + count > text.size()) return false;
+  value = 0;
+  for (std::size_t i = pos; i < pos + count; i++) {
+    if (text[i] < '0' || text[i] > '9') return false;
+    value = value * 10 + (text[i] - '0');
+  }
+  return true;
+}
+// `full-date` of RFC 3339, like 2024-02-29
+inline static bool _JSON_format_date(std::string_view text) {
+  int year, month, day;
+  if (text.size() != 10 || text[4] != '-' || text[7] != '-' ||
+      !_JSON_format_digits(text, 0, 4, year) ||
+      !_JSON_format_digits(text, 5, 2, month) ||
+      !_JSON_format_digits(text, 8, 2, day) || month < 1 || month > 12 ||
+      day < 1) {
+    return false;
+  }
+  static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+  return day <= days[month - 1] + (month == 2 && leap ? 1 : 0);
+}
+// `full-time` of RFC 3339, like 23:59:60.5+08:00
+inline static bool _JSON_format_time(std::string_view text) {
+  int hour, minute, second;
+  if (text.size() < 9 || text[2] != ':' || text[5] != ':' ||
+      !_JSON_format_digits(text, 0, 2, hour) ||
+      !_JSON_format_digits(text, 3, 2, minute) ||
+      !_JSON_format_digits(text, 6, 2, second) || hour > 23 || minute > 59 ||
+      second > 60) {
+    return false;
+  }
+  std::size_t pos = 8;
+  if (text[pos] == '.') {
+    std::size_t digits = ++pos;
+    while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') pos++;
+    if (pos == digits) return false;
+  }
+  if (pos + 1 == text.size()) return text[pos] == 'Z' || text[pos] == 'z';
+  if (pos + 6 != text.size() || (text[pos] != '+' && text[pos] != '-') ||
+      text[pos + 3] != ':' || !_JSON_format_digits(text, pos + 1, 2, hour) ||
+      !_JSON_format_digits(text, pos + 4, 2, minute)) {
+    return false;
+  }
+  return hour <= 23 && minute <= 59;
+}
+inline static bool _JSON_format_date_time(std::string_view text) {
+  return text.size() > 11 && (text[10] == 'T' || text[10] == 't') &&
+         _JSON_format_date(text.substr(0, 10)) &&
+         _JSON_format_time(text.substr(11));
+}
+// a dot-atom address of RFC 5321, quoted local parts are not accepted
+inline static bool _JSON_format_email(std::string_view text) {
+  std::size_t at = text.find('@');
+  if (at == std::string_view::npos || at == 0 || at > 64) return false;
+  std::string_view local = text.substr(0, at);
+  std::string_view domain = text.substr(at + 1);
+  if (local.front() == '.' || local.back() == '.' ||
+      local.find("..") != std::string_view::npos) {
+    return false;
+  }
+  for (char ch : local) {
+    if (!std::isalnum(static_cast<unsigned char>(ch)) &&
+        std::string_view("!#$%&'*+-/=?^_`{|}~.").find(ch) ==
+            std::string_view::npos) {
+      return false;
+    }
+  }
+  if (domain.empty() || domain.size() > 253) return false;
+  std::size_t label = 0;
+  for (std::size_t i = 0; i <= domain.size(); i++) {
+    if (i == domain.size() || domain[i] == '.') {
+      if (label == 0 || label > 63 || domain[i - 1] == '-' ||
+          domain[i - label] == '-') {
+        return false;
+      }
+      label = 0;
+    } else if (std::isalnum(static_cast<unsigned char>(domain[i])) ||
+               domain[i] == '-') {
+      label++;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+// dotted decimal, leading zeros are not accepted
+inline static bool _JSON_format_ipv4(std::string_view text) {
+  std::size_t pos = 0;
+  for (int part = 0; part < 4; part++) {
+    if (part != 0 && (pos == text.size() || text[pos++] != '.')) return false;
+    std::size_t begin = pos;
+    int value = 0;
+    while (pos < text.size() && pos - begin < 3 && text[pos] >= '0' &&
+           text[pos] <= '9') {
+      value = value * 10 + (text[pos++] - '0');
+    }
+    if (pos == begin || value > 255 ||
+        (pos - begin > 1 && text[begin] == '0')) {
+      return false;
+    }
+  }
+  return pos == text.size();
+}
+inline static bool _JSON_format_uuid(std::string_view text) {
+  if (text.size() != 36) return false;
+  for (std::size_t i = 0; i < 36; i++) {
+    if (i == 8 || i == 13 || i == 18 || i == 23) {
+      if (text[i] != '-') return false;
+    } else if (_JSON_tables.hex[static_cast<unsigned char>(text[i])] == 0xFF) {
+      return false;
+    }
+  }
+  return true;
+}
+inline static bool _JSON_check_format(_JSON_Schema_Format format,
+                                      std::string_view text) {
+  switch (format) {
+    case _JSON_Schema_Format::DATE:
+      return _JSON_format_date(text);
+    case _JSON_Schema_Format::TIME:
+      return _JSON_format_time(text);
+    case _JSON_Schema_Format::DATE_TIME:
+      return _JSON_format_date_time(text);
+    case _JSON_Schema_Format::EMAIL:
+      return _JSON_format_email(text);
+    case _JSON_Schema_Format::IPV4:
+      return _JSON_format_ipv4(text);
+    case _JSON_Schema_Format::UUID:
+      return _JSON_format_uuid(text);
+    default:
+      return true;
+  }
+}
+
+/**
+ * @brief one compiled schema of a `JSON_Schema`. Subschemas are indexes of
+ * other nodes, -1 accepts anything
+ *
+ */
+struct _JSON_Schema_Node {
+  std::uint8_t types = _JSON_SCHEMA_ANY;
+  _JSON_Schema_Format format = _JSON_Schema_Format::NONE;
+  bool has_minimum = false;
+  bool has_maximum = false;
+  bool exclusive_minimum = false;
+  bool exclusive_maximum = false;
+  double minimum = 0;
+  double maximum = 0;
+  // strings are counted in code points
+  std::size_t min_length = 0;
+  std::size_t max_length = std::numeric_limits<std::size_t>::max();
+  std::size_t min_items = 0;
+  std::size_t max_items = std::numeric_limits<std::size_t>::max();
+  std::size_t min_properties = 0;
+  std::size_t max_properties = std::numeric_limits<std::size_t>::max();
+  std::int32_t items = -1;
+  // the properties of this node, sorted by key
+  std::uint32_t properties_begin = 0;
+  std::uint32_t properties_end = 0;
+  // one bit for each required property
+  std::uint64_t required = 0;
+  std::uint32_t enum_begin = 0;
+  std::uint32_t enum_end = 0;
+  // the `enum` has arrays or objects
+  bool enum_of_containers = false;
+};
+struct _JSON_Schema_Property {
+  std::string key;
+  std::int32_t node;
+  // the bit in `_JSON_Schema_Node::required`, -1 if not required
+  int required_bit;
+};
+
+/**
+ * @brief append the canonical form of a string to `output`, in which the
+ * arrays and objects of an `enum` are compared with the walked text: `s`,
+ * the size and `:` before the bytes, so no escape is needed
+ *
+ * @param text
+ * @param output
+ */
+inline static void _JSON_schema_canonical_string(std::string_view text,
+                                                 std::string &output) {
+  char size[24];
+  auto result = std::to_chars(size, size + sizeof(size), text.size());
+  output.push_back('s');
+  output.append(size, result.ptr);
+  output.push_back(':');
+  output.append(text);
+}
+/**
+ * @brief append the canonical form of a number to `output`. Numbers which
+ * are equal by `JSON_Data::operator==` have the same form: integers are
+ * written in decimal whatever they are stored as, others as their bits
+ *
+ * @param value
+ * @param output
+ */
+inline static void _JSON_schema_canonical_number(
+    const s2ujson::JSON_Data &value, std::string &output) {
+  char digits[24];
+  if (auto magnitude = value.try_get<std::uint64_t>()) {
+    auto result = std::to_chars(digits, digits + sizeof(digits), *magnitude);
+    output.push_back('u');
+    output.append(digits, result.ptr);
+    output.push_back(';');
+  } else if (auto integer = value.try_get<std::int64_t>()) {
+    auto result = std::to_chars(digits, digits + sizeof(digits), *integer);
+    output.push_back('i');
+    output.append(digits, result.ptr);
+    output.push_back(';');
+  } else {
+    double number = value.get_double();
+    std::memcpy(digits, &number, sizeof(number));
+    output.push_back('d');
+    output.append(digits, sizeof(number));
   }
-  set(object);
-  return *this;
 }
-
-inline JSON_Data &JSON_Data::operator=(std::initializer_list<var> list) {
-  std::vector<JSON_Data> array(list.size());
-  int pos = 0;
-  for (auto i : list) {
-    array[pos++] = convert(i);
+/**
+ * @brief append the canonical form of `value` to `output`: the keys of an
+ * object are in order, so equal values have the same form
+ *
+ * @param value
+ * @param output
+ */
+inline static void _JSON_schema_canonical(const s2ujson::JSON_Data &value,
+                                          std::string &output) {
+  switch (value.get_type()) {
+    case s2ujson::value_t::NULL_DATA:
+      output.push_back('n');
+      break;
+    case s2ujson::value_t::TRUE:
+      output.push_back('t');
+      break;
+    case s2ujson::value_t::FALSE:
+      output.push_back('f');
+      break;
+    case s2ujson::value_t::NUMBER:
+      _JSON_schema_canonical_number(value, output);
+      break;
+    case s2ujson::value_t::STRING:
+      _JSON_schema_canonical_string(value.get_string(), output);
+      break;
+    case s2ujson::value_t::ARRAY: {
+      s2ujson::JSON_Data scratch;
+      output.push_back('[');
+      for (std::size_t i = 0; i < value.array_size(); i++) {
+        _JSON_schema_canonical(value.element(i, scratch), output);
+      }
+      output.push_back(']');
+      break;
+    }
+    case s2ujson::value_t::OBJECT:
+      output.push_back('{');
+      for (auto &i : value.get_object()) {
+        _JSON_schema_canonical_string(i.first, output);
+        _JSON_schema_canonical(i.second, output);
+      }
+      output.push_back('}');
+      break;
   }
-  set(array);
-  return *this;
 }
 
-inline JSON_Data &JSON_Data::operator[](std::string &key) {
-  if (type != value_t::OBJECT) {
-    // if not exist create one
-    set(JSON_Object());
+class _JSON_Schema_Handler;
+
+namespace s2ujson {
+/**
+ * @brief a compiled subset of JSON Schema: `type`, `required`, `properties`,
+ * `items` (one schema), `enum`, `minimum`, `maximum`, `exclusiveMinimum`,
+ * `exclusiveMaximum`, `minLength`, `maxLength`, `minItems`, `maxItems`,
+ * `minProperties`, `maxProperties` and `format` (`date`, `time`,
+ * `date-time`, `email`, `ipv4` and `uuid`). Other keywords are ignored.
+ * @details the schema is compiled into a flat table of nodes, so validation
+ * doesn't allocate. A value can be validated as a `JSON_Data` or as text,
+ * which is checked while it is walked, without building the data.
+ *
+ */
+class JSON_Schema {
+ public:
+  /**
+   * @brief compile `schema`, `std::invalid_argument` is thrown if it is not
+   * a valid schema of the subset. A node has at most 64 required properties
+   *
+   * @param schema
+   */
+  explicit JSON_Schema(const JSON_Data &schema) { compile(schema); }
+
+  inline bool validate(const JSON_Data &value) const {
+    return check(value, 0);
   }
-  return (*std::get<std::shared_ptr<JSON_Object>>(data))[key];
-}
-inline JSON_Data &JSON_Data::operator[](std::string &&key) {
-  return operator[](key);
+  /**
+   * @brief validate the JSON text `json` without building the data, false
+   * is also returned if it is not valid JSON. A value checked with an `enum`
+   * which has arrays or objects is written in a canonical form while it is
+   * walked, and compared with the forms made when the schema was compiled
+   *
+   * @param json
+   * @return true
+   * @return false
+   */
+  bool validate_text(std::string_view json) const;
+  /**
+   * @brief parse `json` only if it matches the schema, the data is not built
+   * otherwise. `std::invalid_argument` is thrown if it doesn't match
+   *
+   * @param json
+   * @param options
+   * @return JSON_Data
+   */
+  JSON_Data parse(std::string_view json,
+                  const JSON_Parse_Options &options = {}) const;
+
+  friend class ::_JSON_Schema_Handler;
+
+ private:
+  std::int32_t compile(const JSON_Data &schema);
+  bool check(const JSON_Data &value, std::int32_t index) const;
+  inline bool check_number(const _JSON_Schema_Node &node, double value) const {
+    if (node.has_minimum && (node.exclusive_minimum ? value <= node.minimum
+                                                    : value < node.minimum)) {
+      return false;
+    }
+    if (node.has_maximum && (node.exclusive_maximum ? value >= node.maximum
+                                                    : value > node.maximum)) {
+      return false;
+    }
+    return true;
+  }
+  inline bool check_string(const _JSON_Schema_Node &node,
+                           std::string_view value) const {
+    if (node.min_length != 0 ||
+        node.max_length != std::numeric_limits<std::size_t>::max()) {
+      // count the bytes which don't continue a UTF-8 sequence
+      std::size_t length = 0;
+      for (char ch : value) {
+        length += (static_cast<unsigned char>(ch) >> 6) != 2;
+      }
+      if (length < node.min_length || length > node.max_length) return false;
+    }
+    return _JSON_check_format(node.format, value);
+  }
+  // the property `key` of `node`, or nullptr
+  inline const _JSON_Schema_Property *find_property(
+      const _JSON_Schema_Node &node, std::string_view key) const {
+    auto begin = properties.begin() + node.properties_begin;
+    auto end = properties.begin() + node.properties_end;
+    auto iter = std::lower_bound(
+        begin, end, key,
+        [](const _JSON_Schema_Property &property, std::string_view key) {
+          return property.key < key;
+        });
+    if (iter == end || iter->key != key) return nullptr;
+    return &*iter;
+  }
+
+  std::vector<_JSON_Schema_Node> nodes;
+  std::vector<_JSON_Schema_Property> properties;
+  std::vector<JSON_Data> enums;
+  // the canonical form of each array and object in `enums`, which the text
+  // walked by `validate_text` is compared with; empty for the others
+  std::vector<std::string> enum_texts;
+};
+}  // namespace s2ujson
+
+/**
+ * @brief handler of `_JSON_walk` which checks the tokens with a
+ * `JSON_Schema`. The open arrays and objects are kept in `frames`. A value
+ * checked with an `enum` of arrays or objects is written to `canonical`,
+ * with the members of its objects in `members` until they are sorted
+ *
+ */
+class _JSON_Schema_Handler {
+ public:
+  struct frame {
+    std::int32_t node;
+    bool is_object;
+    std::size_t count;
+    // the required properties which are found
+    std::uint64_t found;
+    // the node of the value after the last key
+    std::int32_t value_node;
+    // the value is written to `canonical` from `canonical_begin`
+    bool capture;
+    std::size_t canonical_begin;
+    // the members of the object from this index of `members`
+    std::size_t members_begin;
+  };
+  // the begin and end of a member of an object in `canonical`
+  using member = std::pair<std::size_t, std::size_t>;
+
+  _JSON_Schema_Handler(const s2ujson::JSON_Schema &schema,
+                       std::vector<frame> &frames, std::string &scratch,
+                       std::string &canonical, std::vector<member> &members)
+      : schema(schema),
+        frames(frames),
+        scratch(scratch),
+        canonical(canonical),
+        members(members) {
+    frames.clear();
+    canonical.clear();
+    members.clear();
+  }
+
+  inline bool on_begin(bool is_object, bool) {
+    bool capture = capturing();
+    std::int32_t index = next_node();
+    if (index >= 0) {
+      auto &node = schema.nodes[index];
+      if (!(node.types &
+            (is_object ? _JSON_SCHEMA_OBJECT : _JSON_SCHEMA_ARRAY))) {
+        return false;
+      }
+      // only arrays and objects in an `enum` can match
+      if (node.enum_begin != node.enum_end && !node.enum_of_containers) {
+        return false;
+      }
+      capture = capture || node.enum_of_containers;
+    }
+    frames.push_back({index, is_object, 0, 0, -1, capture, canonical.size(),
+                      members.size()});
+    if (capture) canonical.push_back(is_object ? '{' : '[');
+    return true;
+  }
+  inline bool on_end(bool, bool) {
+    frame top = frames.back();
+    frames.pop_back();
+    if (top.capture && !end_canonical(top)) return false;
+    if (top.node < 0) return true;
+    auto &node = schema.nodes[top.node];
+    if (!top.is_object) {
+      return top.count >= node.min_items && top.count <= node.max_items;
+    }
+    return top.count >= node.min_properties &&
+           top.count <= node.max_properties && top.found == node.required;
+  }
+  inline bool on_key(std::string_view raw) {
+    frame &top = frames.back();
+    top.count++;
+    top.value_node = -1;
+    if (top.node < 0 && !top.capture) return true;
+    std::string_view key = unescape(raw);
+    if (top.capture) {
+      if (members.size() > top.members_begin) {
+        members.back().second = canonical.size();
+      }
+      members.push_back({canonical.size(), 0});
+      _JSON_schema_canonical_string(key, canonical);
+    }
+    if (top.node < 0) return true;
+    auto property = schema.find_property(schema.nodes[top.node], key);
+    if (property == nullptr) return true;
+    top.value_node = property->node;
+    if (property->required_bit >= 0) {
+      top.found |= std::uint64_t(1) << property->required_bit;
+    }
+    return true;
+  }
+  inline bool on_value(std::string_view raw) {
+    bool capture = capturing();
+    std::int32_t index = next_node();
+    if (index < 0 && !capture) return true;
+    std::string_view string;
+    double number = 0;
+    switch (raw[0]) {
+      case '\"':
+        string = unescape(raw);
+        if (capture) _JSON_schema_canonical_string(string, canonical);
+        break;
+      case 't':
+      case 'f':
+      case 'n':
+        if (capture) canonical.push_back(raw[0]);
+        break;
+      default: {
+        auto result = std::from_chars(raw.data(), raw.data() + raw.size(),
+                                      number);
+        if (result.ec != std::errc()) return false;
+        // the number is compared as parsed, which is a double
+        if (capture) {
+          _JSON_schema_canonical_number(s2ujson::JSON_Data(number), canonical);
+        }
+      }
+    }
+    if (index < 0) return true;
+    auto &node = schema.nodes[index];
+    switch (raw[0]) {
+      case '\"':
+        if (!(node.types & _JSON_SCHEMA_STRING) ||
+            !schema.check_string(node, string)) {
+          return false;
+        }
+        break;
+      case 't':
+      case 'f':
+        if (!(node.types & _JSON_SCHEMA_BOOLEAN)) return false;
+        break;
+      case 'n':
+        if (!(node.types & _JSON_SCHEMA_NULL)) return false;
+        break;
+      default:
+        if (!(node.types & _JSON_SCHEMA_NUMBER) &&
+            !((node.types & _JSON_SCHEMA_INTEGER) &&
+              std::floor(number) == number)) {
+          return false;
+        }
+        if (!schema.check_number(node, number)) return false;
+    }
+    if (node.enum_begin == node.enum_end) return true;
+    for (auto i = node.enum_begin; i != node.enum_end; i++) {
+      auto &value = schema.enums[i];
+      switch (value.get_type()) {
+        case s2ujson::value_t::STRING:
+          if (raw[0] == '\"' && value.get_string() == string) return true;
+          break;
+        case s2ujson::value_t::NUMBER:
+          if (raw[0] != '\"' && raw[0] != 't' && raw[0] != 'f' &&
+              raw[0] != 'n' && value.get_double() == number) {
+            return true;
+          }
+          break;
+        case s2ujson::value_t::TRUE:
+          if (raw[0] == 't') return true;
+          break;
+        case s2ujson::value_t::FALSE:
+          if (raw[0] == 'f') return true;
+          break;
+        case s2ujson::value_t::NULL_DATA:
+          if (raw[0] == 'n') return true;
+          break;
+        default:
+          break;
+      }
+    }
+    return false;
+  }
+  inline bool on_comma(bool) { return true; }
+
+ private:
+  // the value which starts now is written to `canonical`
+  inline bool capturing() const {
+    return !frames.empty() && frames.back().capture;
+  }
+  // the node of the value which starts now
+  inline std::int32_t next_node() {
+    if (frames.empty()) return 0;
+    frame &top = frames.back();
+    if (top.node < 0) return -1;
+    if (top.is_object) return top.value_node;
+    top.count++;
+    return schema.nodes[top.node].items;
+  }
+  // the key of the member of an object at `begin` of `canonical`
+  inline std::string_view member_key(std::size_t begin) const {
+    const char *data = canonical.data() + begin + 1;
+    std::size_t size = 0;
+    data = std::from_chars(data, canonical.data() + canonical.size(), size)
+               .ptr;
+    return std::string_view(data + 1, size);
+  }
+  /**
+   * @brief finish the canonical form of the array or object `top`: the
+   * members of an object are sorted by key, keeping the first value of a
+   * key like the parser does. Then it is compared with the `enum` of its
+   * node, and dropped if no outer value is written
+   *
+   * @param top
+   * @return false if it is in none of the `enum` values
+   */
+  inline bool end_canonical(const frame &top) {
+    if (top.is_object && members.size() > top.members_begin) {
+      std::size_t end = canonical.size();
+      members.back().second = end;
+      auto first = members.begin() + top.members_begin;
+      std::stable_sort(first, members.end(),
+                       [this](const member &left, const member &right) {
+                         return member_key(left.first) <
+                                member_key(right.first);
+                       });
+      // the sorted members are written after the others, then moved back
+      canonical.reserve(end + (end - top.canonical_begin));
+      for (auto i = first; i != members.end(); i++) {
+        if (i != first && member_key(i->first) == member_key((i - 1)->first)) {
+          continue;
+        }
+        canonical.append(canonical.data() + i->first, i->second - i->first);
+      }
+      canonical.erase(top.canonical_begin + 1,
+                      end - top.canonical_begin - 1);
+      members.resize(top.members_begin);
+    }
+    canonical.push_back(top.is_object ? '}' : ']');
+    bool found = true;
+    if (top.node >= 0 && schema.nodes[top.node].enum_of_containers) {
+      auto &node = schema.nodes[top.node];
+      std::string_view text(canonical.data() + top.canonical_begin,
+                            canonical.size() - top.canonical_begin);
+      found = false;
+      for (auto i = node.enum_begin; i != node.enum_end && !found; i++) {
+        found = schema.enum_texts[i] == text;
+      }
+    }
+    if (!capturing()) canonical.resize(top.canonical_begin);
+    return found;
+  }
+  // the text of a raw string, which is only copied if it has escapes
+  inline std::string_view unescape(std::string_view raw) {
+    std::string_view text = raw.substr(1, raw.size() - 2);
+    if (text.find('\\') == std::string_view::npos) return text;
+    _JSON_Tokenizer tokenizer(raw.data(), raw.data() + raw.size());
+    tokenizer.parse_string(scratch);
+    return scratch;
+  }
+
+  const s2ujson::JSON_Schema &schema;
+  std::vector<frame> &frames;
+  std::string &scratch;
+  std::string &canonical;
+  std::vector<member> &members;
+};
+
+namespace s2ujson {
+inline std::int32_t JSON_Schema::compile(const JSON_Data &schema) {
+  auto index = static_cast<std::int32_t>(nodes.size());
+  nodes.emplace_back();
+  // `true` accepts anything and `false` nothing
+  if (schema.get_type() == value_t::TRUE) return index;
+  if (schema.get_type() == value_t::FALSE) {
+    nodes[index].types = 0;
+    return index;
+  }
+  if (schema.get_type() != value_t::OBJECT) throw schema_is_invalid;
+  _JSON_Schema_Node node;
+  auto &object = schema.get_object();
+  auto type_bits = [](const JSON_Data &name) -> std::uint8_t {
+    if (name.get_type() != value_t::STRING) throw schema_is_invalid;
+    static const std::pair<const char *, std::uint8_t> names[] = {
+        {"null", _JSON_SCHEMA_NULL},     {"boolean", _JSON_SCHEMA_BOOLEAN},
+        {"integer", _JSON_SCHEMA_INTEGER}, {"number", _JSON_SCHEMA_NUMBER},
+        {"string", _JSON_SCHEMA_STRING}, {"array", _JSON_SCHEMA_ARRAY},
+        {"object", _JSON_SCHEMA_OBJECT}};
+    for (auto &i : names) {
+      if (name.get_string() == i.first) return i.second;
+    }
+    throw schema_is_invalid;
+  };
+  auto number = [](const JSON_Data &value) {
+    if (value.get_type() != value_t::NUMBER) throw schema_is_invalid;
+    return value.get_double();
+  };
+  auto size = [&](const JSON_Data &value) {
+    double result = number(value);
+    if (result < 0 || std::floor(result) != result) throw schema_is_invalid;
+    return static_cast<std::size_t>(result);
+  };
+  auto find = [&](const char *key) -> const JSON_Data * {
+    auto iter = object.find(key);
+    return iter == object.end() ? nullptr : &iter->second;
+  };
+
+  if (auto type = find("type")) {
+    if (type->get_type() == value_t::ARRAY) {
+      node.types = 0;
+      JSON_Data scratch;
+      for (std::size_t i = 0; i < type->array_size(); i++) {
+        node.types |= type_bits(type->element(i, scratch));
+      }
+    } else {
+      node.types = type_bits(*type);
+    }
+  }
+  if (auto minimum = find("minimum")) {
+    node.has_minimum = true;
+    node.minimum = number(*minimum);
+  }
+  if (auto maximum = find("maximum")) {
+    node.has_maximum = true;
+    node.maximum = number(*maximum);
+  }
+  // a number since draft 6, a flag of `minimum` and `maximum` in draft 4
+  if (auto exclusive = find("exclusiveMinimum")) {
+    if (exclusive->get_type() == value_t::NUMBER) {
+      double value = number(*exclusive);
+      if (!node.has_minimum || value >= node.minimum) node.minimum = value;
+      node.has_minimum = node.exclusive_minimum = true;
+    } else {
+      node.exclusive_minimum = exclusive->get_type() == value_t::TRUE;
+    }
+  }
+  if (auto exclusive = find("exclusiveMaximum")) {
+    if (exclusive->get_type() == value_t::NUMBER) {
+      double value = number(*exclusive);
+      if (!node.has_maximum || value <= node.maximum) node.maximum = value;
+      node.has_maximum = node.exclusive_maximum = true;
+    } else {
+      node.exclusive_maximum = exclusive->get_type() == value_t::TRUE;
+    }
+  }
+  if (auto value = find("minLength")) node.min_length = size(*value);
+  if (auto value = find("maxLength")) node.max_length = size(*value);
+  if (auto value = find("minItems")) node.min_items = size(*value);
+  if (auto value = find("maxItems")) node.max_items = size(*value);
+  if (auto value = find("minProperties")) node.min_properties = size(*value);
+  if (auto value = find("maxProperties")) node.max_properties = size(*value);
+  if (auto format = find("format")) {
+    if (format->get_type() != value_t::STRING) throw schema_is_invalid;
+    static const std::pair<const char *, _JSON_Schema_Format> formats[] = {
+        {"date", _JSON_Schema_Format::DATE},
+        {"time", _JSON_Schema_Format::TIME},
+        {"date-time", _JSON_Schema_Format::DATE_TIME},
+        {"email", _JSON_Schema_Format::EMAIL},
+        {"ipv4", _JSON_Schema_Format::IPV4},
+        {"uuid", _JSON_Schema_Format::UUID}};
+    // unknown formats are only annotations
+    for (auto &i : formats) {
+      if (format->get_string() == i.first) node.format = i.second;
+    }
+  }
+  if (auto items = find("items")) node.items = compile(*items);
+  if (auto values = find("enum")) {
+    if (values->get_type() != value_t::ARRAY) throw schema_is_invalid;
+    node.enum_begin = static_cast<std::uint32_t>(enums.size());
+    JSON_Data scratch;
+    for (std::size_t index = 0; index < values->array_size(); index++) {
+      auto &i = values->element(index, scratch);
+      enums.push_back(i);
+      enum_texts.emplace_back();
+      if (i.get_type() == value_t::ARRAY || i.get_type() == value_t::OBJECT) {
+        node.enum_of_containers = true;
+        _JSON_schema_canonical(i, enum_texts.back());
+      }
+    }
+    node.enum_end = static_cast<std::uint32_t>(enums.size());
+  }
+
+  // the subschemas are compiled first, so the properties of this node are
+  // next to each other
+  std::vector<_JSON_Schema_Property> own;
+  if (auto list = find("properties")) {
+    if (list->get_type() != value_t::OBJECT) throw schema_is_invalid;
+    for (auto &i : list->get_object()) {
+      own.push_back({i.first, compile(i.second), -1});
+    }
+  }
+  if (auto required = find("required")) {
+    if (required->get_type() != value_t::ARRAY) throw schema_is_invalid;
+    JSON_Data scratch;
+    for (std::size_t index = 0; index < required->array_size(); index++) {
+      auto &i = required->element(index, scratch);
+      if (i.get_type() != value_t::STRING) throw schema_is_invalid;
+      auto iter = std::find_if(own.begin(), own.end(), [&](auto &property) {
+        return property.key == i.get_string();
+      });
+      if (iter == own.end()) {
+        own.push_back({i.get_string(), -1, -1});
+        iter = own.end() - 1;
+      }
+      if (iter->required_bit >= 0) continue;
+      int bit = 0;
+      while (bit < 64 && ((node.required >> bit) & 1)) bit++;
+      if (bit == 64) throw schema_is_invalid;
+      iter->required_bit = bit;
+      node.required |= std::uint64_t(1) << bit;
+    }
+  }
+  std::sort(own.begin(), own.end(), [](auto &left, auto &right) {
+    return left.key < right.key;
+  });
+  node.properties_begin = static_cast<std::uint32_t>(properties.size());
+  for (auto &i : own) properties.push_back(std::move(i));
+  node.properties_end = static_cast<std::uint32_t>(properties.size());
+  nodes[index] = node;
+  return index;
 }
 
-inline std::string JSON_Data::to_string() {
-  switch (type) {
+inline bool JSON_Schema::check(const JSON_Data &value,
+                               std::int32_t index) const {
+  if (index < 0) return true;
+  auto &node = nodes[index];
+  switch (value.get_type()) {
     case value_t::NULL_DATA:
-      return "null";
+      if (!(node.types & _JSON_SCHEMA_NULL)) return false;
+      break;
     case value_t::TRUE:
-      return "true";
     case value_t::FALSE:
-      return "false";
-    case value_t::NUMBER:
-      if (std::holds_alternative<int>(data)) {
-        return std::to_string(get<int>());
-      } else {
-        return std::to_string(get<double>());
+      if (!(node.types & _JSON_SCHEMA_BOOLEAN)) return false;
+      break;
+    case value_t::NUMBER: {
+      double number = value.get_double();
+      if (!(node.types & _JSON_SCHEMA_NUMBER) &&
+          !((node.types & _JSON_SCHEMA_INTEGER) &&
+            std::floor(number) == number)) {
+        return false;
       }
+      if (!check_number(node, number)) return false;
+      break;
+    }
     case value_t::STRING:
-      return "\"" + get_string() + "\"";
-    case value_t::ARRAY:
-      return array_to_string();
-    case value_t::OBJECT:
-      return get_object().to_string();
+      if (!(node.types & _JSON_SCHEMA_STRING) ||
+          !check_string(node, value.get_string())) {
+        return false;
+      }
+      break;
+    case value_t::ARRAY: {
+      if (!(node.types & _JSON_SCHEMA_ARRAY)) return false;
+      std::size_t size = value.array_size();
+      if (size < node.min_items || size > node.max_items) return false;
+      if (node.items >= 0) {
+        JSON_Data scratch;
+        for (std::size_t i = 0; i < size; i++) {
+          if (!check(value.element(i, scratch), node.items)) return false;
+        }
+      }
+      break;
+    }
+    case value_t::OBJECT: {
+      if (!(node.types & _JSON_SCHEMA_OBJECT)) return false;
+      auto &object = value.get_object();
+      if (object.size() < node.min_properties ||
+          object.size() > node.max_properties) {
+        return false;
+      }
+      for (auto i = node.properties_begin; i != node.properties_end; i++) {
+        auto &property = properties[i];
+        auto iter = object.find(property.key);
+        if (iter == object.end()) {
+          if (property.required_bit >= 0) return false;
+        } else if (!check(iter->second, property.node)) {
+          return false;
+        }
+      }
+      break;
+    }
     default:
-      throw std::invalid_argument("not implented");
+      return false;
+  }
+  if (node.enum_begin == node.enum_end) return true;
+  for (auto i = node.enum_begin; i != node.enum_end; i++) {
+    if (enums[i] == value) return true;
+  }
+  return false;
+}
+
+inline bool JSON_Schema::validate_text(std::string_view json) const {
+  // the frames and the buffer of escaped strings are kept by the thread
+  thread_local std::vector<_JSON_Schema_Handler::frame> frames;
+  thread_local std::string scratch;
+  // the canonical forms of the values checked with an `enum` of containers
+  thread_local std::string canonical;
+  thread_local std::vector<_JSON_Schema_Handler::member> members;
+  _JSON_Schema_Handler handler(*this, frames, scratch, canonical, members);
+  return _JSON_walk(json, handler);
+}
+
+inline JSON_Data JSON_Schema::parse(std::string_view json,
+                                    const JSON_Parse_Options &options) const {
+  if (!validate_text(json)) {
+    if (!JSON_validate(json)) throw json_is_invalid;
+    throw json_does_not_match_schema;
+  }
+  _JSON_STATS(_JSON_Stats_Scope scope(JSON_Stats::phase_t::PARSE));
+  _JSON_Tokenizer tokenizer(json.data(), json.data() + json.size());
+  JSON_Data result = _JSON_parse(tokenizer, options);
+  _JSON_STATS(scope.stats.bytes_consumed += tokenizer.position() - json.data());
+  return result;
+}
+}  // namespace s2ujson
+
+
+// columns
+class _JSON_Shred_Handler;
+
+namespace s2ujson {
+/**
+ * @brief a column of `JSON_shred`, the values of one field of each record.
+ * Only the storage of `type` is used: numbers are contiguous, strings are the
+ * bytes of all of them with `offsets.size() == size() + 1`. A record without
+ * the field, or with `null`, has its bit set in `nulls`
+ *
+ */
+struct JSON_Column {
+  enum class type_t { DOUBLE, INT64, STRING, BOOLEAN };
+
+  JSON_Column(std::string path, type_t type)
+      : path(std::move(path)), type(type) {}
+
+  inline std::size_t size() const { return rows; }
+  inline bool is_null(std::size_t row) const {
+    return (nulls[row / 64] >> (row % 64)) & 1;
+  }
+  inline std::string_view get_string(std::size_t row) const {
+    return std::string_view(bytes.data() + offsets[row],
+                            offsets[row + 1] - offsets[row]);
+  }
+  // keep the capacity for the next `JSON_shred`
+  inline void clear() {
+    rows = 0;
+    doubles.clear();
+    integers.clear();
+    booleans.clear();
+    offsets.clear();
+    bytes.clear();
+    nulls.clear();
+  }
+
+  // a JSON pointer inside the record, like "/user/id"
+  std::string path;
+  type_t type;
+  std::vector<double> doubles;
+  std::vector<std::int64_t> integers;
+  std::vector<std::uint8_t> booleans;
+  std::vector<std::size_t> offsets;
+  std::string bytes;
+  std::vector<std::uint64_t> nulls;
+
+ private:
+  inline void add_row(bool null) {
+    if (rows % 64 == 0) nulls.push_back(0);
+    if (null) nulls.back() |= std::uint64_t(1) << (rows % 64);
+    rows++;
+  }
+  std::size_t rows = 0;
+
+  friend class ::_JSON_Shred_Handler;
+};
+}  // namespace s2ujson
+
+/**
+ * @brief handler of `_JSON_walk` which writes the fields of an array of
+ * objects into columns. The path of the current value is kept as a JSON
+ * pointer, which is looked up in the paths of the columns
+ *
+ */
+class _JSON_Shred_Handler {
+ public:
+  explicit _JSON_Shred_Handler(std::vector<s2ujson::JSON_Column> &columns)
+      : columns(columns) {
+    for (std::size_t i = 0; i < columns.size(); i++) {
+      columns[i].clear();
+      columns[i].offsets.push_back(0);
+      order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&](std::size_t left,
+                                               std::size_t right) {
+      return columns[left].path < columns[right].path;
+    });
+    found.resize(columns.size());
+  }
+
+  inline bool on_begin(bool is_object, bool) {
+    depth++;
+    if (depth == 1) {
+      if (is_object) throw records_are_invalid;
+    } else if (depth == 2) {
+      if (!is_object) throw records_are_invalid;
+      std::fill(found.begin(), found.end(), false);
+    } else {
+      // a value at a path can't be an array or object
+      if (open_arrays == 0 && find() != nullptr) {
+        throw column_type_does_not_match;
+      }
+      if (!is_object) open_arrays++;
+    }
+    return true;
+  }
+  inline bool on_end(bool is_object, bool) {
+    if (depth > 2 && !is_object) open_arrays--;
+    if (depth == 2) {
+      for (std::size_t i = 0; i < columns.size(); i++) {
+        if (!found[i]) add_null(columns[i]);
+      }
+      rows++;
+    }
+    depth--;
+    return true;
+  }
+  inline bool on_key(std::string_view raw) {
+    // the path of the parent, then this key escaped as in a JSON pointer
+    std::size_t level = depth - 2;
+    lengths.resize(level);
+    path.resize(level == 0 ? 0 : lengths.back());
+    path.push_back('/');
+    for (char ch : unescape(raw)) {
+      if (ch == '~') {
+        path.append("~0", 2);
+      } else if (ch == '/') {
+        path.append("~1", 2);
+      } else {
+        path.push_back(ch);
+      }
+    }
+    lengths.push_back(path.size());
+    return true;
+  }
+  inline bool on_value(std::string_view raw) {
+    if (depth < 2) throw records_are_invalid;
+    // the elements of arrays have no path
+    if (open_arrays != 0) return true;
+    auto column = find();
+    if (column == nullptr) return true;
+    if (raw[0] == 'n') {
+      add_null(*column);
+      return true;
+    }
+    switch (column->type) {
+      case s2ujson::JSON_Column::type_t::DOUBLE: {
+        double value = 0;
+        if (!is_number(raw) ||
+            std::from_chars(raw.data(), raw.data() + raw.size(), value).ec !=
+                std::errc()) {
+          throw column_type_does_not_match;
+        }
+        column->doubles.push_back(value);
+        break;
+      }
+      case s2ujson::JSON_Column::type_t::INT64: {
+        std::int64_t value = 0;
+        auto result =
+            std::from_chars(raw.data(), raw.data() + raw.size(), value);
+        if (!is_number(raw) || result.ec != std::errc() ||
+            result.ptr != raw.data() + raw.size()) {
+          // like 1.0 or 1e3
+          double number = 0;
+          if (!is_number(raw) ||
+              std::from_chars(raw.data(), raw.data() + raw.size(), number)
+                      .ec != std::errc() ||
+              std::floor(number) != number || number < -0x1p63 ||
+              number >= 0x1p63) {
+            throw column_type_does_not_match;
+          }
+          value = static_cast<std::int64_t>(number);
+        }
+        column->integers.push_back(value);
+        break;
+      }
+      case s2ujson::JSON_Column::type_t::STRING:
+        if (raw[0] != '\"') throw column_type_does_not_match;
+        column->bytes += unescape(raw);
+        column->offsets.push_back(column->bytes.size());
+        break;
+      case s2ujson::JSON_Column::type_t::BOOLEAN:
+        if (raw[0] != 't' && raw[0] != 'f') throw column_type_does_not_match;
+        column->booleans.push_back(raw[0] == 't');
+        break;
+    }
+    column->add_row(false);
+    return true;
+  }
+  inline bool on_comma(bool) { return true; }
+
+  std::size_t rows = 0;
+
+ private:
+  // the column of the current path, which is not found in this record yet
+  inline s2ujson::JSON_Column *find() {
+    auto iter = std::lower_bound(
+        order.begin(), order.end(), std::string_view(path),
+        [&](std::size_t index, std::string_view key) {
+          return columns[index].path < key;
+        });
+    if (iter == order.end() || columns[*iter].path != path) return nullptr;
+    // a repeated key keeps the first value
+    if (found[*iter]) return nullptr;
+    found[*iter] = true;
+    return &columns[*iter];
+  }
+  inline void add_null(s2ujson::JSON_Column &column) {
+    switch (column.type) {
+      case s2ujson::JSON_Column::type_t::DOUBLE:
+        column.doubles.push_back(0);
+        break;
+      case s2ujson::JSON_Column::type_t::INT64:
+        column.integers.push_back(0);
+        break;
+      case s2ujson::JSON_Column::type_t::STRING:
+        column.offsets.push_back(column.bytes.size());
+        break;
+      case s2ujson::JSON_Column::type_t::BOOLEAN:
+        column.booleans.push_back(0);
+        break;
+    }
+    column.add_row(true);
+  }
+  inline static bool is_number(std::string_view raw) {
+    return raw[0] == '-' || (raw[0] >= '0' && raw[0] <= '9');
+  }
+  inline std::string_view unescape(std::string_view raw) {
+    std::string_view text = raw.substr(1, raw.size() - 2);
+    if (text.find('\\') == std::string_view::npos) return text;
+    _JSON_Tokenizer tokenizer(raw.data(), raw.data() + raw.size());
+    tokenizer.parse_string(scratch);
+    return scratch;
+  }
+
+  std::vector<s2ujson::JSON_Column> &columns;
+  // the columns sorted by path
+  std::vector<std::size_t> order;
+  std::vector<bool> found;
+  std::size_t depth = 0;
+  std::string path;
+  // the length of `path` at each level inside the record
+  std::vector<std::size_t> lengths;
+  // the arrays inside the record which are open
+  std::size_t open_arrays = 0;
+  std::string scratch;
+};
+
+namespace s2ujson {
+/**
+ * @brief parse an array of objects straight into `columns`, without
+ * building any `JSON_Data`. Each column takes the value at its `path` in
+ * every record, the records without it get a null. The old values of the
+ * columns are cleared and their capacity is used again.
+ * @details `std::invalid_argument` is thrown if `json` is invalid, is not an
+ * array of objects or has a value which doesn't fit the type of its column.
+ * The values inside arrays of a record have no path, they are skipped
+ *
+ * @param json
+ * @param columns
+ * @return std::size_t the number of records
+ */
+inline static std::size_t JSON_shred(std::string_view json,
+                                     std::vector<JSON_Column> &columns) {
+  _JSON_Shred_Handler handler(columns);
+  if (!_JSON_walk(json, handler)) throw json_is_invalid;
+  return handler.rows;
+}
+}  // namespace s2ujson
+
+
+// static
+/**
+ * @brief a value of a `JSON_Static_Document`. The children of an array or
+ * object are `size` nodes in order from `first`, so they are indexed
+ * directly, and are linked through `next` as well. Strings and keys are
+ * ranges of the decoded chars of the document
+ *
+ */
+struct _JSON_Static_Node {
+  s2ujson::value_t type = s2ujson::value_t::NULL_DATA;
+  double number = 0;
+  std::uint32_t string = 0;
+  std::uint32_t string_size = 0;
+  // the key of a value in an object
+  std::uint32_t key = 0;
+  std::uint32_t key_size = 0;
+  std::uint32_t first = 0;
+  std::uint32_t size = 0;
+  // 0 if this is the last child, as the root can't be a child
+  std::uint32_t next = 0;
+};
+
+namespace s2ujson {
+/**
+ * @brief a read-only view of a value in a `JSON_Static_Document` or a
+ * `JSON_Insitu_Document`, with the read API of `JSON_Data`. Strings are
+ * `std::string_view`s of the document
+ *
+ */
+class JSON_Static_Value {
+ public:
+  constexpr JSON_Static_Value(const _JSON_Static_Node *nodes,
+                              const char *chars, std::uint32_t index)
+      : nodes(nodes), chars(chars), index(index) {}
+
+  constexpr const value_t &get_type() const { return node().type; }
+  constexpr bool get_null() const {
+    return check(node().type == value_t::NULL_DATA);
   }
-}
-inline std::string JSON_Data::array_to_string() {
-  std::string output_string = "[";
-  auto array = get_array();
-  for (auto i : array) {
-    output_string += (i.to_string() + ",");
+  constexpr bool get_bool() const {
+    check(node().type == value_t::TRUE || node().type == value_t::FALSE);
+    return node().type == value_t::TRUE;
+  }
+  constexpr double get_double() const {
+    check(node().type == value_t::NUMBER);
+    return node().number;
+  }
+  constexpr int get_int() const { return static_cast<int>(get_double()); }
+  constexpr std::int64_t get_int64() const {
+    return static_cast<std::int64_t>(get_double());
+  }
+  constexpr std::string_view get_string() const {
+    check(node().type == value_t::STRING);
+    return std::string_view(chars + node().string, node().string_size);
+  }
+  // the key of this value, if it is in an object
+  constexpr std::string_view key() const {
+    return std::string_view(chars + node().key, node().key_size);
   }
-  output_string.pop_back();
-  output_string += "]";
-  return output_string;
-}
 
-inline JSON_Data JSON_Data::convert(var d_var) {
-  switch (d_var.index()) {
-    case 0:
-      return JSON_Data(std::get<std::nullptr_t>(d_var));
-    case 1:
-      return JSON_Data(std::get<bool>(d_var));
-    case 2:
-      return JSON_Data(std::get<double>(d_var));
-    case 3:
-      return JSON_Data(std::get<int>(d_var));
-    case 4:
-      return JSON_Data(std::get<std::string>(d_var));
-    default:
-      throw std::invalid_argument("wrong");
+  // the number of elements or members, 0 for the other types
+  constexpr std::size_t size() const { return node().size; }
+  constexpr JSON_Static_Value operator[](std::size_t position) const {
+    check(node().type == value_t::ARRAY && position < node().size);
+    auto child = node().first + static_cast<std::uint32_t>(position);
+    return JSON_Static_Value(nodes, chars, child);
+  }
+  // `std::invalid_argument` is thrown if the key doesn't exist
+  constexpr JSON_Static_Value operator[](std::string_view key) const {
+    auto result = find(key);
+    if (result == end()) throw std::invalid_argument("invalid key");
+    return *result;
   }
-}
 
-inline JSON_Object::JSON_Object(
-    std::initializer_list<std::pair<std::string, JSON_Data>> list) {
-  operator=(list);
-}
+  class iterator {
+   public:
+    constexpr iterator(const _JSON_Static_Node *nodes, const char *chars,
+                       std::uint32_t index)
+        : nodes(nodes), chars(chars), index(index) {}
+    constexpr JSON_Static_Value operator*() const {
+      return JSON_Static_Value(nodes, chars, index);
+    }
+    constexpr iterator &operator++() {
+      index = nodes[index].next;
+      return *this;
+    }
+    constexpr bool operator==(const iterator &other) const {
+      return index == other.index;
+    }
+    constexpr bool operator!=(const iterator &other) const {
+      return index != other.index;
+    }
 
-inline JSON_Object &JSON_Object::operator=(
-    std::initializer_list<std::pair<std::string, JSON_Data>> list) {
-  for (auto i : list) {
-    object.insert(std::make_pair(i.first, i.second));
+   private:
+    const _JSON_Static_Node *nodes;
+    const char *chars;
+    std::uint32_t index;
+  };
+  // the children of an array or object, in order
+  constexpr iterator begin() const {
+    return iterator(nodes, chars, node().size == 0 ? 0 : node().first);
+  }
+  constexpr iterator end() const { return iterator(nodes, chars, 0); }
+  constexpr iterator find(std::string_view key) const {
+    check(node().type == value_t::OBJECT);
+    for (auto i = begin(); i != end(); ++i) {
+      if ((*i).key() == key) return i;
+    }
+    return end();
+  }
+  constexpr bool contains(std::string_view key) const {
+    return find(key) != end();
   }
-  return *this;
-}
-}  // namespace s2ujson
-// Exception
-#define invalid_Unicode_HEX std::invalid_argument("Invalid Unicode HEX")
-#define invalid_HEX std::invalid_argument("invalid HEX")
-#define literial_true_is_not_correct \
-  std::invalid_argument("literial \"true\" is not correct")
-#define literial_false_is_not_correct \
-  std::invalid_argument("literial \"false\" is not correct")
-#define literial_null_is_not_correct \
-  std::invalid_argument("literial \"null\" is not correct")
-#define number_is_not_correct std::invalid_argument("number is not correct")
-#define invalid_unicode_surrogate \
-  std::invalid_argument("invalid unicode surrogate")
-#define invalid_string_escapestd std::invalid_argument("invalid string escape")
-#define invalid_string_char std::invalid_argument("invalid string char")
-#define miss_quotation_mark std::invalid_argument("miss quotation mark")
-#define array_is_invalid std::invalid_argument("array is invalid")
-#define object_is_invalid std::invalid_argument("object is invalid")
 
-// helper
-inline static bool _isHex(char ch) {
-  return (std::isdigit(ch) != 0) ||
-         ((ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F'));
-}
-inline static unsigned int _JSON_parse_string_hex_helper(
-    std::string &&json) try {
-  if (_isHex(json[0]) && _isHex(json[1]) && _isHex(json[2]) &&
-      _isHex(json[3])) {
-    return std::stoul(json, nullptr, 16);
+  // a `JSON_Data` copy of this value, which is built at runtime
+  inline JSON_Data to_data() const {
+    switch (get_type()) {
+      case value_t::TRUE:
+        return JSON_Data(true);
+      case value_t::FALSE:
+        return JSON_Data(false);
+      case value_t::NUMBER:
+        return JSON_Data(get_double());
+      case value_t::STRING:
+        return JSON_Data(std::string(get_string()));
+      case value_t::ARRAY: {
+        std::vector<JSON_Data> array;
+        array.reserve(size());
+        for (auto i : *this) array.push_back(i.to_data());
+        return JSON_Data(std::move(array));
+      }
+      case value_t::OBJECT: {
+        JSON_Object object;
+        for (auto i : *this) object.add(std::string(i.key()), i.to_data());
+        return JSON_Data(std::move(object));
+      }
+      default:
+        return JSON_Data();
+    }
   }
-  throw invalid_Unicode_HEX;
-} catch (...) {
-  throw invalid_Unicode_HEX;
-}
-inline static std::string _JSON_parse_string_utf_helper(unsigned int hex) {
-  std::string result;
-  if (hex <= 0x7F) {
-    result.push_back((hex & 0xff));
-  } else if (hex <= 0x7FF) {
-    result.push_back(0xC0 | ((hex >> 6) & 0xFF));
-    result.push_back(0x80 | (hex & 0x3F));
-  } else if (hex <= 0xFFFF) {
-    result.push_back(0xE0 | ((hex >> 12) & 0xFF));
-    result.push_back(0x80 | ((hex >> 6) & 0x3F));
-    result.push_back(0x80 | (hex & 0x3F));
-  } else {
-    if (hex > 0x10FFFF) throw invalid_HEX;
-    result.push_back(0xF0 | ((hex >> 18) & 0xFF));
-    result.push_back(0x80 | ((hex >> 12) & 0x3F));
-    result.push_back(0x80 | ((hex >> 6) & 0x3F));
-    result.push_back(0x80 | (hex & 0x3F));
+
+ private:
+  constexpr const _JSON_Static_Node &node() const { return nodes[index]; }
+  // like `std::get`, reading the wrong type throws
+  constexpr static bool check(bool valid) {
+    if (!valid) throw std::bad_variant_access();
+    return true;
   }
 
-  return result;
-}
+  const _JSON_Static_Node *nodes;
+  const char *chars;
+  std::uint32_t index;
+};
 
 /**
- * @brief private function that parse `true` type in JSON
+ * @brief a JSON document parsed at compile time by `static_json`. It is made
+ * of fixed arrays, so a `constexpr` document is put in read-only data and
+ * needs no work or allocation at runtime
  *
+ * @tparam N the size of the text, with its `'\0'`
+ */
+template <std::size_t N>
+class JSON_Static_Document {
+ public:
+  constexpr JSON_Static_Value root() const {
+    return JSON_Static_Value(nodes, chars, 0);
+  }
+  constexpr const value_t &get_type() const { return nodes[0].type; }
+  constexpr std::size_t size() const { return root().size(); }
+  constexpr JSON_Static_Value operator[](std::size_t position) const {
+    return root()[position];
+  }
+  constexpr JSON_Static_Value operator[](std::string_view key) const {
+    return root()[key];
+  }
+  constexpr JSON_Static_Value::iterator begin() const {
+    return root().begin();
+  }
+  constexpr JSON_Static_Value::iterator end() const { return root().end(); }
+  constexpr bool contains(std::string_view key) const {
+    return root().contains(key);
+  }
+  inline JSON_Data to_data() const { return root().to_data(); }
+
+  // each value takes a char and a separator, except the last one
+  constexpr static std::size_t max_nodes = N / 2 + 1;
+
+  _JSON_Static_Node nodes[max_nodes] = {};
+  // the decoded strings and keys, which are never longer than the text
+  char chars[N] = {};
+  std::uint32_t node_count = 0;
+  std::uint32_t char_count = 0;
+};
+}  // namespace s2ujson
+
+/**
+ * @brief the recursive descent parser of `static_json`. Errors throw, which
+ * can't be done in a constant expression, so invalid text doesn't compile
  *
- * @param begin
- * @return true
- * @return false
+ * @tparam N
  */
-inline static bool _JSON_parse_true_iter(std::string::const_iterator &begin) {
-  auto iter = begin;
-  while (*iter == ' ') {
-    iter++;
+template <std::size_t N>
+class _JSON_Static_Parser {
+ public:
+  constexpr _JSON_Static_Parser(const char *text,
+                                s2ujson::JSON_Static_Document<N> &document)
+      : text(text), document(document) {}
+
+  constexpr void parse() {
+    skip_space();
+    // the node 0 is kept for the root
+    document.node_count = 1;
+    parse_value(0);
+    document.nodes[0] = pending[0];
+    skip_space();
+    if (position != N - 1) throw std::invalid_argument("unexpected text");
   }
-  if (*(iter++) == 't' && *(iter++) == 'r' && *(iter++) == 'u' &&
-      *(iter++) == 'e') {
-    begin = iter;
-    return true;
+
+ private:
+  constexpr char peek() const { return position < N - 1 ? text[position] : 0; }
+  constexpr void skip_space() {
+    while (peek() == ' ' || peek() == '\t' || peek() == '\n' ||
+           peek() == '\r') {
+      position++;
+    }
   }
-  throw literial_true_is_not_correct;
-}
-inline static bool _JSON_parse_true_iter(std::string::const_iterator &&begin) {
-  return _JSON_parse_true_iter(begin);
-}
+  constexpr void expect(const char *word) {
+    for (; *word != '\0'; word++, position++) {
+      if (peek() != *word) throw std::invalid_argument("literal is invalid");
+    }
+  }
+  constexpr std::uint32_t new_node() {
+    if (pending_count == document.max_nodes) {
+      throw std::invalid_argument("too many values");
+    }
+    pending[pending_count] = _JSON_Static_Node();
+    return pending_count++;
+  }
+  // move the children of the container `index`, which are the pending nodes
+  // from `begin`, to the document next to each other
+  constexpr void place(std::uint32_t index, std::uint32_t begin) {
+    auto &node = pending[index];
+    node.size = pending_count - begin;
+    node.first = node.size == 0 ? 0 : document.node_count;
+    for (std::uint32_t i = begin; i < pending_count; i++) {
+      if (document.node_count == document.max_nodes) {
+        throw std::invalid_argument("too many values");
+      }
+      auto &child = document.nodes[document.node_count++];
+      child = pending[i];
+      child.next = i + 1 < pending_count ? document.node_count : 0;
+    }
+    pending_count = begin;
+  }
+
+  constexpr std::uint32_t parse_value(std::size_t depth) {
+    if (depth == S2UJSON_MAX_DEPTH) throw nesting_is_too_deep;
+    std::uint32_t index = new_node();
+    auto &node = pending[index];
+    switch (peek()) {
+      case 'n':
+        expect("null");
+        break;
+      case 't':
+        expect("true");
+        node.type = s2ujson::value_t::TRUE;
+        break;
+      case 'f':
+        expect("false");
+        node.type = s2ujson::value_t::FALSE;
+        break;
+      case '\"':
+        node.type = s2ujson::value_t::STRING;
+        parse_string(node.string, node.string_size);
+        break;
+      case '[':
+      case '{':
+        parse_container(index, depth);
+        break;
+      default:
+        node.type = s2ujson::value_t::NUMBER;
+        node.number = parse_number();
+    }
+    return index;
+  }
+  constexpr void parse_container(std::uint32_t index, std::size_t depth) {
+    bool is_object = peek() == '{';
+    pending[index].type =
+        is_object ? s2ujson::value_t::OBJECT : s2ujson::value_t::ARRAY;
+    position++;
+    skip_space();
+    std::uint32_t begin = pending_count;
+    if (peek() == (is_object ? '}' : ']')) {
+      position++;
+      return;
+    }
+    while (true) {
+      std::uint32_t key = 0, key_size = 0;
+      if (is_object) {
+        if (peek() != '\"') throw object_is_invalid;
+        parse_string(key, key_size);
+        skip_space();
+        if (peek() != ':') throw object_is_invalid;
+        position++;
+        skip_space();
+      }
+      std::uint32_t child = parse_value(depth + 1);
+      pending[child].key = key;
+      pending[child].key_size = key_size;
+      skip_space();
+      if (peek() == ',') {
+        position++;
+        skip_space();
+      } else if (peek() == (is_object ? '}' : ']')) {
+        position++;
+        place(index, begin);
+        return;
+      } else if (is_object) {
+        throw object_is_invalid;
+      } else {
+        throw array_is_invalid;
+      }
+    }
+  }
+
+  // decode the string at the position into the chars of the document
+  constexpr void parse_string(std::uint32_t &begin, std::uint32_t &size) {
+    begin = document.char_count;
+    position++;
+    while (true) {
+      char ch = peek();
+      if (position == N - 1) throw miss_quotation_mark;
+      position++;
+      if (ch == '\"') break;
+      if (static_cast<unsigned char>(ch) < 0x20) throw invalid_string_char;
+      if (ch != '\\') {
+        put(ch);
+        continue;
+      }
+      ch = peek();
+      position++;
+      switch (ch) {
+        case '\"':
+        case '\\':
+        case '/':
+          put(ch);
+          break;
+        case 'b':
+          put('\b');
+          break;
+        case 'f':
+          put('\f');
+          break;
+        case 'n':
+          put('\n');
+          break;
+        case 'r':
+          put('\r');
+          break;
+        case 't':
+          put('\t');
+          break;
+        case 'u': {
+          unsigned int code = parse_hex4();
+          if (code >= 0xDC00 && code <= 0xDFFF) throw invalid_unicode_surrogate;
+          if (code >= 0xD800 && code <= 0xDBFF) {
+            if (peek() != '\\') throw invalid_unicode_surrogate;
+            position++;
+            if (peek() != 'u') throw invalid_unicode_surrogate;
+            position++;
+            unsigned int low = parse_hex4();
+            if (low < 0xDC00 || low > 0xDFFF) throw invalid_unicode_surrogate;
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+          }
+          put_utf8(code);
+          break;
+        }
+        default:
+          throw invalid_string_escapestd;
+      }
+    }
+    size = document.char_count - begin;
+  }
+  constexpr unsigned int parse_hex4() {
+    unsigned int result = 0;
+    for (int i = 0; i < 4; i++, position++) {
+      unsigned char value =
+          _JSON_tables.hex[static_cast<unsigned char>(peek())];
+      if (value == 0xFF) throw invalid_Unicode_HEX;
+      result = (result << 4) | value;
+    }
+    return result;
+  }
+  constexpr void put(char ch) { document.chars[document.char_count++] = ch; }
+  constexpr void put_utf8(unsigned int code) {
+    if (code < 0x80) {
+      put(static_cast<char>(code));
+    } else if (code < 0x800) {
+      put(static_cast<char>(0xC0 | (code >> 6)));
+      put(static_cast<char>(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+      put(static_cast<char>(0xE0 | (code >> 12)));
+      put(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+      put(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+      put(static_cast<char>(0xF0 | (code >> 18)));
+      put(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+      put(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+      put(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+  }
+
+  /**
+   * @brief the number at the position. The first 19 significant digits are
+   * scaled in `long double`, so a long mantissa may differ from the runtime
+   * parse in the last bit
+   *
+   * @return double
+   */
+  constexpr double parse_number() {
+    auto is_digit = [&]() { return peek() >= '0' && peek() <= '9'; };
+    bool negative = peek() == '-';
+    if (negative) position++;
+    std::uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    auto add_digit = [&](bool fraction) {
+      if (digits < 19) {
+        mantissa = mantissa * 10 + (peek() - '0');
+        if (mantissa != 0) digits++;
+        if (fraction) exponent--;
+      } else if (!fraction) {
+        exponent++;
+      }
+      position++;
+    };
+    if (peek() == '0') {
+      position++;
+    } else {
+      if (!is_digit()) throw number_is_not_correct;
+      while (is_digit()) add_digit(false);
+    }
+    if (peek() == '.') {
+      position++;
+      if (!is_digit()) throw number_is_not_correct;
+      while (is_digit()) add_digit(true);
+    }
+    if (peek() == 'e' || peek() == 'E') {
+      position++;
+      bool negative_exponent = peek() == '-';
+      if (peek() == '+' || peek() == '-') position++;
+      if (!is_digit()) throw number_is_not_correct;
+      int value = 0;
+      while (is_digit()) {
+        if (value < 100000) value = value * 10 + (peek() - '0');
+        position++;
+      }
+      exponent += negative_exponent ? -value : value;
+    }
+    long double result = static_cast<long double>(mantissa);
+    if (mantissa != 0) {
+      long double scale = 1, base = 10;
+      for (int power = exponent < 0 ? -exponent : exponent; power != 0;
+           power /= 2, base *= base) {
+        if (power & 1) scale *= base;
+      }
+      result = exponent < 0 ? result / scale : result * scale;
+      if (result > std::numeric_limits<double>::max() ||
+          result < std::numeric_limits<double>::min()) {
+        throw number_is_out_of_range;
+      }
+    }
+    return static_cast<double>(negative ? -result : result);
+  }
+
+  const char *text;
+  s2ujson::JSON_Static_Document<N> &document;
+  std::size_t position = 0;
+  // the values of the open arrays and objects, which are moved to the
+  // document when their container ends
+  _JSON_Static_Node pending[s2ujson::JSON_Static_Document<N>::max_nodes] = {};
+  std::uint32_t pending_count = 0;
+};
+
 namespace s2ujson {
 /**
- * @brief private function that only exist for testing
+ * @brief parse a string literal at compile time, with
+ * `constexpr auto document = static_json(R"({"key": [1, 2]})");`. Invalid
+ * text is a compile error. The document has fixed arrays, so use it for
+ * small static documents: it takes about 20 bytes for each char of the text
  *
- * @param json
- * @return true
- * @return false
+ * @tparam N
+ * @param text
+ * @return JSON_Static_Document<N>
  */
-inline static bool JSON_parse_true(const std::string &json) {
-  auto iter = json.cbegin();
-  return _JSON_parse_true_iter(json.cbegin());
-}
-inline static bool JSON_parse_true(const std::string &&json) {
-  return JSON_parse_true(json);
+template <std::size_t N>
+constexpr JSON_Static_Document<N> static_json(const char (&text)[N]) {
+  JSON_Static_Document<N> document;
+  _JSON_Static_Parser<N>(text, document).parse();
+  return document;
 }
 }  // namespace s2ujson
 
+
+// key set
+namespace s2ujson {
 /**
- * @brief private function that parse `false` type in JSON
+ * @brief a fixed set of keys with a minimal perfect hash, made once (for
+ * example as a `static const` local) and used to look up the same keys in
+ * many objects. The index of a key is its place in the list it was made
+ * from, so it can be an `enum`.
+ * @details the hash is "hash and displace": a key is put in a bucket by one
+ * hash, and each bucket has a displacement, found when the set is made, which
+ * gives its keys free slots of a table as large as the set. A lookup is two
+ * mixes of one hash of the key and one compare
  *
- * @param begin
- * @return true
- * @return false
  */
-inline bool _JSON_parse_false_iter(std::string::const_iterator &begin) {
-  auto iter = begin;
-  while (*iter == ' ') {
-    iter++;
+class JSON_Key_Set {
+ public:
+  constexpr static std::size_t npos = static_cast<std::size_t>(-1);
+
+  // `std::invalid_argument` is thrown if a key is repeated
+  JSON_Key_Set(std::initializer_list<std::string_view> list)
+      : keys(list.begin(), list.end()) {
+    build();
   }
-  if (*(iter++) == 'f' && *(iter++) == 'a' && *(iter++) == 'l' &&
-      *(iter++) == 's' && *(iter++) == 'e') {
-    begin = iter;
-    return false;
+  explicit JSON_Key_Set(std::vector<std::string> list)
+      : keys(std::move(list)) {
+    build();
   }
-  throw literial_false_is_not_correct;
-}
-inline static bool _JSON_parse_false_iter(std::string::const_iterator &&begin) {
-  return _JSON_parse_false_iter(begin);
-}
+
+  inline std::size_t size() const { return keys.size(); }
+  inline const std::string &key(std::size_t index) const {
+    return keys[index];
+  }
+  // the index of `key`, `npos` if it is not in the set
+  inline std::size_t find(std::string_view key) const {
+    if (keys.empty()) return npos;
+    std::uint64_t hash = hash_key(key);
+    std::size_t index =
+        table[slot(hash, displacements[mix(hash) % displacements.size()])];
+    return keys[index] == key ? index : npos;
+  }
+
+  friend class JSON_Key_Binding;
+
+ private:
+  inline static std::uint64_t hash_key(std::string_view key) {
+    // FNV-1a
+    std::uint64_t hash = 0xCBF29CE484222325ULL;
+    for (char ch : key) {
+      hash = (hash ^ static_cast<unsigned char>(ch)) * 0x100000001B3ULL;
+    }
+    return hash;
+  }
+  // the finalizer of MurmurHash3
+  inline static std::uint64_t mix(std::uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    return hash ^ (hash >> 33);
+  }
+  inline std::size_t slot(std::uint64_t hash,
+                          std::uint32_t displacement) const {
+    return mix(hash ^ (displacement * 0x9E3779B97F4A7C15ULL)) % keys.size();
+  }
+
+  inline void build() {
+    std::size_t count = keys.size();
+    if (count == 0) return;
+    // the keys in the order of a `JSON_Object`
+    sorted.resize(count);
+    for (std::size_t i = 0; i < count; i++) sorted[i] = i;
+    std::sort(sorted.begin(), sorted.end(),
+              [&](std::size_t left, std::size_t right) {
+                return keys[left] < keys[right];
+              });
+    for (std::size_t i = 1; i < count; i++) {
+      if (keys[sorted[i - 1]] == keys[sorted[i]]) {
+        throw std::invalid_argument("repeated key");
+      }
+    }
+    std::vector<std::uint64_t> hashes(count);
+    for (std::size_t i = 0; i < count; i++) hashes[i] = hash_key(keys[i]);
+    // about 4 keys in a bucket
+    std::vector<std::vector<std::size_t>> buckets(count / 4 + 1);
+    for (std::size_t i = 0; i < count; i++) {
+      buckets[mix(hashes[i]) % buckets.size()].push_back(i);
+    }
+    std::vector<std::size_t> order(buckets.size());
+    for (std::size_t i = 0; i < order.size(); i++) order[i] = i;
+    // the largest buckets are placed first, while the table is empty
+    std::stable_sort(order.begin(), order.end(),
+                     [&](std::size_t left, std::size_t right) {
+                       return buckets[left].size() > buckets[right].size();
+                     });
+    displacements.assign(buckets.size(), 0);
+    table.assign(count, npos);
+    std::vector<std::size_t> slots;
+    for (std::size_t bucket : order) {
+      auto &members = buckets[bucket];
+      if (members.empty()) continue;
+      for (std::uint32_t displacement = 0;; displacement++) {
+        if (displacement == 1 << 20) {
+          // two different keys with the same hash, nearly never
+          throw std::invalid_argument("key set can't be hashed");
+        }
+        slots.clear();
+        for (std::size_t i : members) {
+          std::size_t position = slot(hashes[i], displacement);
+          if (table[position] != npos ||
+              std::find(slots.begin(), slots.end(), position) !=
+                  slots.end()) {
+            break;
+          }
+          slots.push_back(position);
+        }
+        if (slots.size() != members.size()) continue;
+        for (std::size_t i = 0; i < members.size(); i++) {
+          table[slots[i]] = members[i];
+        }
+        displacements[bucket] = displacement;
+        break;
+      }
+    }
+  }
+
+  std::vector<std::string> keys;
+  std::vector<std::uint32_t> displacements;
+  // the index of the key in each slot
+  std::vector<std::size_t> table;
+  // the indexes of the keys sorted by key
+  std::vector<std::size_t> sorted;
+};
+
+/**
+ * @brief the values of a `JSON_Object` for the keys of a `JSON_Key_Set`,
+ * read by index in O(1). `bind` walks the members once: while they are the
+ * keys of the set in order, which is the usual shape, each takes one compare,
+ * then the rest are looked up by the hash. Members which are not in the set
+ * are skipped and missing keys are nullptr, so other shapes still work. The
+ * values are valid while the object is not changed
+ *
+ */
+class JSON_Key_Binding {
+ public:
+  explicit JSON_Key_Binding(const JSON_Key_Set &set)
+      : set(set), values(set.size(), nullptr) {}
+
+  /**
+   * @brief bind the members of `object`
+   *
+   * @param object
+   * @return true if the object has exactly the keys of the set
+   */
+  inline bool bind(const JSON_Object &object) {
+    std::fill(values.begin(), values.end(), nullptr);
+    std::size_t found = 0, position = 0;
+    for (auto &i : object) {
+      std::size_t index = JSON_Key_Set::npos;
+      if (position < set.sorted.size() &&
+          set.keys[set.sorted[position]] == i.first) {
+        index = set.sorted[position++];
+      } else {
+        // the shape differs, the rest is looked up by the hash
+        position = set.sorted.size();
+        index = set.find(i.first);
+      }
+      if (index == JSON_Key_Set::npos) continue;
+      values[index] = &i.second;
+      found++;
+    }
+    return found == set.size() && object.size() == set.size();
+  }
+  // the value of the key at `index`, nullptr if the object doesn't have it
+  inline const JSON_Data *find(std::size_t index) const {
+    return values[index];
+  }
+  // `std::invalid_argument` is thrown if the object doesn't have the key
+  inline const JSON_Data &operator[](std::size_t index) const {
+    if (values[index] == nullptr) throw std::invalid_argument("invalid key");
+    return *values[index];
+  }
+
+ private:
+  const JSON_Key_Set &set;
+  std::vector<const JSON_Data *> values;
+};
+}  // namespace s2ujson
+
+
+// in situ
 namespace s2ujson {
 /**
- * @brief private function that only exist for testing
+ * @brief a document parsed in place in a mutable buffer of the caller. The
+ * strings and keys are decoded over their own text and kept as ranges of the
+ * buffer, so nothing is copied, and the values are nodes of one array, read
+ * with `JSON_Static_Value`. The buffer is changed by the parse and must live
+ * as long as the document. Numbers are `double`s.
  *
- * @param json
- * @return true
- * @return false
  */
-inline static bool JSON_parse_false(const std::string &json) {
-  return _JSON_parse_false_iter(json.cbegin());
-}
-inline static bool JSON_parse_false(const std::string &&json) {
-  return JSON_parse_false(json);
-}
+class JSON_Insitu_Document {
+ public:
+  JSON_Insitu_Document() : nodes(1) {}
+  JSON_Insitu_Document(char *buffer, std::size_t size) { parse(buffer, size); }
+  explicit JSON_Insitu_Document(std::string &buffer) { parse(buffer); }
+
+  /**
+   * @brief parse `[buffer, buffer + size)` in place. The memory of the last
+   * parse is used again, so a document of the same shape doesn't allocate.
+   * If the text is invalid, `std::invalid_argument` is thrown and the
+   * document is left with a null root
+   *
+   * @param buffer
+   * @param size
+   */
+  inline void parse(char *buffer, std::size_t size) {
+    if (size > std::numeric_limits<std::uint32_t>::max()) {
+      throw document_is_too_large;
+    }
+    // the node 0 is kept for the root
+    nodes.resize(1);
+    nodes[0] = _JSON_Static_Node();
+    frames.clear();
+    pending.clear();
+    chars = buffer;
+    try {
+      parse_nodes(buffer, size);
+    } catch (...) {
+      nodes.resize(1);
+      nodes[0] = _JSON_Static_Node();
+      throw;
+    }
+  }
+  inline void parse(std::string &buffer) {
+    parse(buffer.data(), buffer.size());
+  }
+
+  inline JSON_Static_Value root() const {
+    return JSON_Static_Value(nodes.data(), chars, 0);
+  }
+  inline const value_t &get_type() const { return nodes[0].type; }
+  inline std::size_t size() const { return nodes[0].size; }
+  inline JSON_Static_Value operator[](std::size_t position) const {
+    return root()[position];
+  }
+  inline JSON_Static_Value operator[](std::string_view key) const {
+    return root()[key];
+  }
+  inline JSON_Static_Value::iterator begin() const { return root().begin(); }
+  inline JSON_Static_Value::iterator end() const { return root().end(); }
+  inline bool contains(std::string_view key) const {
+    return root().contains(key);
+  }
+  inline JSON_Data to_data() const { return root().to_data(); }
+  // the heap memory of the document, see `JSON_Data::memory_usage`. The
+  // strings and keys are in the buffer, which is not counted
+  inline JSON_Memory_Usage memory_usage() const {
+    JSON_Memory_Usage usage;
+    usage.nodes = nodes.size() * sizeof(_JSON_Static_Node);
+    usage.overhead = frames.capacity() * sizeof(frame_t) +
+                     pending.capacity() * sizeof(_JSON_Static_Node);
+    usage.slack = (nodes.capacity() - nodes.size()) * sizeof(_JSON_Static_Node);
+    return usage;
+  }
+
+ private:
+  // an open array or object
+  struct frame_t {
+    // the pending node of the container
+    std::uint32_t node;
+    // its first child in `pending`
+    std::uint32_t begin;
+    bool after_comma;
+  };
+
+  inline void parse_nodes(char *buffer, std::size_t size) {
+    _JSON_Tokenizer tokenizer(buffer, buffer + size);
+    tokenizer.skip_space();
+    if (tokenizer.peek() != '{' && tokenizer.peek() != '[') {
+      throw array_is_invalid;
+    }
+    pending.emplace_back();
+    open(tokenizer, 0);
+    while (!frames.empty()) {
+      auto &frame = frames.back();
+      bool is_object = pending[frame.node].type == value_t::OBJECT;
+      tokenizer.skip_space();
+      char ch = tokenizer.peek();
+      if (ch == (is_object ? '}' : ']') && !frame.after_comma) {
+        tokenizer.advance();
+        place(frame);
+        frames.pop_back();
+        continue;
+      }
+      if (pending.size() != frame.begin && !frame.after_comma) {
+        if (ch != ',') {
+          if (is_object) throw object_is_invalid;
+          throw array_is_invalid;
+        }
+        frame.after_comma = true;
+        tokenizer.advance();
+        continue;
+      }
+      frame.after_comma = false;
+      auto child = static_cast<std::uint32_t>(pending.size());
+      pending.emplace_back();
+      if (is_object) {
+        if (ch != '\"') throw object_is_invalid;
+        parse_string(tokenizer, pending[child].key, pending[child].key_size);
+        tokenizer.skip_space();
+        if (tokenizer.peek() != ':') throw object_is_invalid;
+        tokenizer.advance();
+        tokenizer.skip_space();
+        ch = tokenizer.peek();
+      }
+      auto &node = pending[child];
+      switch (_JSON_value_table.kind[static_cast<unsigned char>(ch)]) {
+        case _JSON_value_t::ARRAY:
+        case _JSON_value_t::OBJECT:
+          // `frame` is not used after this
+          open(tokenizer, child);
+          break;
+        case _JSON_value_t::STRING:
+          node.type = value_t::STRING;
+          parse_string(tokenizer, node.string, node.string_size);
+          break;
+        case _JSON_value_t::TRUE:
+          node.type = value_t::TRUE;
+          tokenizer.parse_true();
+          break;
+        case _JSON_value_t::FALSE:
+          node.type = value_t::FALSE;
+          tokenizer.parse_false();
+          break;
+        case _JSON_value_t::NULL_DATA:
+          tokenizer.parse_null();
+          break;
+        default:
+          if (ch == '\0' || ch == ',' || ch == ']' || ch == '}') {
+            if (is_object) throw object_is_invalid;
+            throw array_is_invalid;
+          }
+          node.type = value_t::NUMBER;
+          node.number = tokenizer.parse_double();
+      }
+    }
+    nodes[0] = pending[0];
+  }
+  // move the children of the container of `frame`, which are the pending
+  // nodes from `frame.begin`, to `nodes` next to each other
+  inline void place(const frame_t &frame) {
+    auto &node = pending[frame.node];
+    node.size = static_cast<std::uint32_t>(pending.size() - frame.begin);
+    node.first = node.size == 0 ? 0 : static_cast<std::uint32_t>(nodes.size());
+    for (std::size_t i = frame.begin; i < pending.size(); i++) {
+      nodes.push_back(pending[i]);
+      nodes.back().next =
+          i + 1 < pending.size() ? static_cast<std::uint32_t>(nodes.size()) : 0;
+    }
+    pending.resize(frame.begin);
+  }
+  inline void open(_JSON_Tokenizer &tokenizer, std::uint32_t node) {
+    if (frames.size() == S2UJSON_MAX_DEPTH) throw nesting_is_too_deep;
+    pending[node].type =
+        tokenizer.peek() == '{' ? value_t::OBJECT : value_t::ARRAY;
+    tokenizer.advance();
+    frames.push_back(
+        {node, static_cast<std::uint32_t>(pending.size()), false});
+  }
+  inline void parse_string(_JSON_Tokenizer &tokenizer, std::uint32_t &begin,
+                           std::uint32_t &size) {
+    // the text is the buffer, which can be written
+    char *output = chars + (tokenizer.position() + 1 - chars);
+    begin = static_cast<std::uint32_t>(output - chars);
+    size = static_cast<std::uint32_t>(tokenizer.parse_string_in_place(output));
+  }
+
+  std::vector<_JSON_Static_Node> nodes;
+  std::vector<frame_t> frames;
+  // the values of the open arrays and objects, which are moved to `nodes`
+  // when their container ends
+  std::vector<_JSON_Static_Node> pending;
+  char *chars = nullptr;
+};
 }  // namespace s2ujson
+
+
+// canonical
 /**
- * @brief private function that parse `null` type in JSON
+ * @brief write `number` as ECMAScript's `Number.prototype.toString` does,
+ * which is the number format of RFC 8785: the shortest digits which read
+ * back as the same double, in plain notation from 1e-6 up to 1e21 and in
+ * exponent notation outside that range
  *
- * @param begin
- * @return std::nullptr_t
+ * @param number
+ * @param output at least 32 chars
+ * @return std::size_t the size written
  */
-inline static std::nullptr_t _JSON_parse_null_iter(
-    std::string::const_iterator &begin) {
-  auto iter = begin;
-  while (*iter == ' ') {
+inline static std::size_t _JSON_ecmascript_number(double number,
+                                                  char *output) {
+  if (!std::isfinite(number)) throw number_is_not_finite;
+  if (number == 0) {
+    // -0 too
+    output[0] = '0';
+    return 1;
+  }
+  // `[-]d[.ddd]e[+-]xx` with the shortest digits
+  char text[32];
+  char *text_end = std::to_chars(text, text + sizeof(text), number,
+                                 std::chars_format::scientific)
+                       .ptr;
+  char digits[20];
+  int k = 0, exponent = 0;
+  const char *iter = text;
+  char *out = output;
+  if (*iter == '-') {
+    *out++ = '-';
     iter++;
   }
-  if (*(iter++) == 'n' && *(iter++) == 'u' && *(iter++) == 'l' &&
-      *(iter++) == 'l') {
-    begin = iter;
-    return nullptr;
+  for (; *iter != 'e'; iter++) {
+    if (*iter != '.') digits[k++] = *iter;
   }
-  throw literial_null_is_not_correct;
-}
-inline static std::nullptr_t _JSON_parse_null_iter(
-    std::string::const_iterator &&begin) {
-  return _JSON_parse_null_iter(begin);
+  iter++;
+  if (*iter == '+') iter++;
+  std::from_chars(iter, text_end, exponent);
+  // the value is 0.digits * 10^n
+  int n = exponent + 1;
+  auto put_digits = [&](int begin, int end) {
+    for (int i = begin; i < end; i++) *out++ = digits[i];
+  };
+  if (k <= n && n <= 21) {
+    put_digits(0, k);
+    for (int i = k; i < n; i++) *out++ = '0';
+  } else if (0 < n && n <= 21) {
+    put_digits(0, n);
+    *out++ = '.';
+    put_digits(n, k);
+  } else if (-6 < n && n <= 0) {
+    *out++ = '0';
+    *out++ = '.';
+    for (int i = n; i < 0; i++) *out++ = '0';
+    put_digits(0, k);
+  } else {
+    *out++ = digits[0];
+    if (k > 1) {
+      *out++ = '.';
+      put_digits(1, k);
+    }
+    *out++ = 'e';
+    *out++ = n - 1 < 0 ? '-' : '+';
+    out = std::to_chars(out, out + 4, n - 1 < 0 ? 1 - n : n - 1).ptr;
+  }
+  return static_cast<std::size_t>(out - output);
 }
-namespace s2ujson {
+
 /**
- * @brief private function that only exist for testing
+ * @brief compare two valid UTF-8 strings by their UTF-16 code units, the
+ * order of the keys in RFC 8785. It is the byte order, except that the
+ * chars above U+FFFF, which are surrogates in UTF-16, sort before
+ * U+E000 to U+FFFF
  *
- * @param json
- * @return std::nullptr_t
+ * @param left
+ * @param right
+ * @return true if `left` is before `right`
  */
-inline static std::nullptr_t JSON_parse_null(const std::string &json) {
-  return _JSON_parse_null_iter(json.cbegin());
-}
-inline static std::nullptr_t JSON_parse_null(const std::string &&json) {
-  return JSON_parse_null(json);
+inline static bool _JSON_utf16_less(std::string_view left,
+                                    std::string_view right) {
+  // the first code unit of the char at `iter`, which is enough because the
+  // strings are equal up to it
+  auto unit = [](std::string_view text, std::size_t iter) -> unsigned int {
+    auto lead = static_cast<unsigned char>(text[iter]);
+    if (lead < 0x80) return lead;
+    int length = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : 2;
+    unsigned int code = lead & (0x7F >> length);
+    for (int i = 1; i < length; i++) {
+      code = (code << 6) | (static_cast<unsigned char>(text[iter + i]) & 0x3F);
+    }
+    return code >= 0x10000 ? 0xD800 + ((code - 0x10000) >> 10) : code;
+  };
+  std::size_t size = std::min(left.size(), right.size()), i = 0;
+  while (i < size && left[i] == right[i]) i++;
+  if (i == size) return left.size() < right.size();
+  // back to the first byte of the char which differs
+  while (i > 0 && (static_cast<unsigned char>(left[i]) & 0xC0) == 0x80) i--;
+  unsigned int a = unit(left, i), b = unit(right, i);
+  if (a != b) return a < b;
+  // the same high surrogate, the low surrogates are in byte order
+  return left.substr(i) < right.substr(i);
 }
-}  // namespace s2ujson
+
 /**
- * @brief private function that parse `number` type in JSON
+ * @brief writes the RFC 8785 form of a `JSON_Data` to a sink through a
+ * buffer, so the sink is called with large blocks
  *
- * @param begin
- * @return double
+ * @tparam Sink
  */
-static double _JSON_parse_number_iter(std::string::const_iterator &begin) {
-  auto end = begin;
-  if (*end == '-') end++;
-  if (*end == '0') {
-    end++;
-  } else {
-    if (!(*end >= '1' && *end <= '9')) throw number_is_not_correct;
-    while (std::isdigit(*end)) end++;
+template <typename Sink>
+class _JSON_Canonical_Writer {
+ public:
+  explicit _JSON_Canonical_Writer(Sink &sink) : sink(sink) {}
+  ~_JSON_Canonical_Writer() { flush(); }
+
+  void write_value(const s2ujson::JSON_Data &value) {
+    switch (value.get_type()) {
+      case s2ujson::value_t::NULL_DATA:
+        write("null", 4);
+        return;
+      case s2ujson::value_t::TRUE:
+        write("true", 4);
+        return;
+      case s2ujson::value_t::FALSE:
+        write("false", 5);
+        return;
+      case s2ujson::value_t::NUMBER: {
+        // every number is a double in RFC 8785
+        char number[32];
+        write(number, _JSON_ecmascript_number(value.get_double(), number));
+        return;
+      }
+      case s2ujson::value_t::STRING:
+        write_string(value.get_string());
+        return;
+      case s2ujson::value_t::ARRAY: {
+        put('[');
+        s2ujson::JSON_Data scratch;
+        for (std::size_t i = 0; i < value.array_size(); i++) {
+          if (i != 0) put(',');
+          write_value(value.element(i, scratch));
+        }
+        put(']');
+        return;
+      }
+      default:
+        write_object(value.get_object());
+    }
   }
 
-  if (*end == '.') {
-    end++;
-    if (!std::isdigit(*end)) throw number_is_not_correct;
-    while (std::isdigit(*end)) end++;
+  inline void flush() {
+    if (size != 0) sink(static_cast<const char *>(buffer), size);
+    size = 0;
   }
-  if ((*end == 'e' || *end == 'E')) {
-    end++;
-    if ((*end == '+' || *end == '-')) end++;
-    if (!std::isdigit(*end)) throw number_is_not_correct;
-    while (std::isdigit(*end)) end++;
+
+ private:
+  void write_object(const s2ujson::JSON_Object &object) {
+    put('{');
+    // the map is in byte order, which is the order of UTF-16 unless a key
+    // has a char from U+E000, led by 0xEE or more
+    bool reorder = false;
+    for (auto &i : object) {
+      for (char ch : i.first) {
+        reorder = reorder || static_cast<unsigned char>(ch) >= 0xEE;
+      }
+    }
+    if (!reorder) {
+      bool first = true;
+      for (auto &i : object) {
+        if (!first) put(',');
+        first = false;
+        write_member(i.first, i.second);
+      }
+    } else {
+      std::vector<const std::pair<const std::string, s2ujson::JSON_Data> *>
+          members;
+      for (auto &i : object) members.push_back(&i);
+      std::sort(members.begin(), members.end(),
+                [](auto *left, auto *right) {
+                  return _JSON_utf16_less(left->first, right->first);
+                });
+      for (std::size_t i = 0; i < members.size(); i++) {
+        if (i != 0) put(',');
+        write_member(members[i]->first, members[i]->second);
+      }
+    }
+    put('}');
   }
-  if ((*end != ',') && (*end != '\0') && (*end != ' ') && (*end != ']') &&
-      (*end != '}') && (*end != '\n'))
-    throw number_is_not_correct;
-  std::string num_string(begin, end);
-  begin = end;
-  return std::stod(num_string);
-}
-inline static double _JSON_parse_number_iter(
-    std::string::const_iterator &&begin) {
-  return _JSON_parse_number_iter(begin);
-}
-namespace s2ujson {
-/**
- * @brief private function that only exist for testing
- *
- * @param json
- * @return std::nullptr_t
- */
-inline static double JSON_parse_number(const std::string &json) {
-  return _JSON_parse_number_iter(json.cbegin());
-}
-inline static double JSON_parse_number(const std::string &&json) {
-  return JSON_parse_number(json);
-}
-}  // namespace s2ujson
-/**
- * @brief private function that parse `string` type in JSON
- *
- * @param begin
- * @return std::string
- */
-inline static std::string _JSON_parse_string_iter(
-    std::string::const_iterator &begin) {
-  auto iter = begin;
-  std::string result = "";
-  if (*iter == '\"') iter++;
-  while (*iter != '\0') {
-    switch (*iter) {
-      case '\"':
-        begin = iter + 1;
-        return result;  // get the right result
-      case '\\':
-        iter++;
-        switch (*iter) {
-          case '\\':
-            result.push_back('\\');
-            break;
-          case '\"':
-            result.push_back('\"');
-            break;
-          case '/':
-            result.push_back('/');
-            break;
-          case 'b':
-            result.push_back('\b');
-            break;
-          case 'f':
-            result.push_back('\f');
-            break;
-          case 'n':
-            result.push_back('\n');
-            break;
-          case 'r':
-            result.push_back('\r');
-            break;
-          case 't':
-            result.push_back('\t');
-            break;
-          case 'u': {
-            unsigned int hex =
-                _JSON_parse_string_hex_helper(std::string(iter + 1, iter + 5));
-            if (hex >= 0xD800 && hex <= 0xDBFF) {
-              iter += 5;
-              if (*iter != '\\') throw invalid_unicode_surrogate;
-              iter++;
-              if (*iter != 'u') throw invalid_unicode_surrogate;
-              unsigned int hex2 = _JSON_parse_string_hex_helper(
-                  std::string(iter + 1, iter + 5));
-              if (hex2 < 0xDC00 || hex2 > 0xDFFF)
-                throw invalid_unicode_surrogate;
-              hex = (((hex - 0xD800) << 10) | (hex2 - 0xDC00)) + 0x10000;
-            }
-            if (hex == 0) {
-              while (*iter != '\"') iter++;
-              begin = ++iter;
-              return result;
-            } else {
-              result.append(_JSON_parse_string_utf_helper(hex));
-            }
-            iter += 4;
-            break;
-          }
-          default:
-            throw invalid_string_escapestd;
-        }
+  inline void write_member(const std::string &key,
+                           const s2ujson::JSON_Data &value) {
+    write_string(key);
+    put(':');
+    write_value(value);
+  }
+  // only `"`, `\` and the control chars are escaped, the short escapes are
+  // used where there is one and the others are `\u00xx` in lower case
+  void write_string(std::string_view string) {
+    static const char hex_digits[] = "0123456789abcdef";
+    const char *iter = string.data();
+    const char *end = iter + string.size();
+    put('\"');
+    while (true) {
+      std::size_t plain = _JSON_simd_plain_length(iter, end, true);
+      write(iter, plain);
+      iter += plain;
+      if (iter == end) break;
+      auto ch = static_cast<unsigned char>(*iter);
+      const char *escape = nullptr;
+      switch (ch) {
+        case '\"':
+          escape = "\\\"";
+          break;
+        case '\\':
+          escape = "\\\\";
+          break;
+        case '\b':
+          escape = "\\b";
+          break;
+        case '\f':
+          escape = "\\f";
+          break;
+        case '\n':
+          escape = "\\n";
+          break;
+        case '\r':
+          escape = "\\r";
+          break;
+        case '\t':
+          escape = "\\t";
+          break;
+      }
+      if (escape != nullptr) {
+        write(escape, 2);
         iter++;
-        break;
-      default:
-        // INVALID_STRING_CHAR
-        if (*iter < 0x20) throw invalid_string_char;
-        result.push_back(*iter);
+      } else if (ch < 0x20) {
+        char code[6] = {'\\', 'u', '0', '0', hex_digits[ch >> 4],
+                        hex_digits[ch & 0xF]};
+        write(code, 6);
         iter++;
-        break;
+      } else {
+        // other chars are written as they are, if they are valid
+        int length = _JSON_utf8_sequence_length(
+            reinterpret_cast<const unsigned char *>(iter),
+            reinterpret_cast<const unsigned char *>(end));
+        if (length == 0) throw std::invalid_argument("invalid UTF-8");
+        write(iter, static_cast<std::size_t>(length));
+        iter += length;
+      }
     }
+    put('\"');
   }
-  throw miss_quotation_mark;
-}
-inline static std::string _JSON_parse_string_iter(
-    std::string::const_iterator &&begin) {
-  return _JSON_parse_string_iter(begin);
-}
+
+  inline void put(char ch) {
+    if (size == sizeof(buffer)) flush();
+    buffer[size++] = ch;
+  }
+  inline void write(const char *data, std::size_t length) {
+    if (length > sizeof(buffer) - size) {
+      flush();
+      if (length > sizeof(buffer)) {
+        sink(data, length);
+        return;
+      }
+    }
+    std::copy(data, data + length, buffer + size);
+    size += length;
+  }
+
+  Sink &sink;
+  std::size_t size = 0;
+  char buffer[4096];
+};
+
 namespace s2ujson {
 /**
- * @brief private function that only exist for testing
+ * @brief write the canonical form of `value` (RFC 8785, JCS) to `sink`, in
+ * one pass and without building the string. `sink` is called as
+ * `sink(const char *data, std::size_t size)`, so it can be a hash like
+ * `JSON_SHA256`.
+ * @details the keys are sorted by UTF-16 code units, numbers are written as
+ * ECMAScript writes doubles (integers which don't fit a double exactly are
+ * rounded, as in I-JSON) and strings are only escaped where they must be.
+ * `std::invalid_argument` is thrown for a number which is not finite or a
+ * string which is not valid UTF-8, the output is incomplete then.
  *
- * @param json
- * @return std::string
+ * @tparam Sink
+ * @param value
+ * @param sink
  */
-inline static std::string JSON_parse_string(const std::string &json) {
-  return _JSON_parse_string_iter(json.begin());
+template <typename Sink, typename = std::enable_if_t<std::is_invocable_v<
+                              Sink &, const char *, std::size_t>>>
+inline static void JSON_canonicalize(const JSON_Data &value, Sink &&sink) {
+  _JSON_Canonical_Writer<std::remove_reference_t<Sink>> writer(sink);
+  writer.write_value(value);
 }
-inline static std::string JSON_parse_string(const std::string &&json) {
-  return JSON_parse_string(json);
+inline static void JSON_canonicalize(const JSON_Data &value,
+                                     std::string &output) {
+  JSON_canonicalize(value, [&](const char *data, std::size_t size) {
+    output.append(data, size);
+  });
+}
+inline static void JSON_canonicalize(const JSON_Data &value,
+                                     std::ostream &output) {
+  JSON_canonicalize(value, [&](const char *data, std::size_t size) {
+    output.write(data, size);
+  });
+}
+inline static std::string JSON_canonical(const JSON_Data &value) {
+  std::string output;
+  JSON_canonicalize(value, output);
+  return output;
 }
-}  // namespace s2ujson
-// forward decalration, so it can be used in parsing array
-inline static s2ujson::JSON_Object _JSON_parse_object_iter(
-    std::string::const_iterator &begin);
 
 /**
- * @brief private function that parse `array` type in JSON. use
- * `JSON_parse_array` instead
+ * @brief SHA-256 (FIPS 180-4) as a sink of `JSON_canonicalize`, to hash the
+ * canonical form without keeping it
  *
- * @param begin
- * @return std::vector<JSON_Data>
  */
-inline static std::vector<s2ujson::JSON_Data> _JSON_parse_array_iter(
-    std::string::const_iterator &begin) {
-  auto iter = begin;
-  if (*iter != '[') throw array_is_invalid;
-  iter++;
-  auto next_start_pos = iter;
-  auto next_end_pos = iter;
-  std::vector<s2ujson::JSON_Data> array;
-  while (*iter != '\0') {
-    switch (*iter) {
-      case ']':
-        begin = iter + 1;
-        return array;
-      case 'n': {
-        array.emplace_back(
-            s2ujson::JSON_parse_null(std::string(iter, iter + 4)));
-        iter += 4;
-        next_start_pos = next_end_pos = iter;
-        break;
-      }
-      case 't': {
-        array.emplace_back(
-            s2ujson::JSON_parse_true(std::string(iter, iter + 4)));
-        iter += 4;
-        next_start_pos = next_end_pos = iter;
-        break;
-      }
-      case 'f': {
-        array.emplace_back(
-            s2ujson::JSON_parse_false(std::string(iter, iter + 5)));
-        iter += 5;
-        next_start_pos = next_end_pos = iter;
-        break;
-      }
-      case '\"': {
-        array.emplace_back(_JSON_parse_string_iter(iter));
-        break;
-      }
-      case '[': {
-        array.emplace_back(_JSON_parse_array_iter(iter));
-        break;
-      }
-      case '{': {
-        array.emplace_back(_JSON_parse_object_iter(iter));
-        break;
-      }
-      default: {
-        if (*iter != ' ' && *iter != ',' && *iter != '\n') {
-          array.emplace_back(_JSON_parse_number_iter(iter));
-        } else
-          iter++;
+class JSON_SHA256 {
+ public:
+  JSON_SHA256() { reset(); }
+
+  inline void reset() {
+    static constexpr std::uint32_t initial[8] = {
+        0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+        0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
+    std::copy(initial, initial + 8, state);
+    block_size = 0;
+    length = 0;
+  }
+  inline void update(const char *data, std::size_t size) {
+    length += size;
+    while (size != 0) {
+      std::size_t part = std::min(size, sizeof(block) - block_size);
+      std::memcpy(block + block_size, data, part);
+      block_size += part;
+      data += part;
+      size -= part;
+      if (block_size == sizeof(block)) {
+        compress(block);
+        block_size = 0;
       }
     }
   }
-  throw array_is_invalid;
-}
-inline static std::vector<s2ujson::JSON_Data> _JSON_parse_array_iter(
-    std::string::const_iterator &&begin) {
-  return _JSON_parse_array_iter(begin);
-}
+  inline void operator()(const char *data, std::size_t size) {
+    update(data, size);
+  }
+
+  // the hash of the data so far, more data can still be added after
+  inline std::array<std::uint8_t, 32> digest() const {
+    JSON_SHA256 last = *this;
+    std::uint64_t bits = length * 8;
+    char padding[72] = {static_cast<char>(0x80)};
+    std::size_t padding_size = (block_size < 56 ? 56 : 120) - block_size;
+    for (int i = 0; i < 8; i++) {
+      padding[padding_size + i] = static_cast<char>(bits >> (56 - 8 * i));
+    }
+    last.update(padding, padding_size + 8);
+    std::array<std::uint8_t, 32> result;
+    for (int i = 0; i < 32; i++) {
+      result[i] = static_cast<std::uint8_t>(last.state[i / 4] >>
+                                            (24 - 8 * (i % 4)));
+    }
+    return result;
+  }
+  inline std::string hex_digest() const {
+    static const char hex_digits[] = "0123456789abcdef";
+    std::string result;
+    for (auto byte : digest()) {
+      result.push_back(hex_digits[byte >> 4]);
+      result.push_back(hex_digits[byte & 0xF]);
+    }
+    return result;
+  }
+
+ private:
+  inline static std::uint32_t rotate(std::uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+  }
+  inline void compress(const unsigned char *data) {
+    static constexpr std::uint32_t k[64] = {
+        0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1,
+        0x923F82A4, 0xAB1C5ED5, 0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+        0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174, 0xE49B69C1, 0xEFBE4786,
+        0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+        0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147,
+        0x06CA6351, 0x14292967, 0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+        0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85, 0xA2BFE8A1, 0xA81A664B,
+        0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+        0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A,
+        0x5B9CCA4F, 0x682E6FF3, 0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+        0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2};
+    std::uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+      w[i] = std::uint32_t(data[4 * i]) << 24 |
+             std::uint32_t(data[4 * i + 1]) << 16 |
+             std::uint32_t(data[4 * i + 2]) << 8 | data[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+      std::uint32_t s0 =
+          rotate(w[i - 15], 7) ^ rotate(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      std::uint32_t s1 =
+          rotate(w[i - 2], 17) ^ rotate(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    std::uint32_t v[8];
+    std::copy(state, state + 8, v);
+    for (int i = 0; i < 64; i++) {
+      std::uint32_t s1 = rotate(v[4], 6) ^ rotate(v[4], 11) ^ rotate(v[4], 25);
+      std::uint32_t choose = (v[4] & v[5]) ^ (~v[4] & v[6]);
+      std::uint32_t t1 = v[7] + s1 + choose + k[i] + w[i];
+      std::uint32_t s0 = rotate(v[0], 2) ^ rotate(v[0], 13) ^ rotate(v[0], 22);
+      std::uint32_t major = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+      std::copy_backward(v, v + 7, v + 8);
+      v[4] += t1;
+      v[0] = t1 + s0 + major;
+    }
+    for (int i = 0; i < 8; i++) state[i] += v[i];
+  }
+
+  std::uint32_t state[8];
+  unsigned char block[64];
+  std::size_t block_size;
+  std::uint64_t length;
+};
+}  // namespace s2ujson
+
+// parallel dump
+// arrays and objects with fewer values are not split between threads
+#ifndef S2UJSON_PARALLEL_DUMP_MIN_SIZE
+#define S2UJSON_PARALLEL_DUMP_MIN_SIZE 4096
+#endif
+
+// forward declaration
+class _JSON_Parallel_Dump;
+
 namespace s2ujson {
 /**
- * @brief parse `array` type in JSON.
+ * @brief options of `JSON_dump_parallel`
  *
- * @param json
- * @return std::vector<JSON_Data>
  */
-inline static std::vector<JSON_Data> JSON_parse_array(const std::string &json) {
-  return _JSON_parse_array_iter(json.cbegin());
-}
-inline static std::vector<JSON_Data> JSON_parse_array(
-    const std::string &&json) {
-  return JSON_parse_array(json);
-}
+struct JSON_Dump_Options {
+  // write non-ASCII chars as `\uXXXX`
+  bool escape_unicode = false;
+  // the threads which write, the calling thread is one of them. 0 is
+  // `std::thread::hardware_concurrency()`
+  unsigned threads = 0;
+  // arrays and objects with fewer values are written by one thread
+  std::size_t min_size = S2UJSON_PARALLEL_DUMP_MIN_SIZE;
+};
+
+/**
+ * @brief the output of `JSON_dump_parallel`, the pieces written by the
+ * threads in order. They can be written out with `JSON_writev` without being
+ * joined first.
+ *
+ */
+class JSON_Parallel_Output {
+ public:
+  inline void clear() { pieces.clear(); }
+  // bytes of the whole output
+  inline std::size_t size() const {
+    std::size_t result = 0;
+    for (auto &i : pieces) result += i.size();
+    return result;
+  }
+  inline std::size_t piece_count() const { return pieces.size(); }
+  /**
+   * @brief call `sink(const char *data, std::size_t size)` for each piece
+   * of the output in order, empty pieces are skipped
+   *
+   * @tparam Sink
+   * @param sink
+   */
+  template <typename Sink>
+  inline void for_each(Sink &&sink) const {
+    for (auto &i : pieces) {
+      if (!i.empty()) sink(i.data(), i.size());
+    }
+  }
+  inline std::string to_string() const {
+    std::string result;
+    result.reserve(size());
+    for_each([&](const char *data, std::size_t size) {
+      result.append(data, size);
+    });
+    return result;
+  }
+#ifdef S2UJSON_HAS_WRITEV
+  // the pieces as a list for `writev`
+  inline void to_iovecs(std::vector<iovec> &result) const {
+    result.clear();
+    for_each([&](const char *data, std::size_t size) {
+      result.push_back({const_cast<char *>(data), size});
+    });
+  }
+#endif
+
+  friend class ::_JSON_Parallel_Dump;
+
+ private:
+  std::vector<std::string> pieces;
+};
 }  // namespace s2ujson
+
 /**
- * @brief private function that parse `array` type in JSON. use
- * `JSON_parse_object` instead
+ * @brief the writer of `JSON_dump_parallel`. `plan` writes the text around
+ * the large arrays and objects and splits their values into chunks, `run`
+ * writes the chunks on the threads, each to its own piece.
  *
- * @param begin
- * @return JSON_Object
  */
-inline static s2ujson::JSON_Object _JSON_parse_object_iter(
-    std::string::const_iterator &begin) {
-  auto iter = begin;
-  for (; *iter == ' '; iter++)
-    ;
-  if (*iter != '{') throw object_is_invalid;
-  iter++;
-  s2ujson::JSON_Object object;
-  bool required_key = false;
-  bool required_value = false;
-  std::string key;
-  while (*iter != '\0') {
-    switch (*iter) {
-      case '}': {
-        begin = ++iter;
-        return object;
-      }
-      case 'n': {
-        if (required_key && required_value) {
-          object.add(key, _JSON_parse_null_iter(iter));
-        } else {
-          throw object_is_invalid;
-        }
-        break;
+class _JSON_Parallel_Dump {
+ public:
+  _JSON_Parallel_Dump(s2ujson::JSON_Parallel_Output &output,
+                      const s2ujson::JSON_Dump_Options &options)
+      : pieces(output.pieces), options(options) {
+    threads = options.threads != 0 ? options.threads
+                                   : std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    pieces.emplace_back();
+  }
+
+  inline void plan(const s2ujson::JSON_Data &value) {
+    // one thread writes it all, as `dump` does
+    if (threads == 1) {
+      value.dump(pieces.back(), options.escape_unicode);
+      return;
+    }
+    if (value.is_array()) {
+      std::size_t size = value.is_packed() ? value.get_packed().size()
+                                           : value.get_array().size();
+      if (size >= options.min_size) {
+        split_array(value, size);
+        return;
       }
-      case 't': {
-        if (required_key && required_value) {
-          object.add(key, _JSON_parse_true_iter(iter));
-        } else {
-          throw object_is_invalid;
+      if (!value.is_packed()) {
+        pieces.back().push_back('[');
+        for (auto &i : value.get_array()) {
+          if (&i != &value.get_array().front()) pieces.back().push_back(',');
+          plan(i);
         }
-        break;
+        pieces.back().push_back(']');
+        return;
       }
-      case 'f': {
-        if (required_key && required_value) {
-          object.add(key, _JSON_parse_false_iter(iter));
-        } else {
-          throw object_is_invalid;
-        }
-        break;
+    } else if (value.is_object()) {
+      auto &object = value.get_object();
+      if (object.size() >= options.min_size) {
+        split_object(object);
+        return;
       }
-      case '\"': {
-        if (!required_key) {
-          auto end_pos = iter + 1;
-          for (; *end_pos != '\"'; end_pos++)
-            ;
-          key = std::string(iter + 1, end_pos);
-          required_key = true;
-          iter = end_pos + 1;
-        } else {
-          object.add(key, _JSON_parse_string_iter(iter));
-        }
-        break;
+      pieces.back().push_back('{');
+      for (auto i = object.cbegin(); i != object.cend(); i++) {
+        if (i != object.cbegin()) pieces.back().push_back(',');
+        _JSON_escape_string(pieces.back(), i->first, options.escape_unicode);
+        pieces.back().push_back(':');
+        plan(i->second);
       }
-      case '[': {
-        if (required_key && required_value) {
-          object.add(key, _JSON_parse_array_iter(iter));
-        } else {
-          throw object_is_invalid;
+      pieces.back().push_back('}');
+      return;
+    }
+    value.dump(pieces.back(), options.escape_unicode);
+  }
+
+  /**
+   * @brief write the chunks, the calling thread takes them as well. An
+   * exception of a chunk is thrown again once all the threads are done
+   *
+   */
+  inline void run() {
+    std::atomic<std::size_t> next{0};
+    std::vector<std::exception_ptr> errors(chunks.size());
+    auto work = [&]() {
+      for (std::size_t i = next.fetch_add(1, std::memory_order_relaxed);
+           i < chunks.size();
+           i = next.fetch_add(1, std::memory_order_relaxed)) {
+        try {
+          write(chunks[i]);
+        } catch (...) {
+          errors[i] = std::current_exception();
         }
-        break;
       }
-      case '{': {
-        if (required_key && required_value) {
-          object.add(key, _JSON_parse_object_iter(iter));
-        } else {
-          throw object_is_invalid;
-        }
-        break;
+    };
+    // the started threads are joined on every way out of this function
+    struct joiner {
+      std::vector<std::thread> threads;
+      ~joiner() {
+        for (auto &i : threads) i.join();
       }
-      case ':': {
-        if (required_key && !required_value) {
-          required_value = true;
-          iter++;
-        } else
-          throw object_is_invalid;
-        break;
+    } workers;
+    std::size_t count = std::min<std::size_t>(threads, chunks.size());
+    workers.threads.reserve(count);
+    try {
+      for (std::size_t i = 1; i < count; i++) {
+        workers.threads.emplace_back(work);
       }
-      case ',': {
-        if (required_key && required_value) {
-          required_key = false;
-          required_value = false;
-          key = "";
-          iter++;
-        } else {
-          throw object_is_invalid;
-        }
-        break;
+    } catch (std::system_error &) {
+      // the threads which are started and this one do the rest
+    }
+    work();
+    for (auto &i : workers.threads) i.join();
+    workers.threads.clear();
+    for (auto &i : errors) {
+      if (i) std::rethrow_exception(i);
+    }
+  }
+
+ private:
+  // the values from `begin` to `end` of an array, or from `first` to `last`
+  // of an object if `array` is nullptr
+  struct chunk {
+    const s2ujson::JSON_Data *array;
+    std::size_t begin;
+    std::size_t end;
+    s2ujson::JSON_Object::const_iterator first;
+    s2ujson::JSON_Object::const_iterator last;
+    std::size_t piece;
+  };
+
+  // a few chunks for each thread, so a slow one is shared out
+  inline std::size_t chunk_size(std::size_t size) const {
+    return std::max<std::size_t>(size / (threads * 4), 1);
+  }
+  // the piece of the next chunk, with a piece for the text after it
+  inline std::size_t add_piece() {
+    pieces.emplace_back();
+    pieces.emplace_back();
+    return pieces.size() - 2;
+  }
+  inline void split_array(const s2ujson::JSON_Data &array, std::size_t size) {
+    std::size_t step = chunk_size(size);
+    pieces.back().push_back('[');
+    for (std::size_t begin = 0; begin < size; begin += step) {
+      if (begin != 0) pieces.back().push_back(',');
+      std::size_t end = std::min(begin + step, size);
+      chunks.push_back({&array, begin, end, {}, {}, add_piece()});
+    }
+    pieces.back().push_back(']');
+  }
+  inline void split_object(const s2ujson::JSON_Object &object) {
+    std::size_t step = chunk_size(object.size());
+    pieces.back().push_back('{');
+    for (auto first = object.cbegin(); first != object.cend();) {
+      if (first != object.cbegin()) pieces.back().push_back(',');
+      auto last = first;
+      for (std::size_t i = 0; i < step && last != object.cend(); i++) last++;
+      chunks.push_back({nullptr, 0, 0, first, last, add_piece()});
+      first = last;
+    }
+    pieces.back().push_back('}');
+  }
+  inline void write(const chunk &item) {
+    std::string &output = pieces[item.piece];
+    bool escape_unicode = options.escape_unicode;
+    if (item.array == nullptr) {
+      for (auto i = item.first; i != item.last; i++) {
+        if (i != item.first) output.push_back(',');
+        _JSON_escape_string(output, i->first, escape_unicode);
+        output.push_back(':');
+        i->second.dump(output, escape_unicode);
       }
-      default: {
-        if (required_key && required_value && *iter != ' ' && *iter != '\n') {
-          object.add(key, _JSON_parse_number_iter(iter));
-        } else {
-          iter++;
-        }
+    } else if (item.array->is_packed()) {
+      item.array->get_packed().dump(output, item.begin, item.end);
+    } else {
+      auto &array = item.array->get_array();
+      for (std::size_t i = item.begin; i < item.end; i++) {
+        if (i != item.begin) output.push_back(',');
+        array[i].dump(output, escape_unicode);
       }
     }
   }
-  throw object_is_invalid;
-}
-inline static s2ujson::JSON_Object _JSON_parse_object_iter(
-    std::string::const_iterator &&begin) {
-  return _JSON_parse_object_iter(begin);
-}
+
+  std::vector<std::string> &pieces;
+  const s2ujson::JSON_Dump_Options &options;
+  std::size_t threads;
+  std::vector<chunk> chunks;
+};
+
 namespace s2ujson {
 /**
- * @brief parse `object` type in JSON.
+ * @brief `dump` on many threads. Arrays and objects with at least
+ * `options.min_size` values are split into chunks, which are written by the
+ * threads into their own pieces of `output`. The pieces joined are the same
+ * bytes as `dump` writes.
+ * @details the threads are started for each call, so it pays for large
+ * documents only. `value` must not be changed until it returns, reading it
+ * from other threads is fine.
  *
- * @param json
- * @return JSON_Object
+ * @param value
+ * @param output
+ * @param options
  */
-inline static JSON_Object JSON_parse_object(const std::string &json) {
-  return _JSON_parse_object_iter(json.cbegin());
-}
-inline static JSON_Object JSON_parse_object(const std::string &&json) {
-  return JSON_parse_object(json);
+inline static void JSON_dump_parallel(const JSON_Data &value,
+                                      JSON_Parallel_Output &output,
+                                      const JSON_Dump_Options &options = {}) {
+  output.clear();
+  _JSON_Parallel_Dump writer(output, options);
+  writer.plan(value);
+  writer.run();
 }
-}  // namespace s2ujson
-
-inline static s2ujson::JSON_Data _JSON_parse(
-    std::string::const_iterator &begin) {
-  auto iter = begin;
-  for (; *iter == ' '; iter++)
-    ;
-  if (*iter == '{') {
-    return _JSON_parse_object_iter(iter);
-  } else {
-    return _JSON_parse_array_iter(iter);
-  }
-}
-inline static s2ujson::JSON_Data _JSON_parse(
-    std::string::const_iterator &&begin) {
-  return _JSON_parse(begin);
+// append the output to `output`
+inline static void JSON_dump_parallel(const JSON_Data &value,
+                                      std::string &output,
+                                      const JSON_Dump_Options &options = {}) {
+  JSON_Parallel_Output pieces;
+  JSON_dump_parallel(value, pieces, options);
+  output.reserve(output.size() + pieces.size());
+  pieces.for_each([&](const char *data, std::size_t size) {
+    output.append(data, size);
+  });
 }
-namespace s2ujson {
-inline static JSON_Data JSON_parse(const std::string &json) {
-  return _JSON_parse(json.cbegin());
+inline static std::string JSON_dump_parallel(
+    const JSON_Data &value, const JSON_Dump_Options &options = {}) {
+  std::string output;
+  JSON_dump_parallel(value, output, options);
+  return output;
 }
 }  // namespace s2ujson
 
-#endif
\ No newline at end of file
+#endif
@@ -1,8 +1,17 @@
 #include <any>
+#include <cstdio>
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <exception>
+#include <filesystem>
+#include <fstream>
 #include <initializer_list>
 #include <iostream>
+#include <limits>
+#include <new>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
@@ -10,6 +19,8 @@
 #include <variant>
 #include <vector>
 
+// the stats and the caches are compiled out by default, the build runs the
+// tests with and without them, see CMakeLists.txt
 #include "json.hpp"
 
 using namespace s2ujson;
@@ -18,6 +29,102 @@ using namespace s2ujson;
 int test_pass = 0;
 int test_count = 0;
 
+// every allocation of the test is counted, see `test_parser`. Each thread
+// counts its own, so the threads of `JSON_dump_parallel` don't race
+thread_local std::size_t allocation_count = 0;
+thread_local std::size_t allocation_bytes = 0;
+// the replacements are not inlined, otherwise the compiler sees `free` on the
+// pointer of `new` and warns about a mismatch
+#if defined(__GNUC__)
+#define TEST_NOINLINE __attribute__((noinline))
+#else
+#define TEST_NOINLINE
+#endif
+TEST_NOINLINE void *counted_malloc(std::size_t size) {
+  allocation_count++;
+  allocation_bytes += size;
+  return std::malloc(size == 0 ? 1 : size);
+}
+TEST_NOINLINE void *counted_aligned_alloc(std::size_t size,
+                                          std::align_val_t align) {
+  allocation_count++;
+  allocation_bytes += size;
+  auto alignment = static_cast<std::size_t>(align);
+  // the size of `aligned_alloc` is a multiple of the alignment
+  size = (size + alignment - 1) / alignment * alignment;
+  return std::aligned_alloc(alignment, size == 0 ? alignment : size);
+}
+TEST_NOINLINE void *operator new(std::size_t size) {
+  if (void *ptr = counted_malloc(size)) return ptr;
+  throw std::bad_alloc();
+}
+TEST_NOINLINE void *operator new[](std::size_t size) {
+  if (void *ptr = counted_malloc(size)) return ptr;
+  throw std::bad_alloc();
+}
+TEST_NOINLINE void *operator new(std::size_t size,
+                                 const std::nothrow_t &) noexcept {
+  return counted_malloc(size);
+}
+TEST_NOINLINE void *operator new[](std::size_t size,
+                                   const std::nothrow_t &) noexcept {
+  return counted_malloc(size);
+}
+TEST_NOINLINE void *operator new(std::size_t size, std::align_val_t align) {
+  if (void *ptr = counted_aligned_alloc(size, align)) return ptr;
+  throw std::bad_alloc();
+}
+TEST_NOINLINE void *operator new[](std::size_t size, std::align_val_t align) {
+  if (void *ptr = counted_aligned_alloc(size, align)) return ptr;
+  throw std::bad_alloc();
+}
+TEST_NOINLINE void *operator new(std::size_t size, std::align_val_t align,
+                                 const std::nothrow_t &) noexcept {
+  return counted_aligned_alloc(size, align);
+}
+TEST_NOINLINE void *operator new[](std::size_t size, std::align_val_t align,
+                                   const std::nothrow_t &) noexcept {
+  return counted_aligned_alloc(size, align);
+}
+TEST_NOINLINE void operator delete(void *ptr) noexcept { std::free(ptr); }
+TEST_NOINLINE void operator delete[](void *ptr) noexcept { std::free(ptr); }
+TEST_NOINLINE void operator delete(void *ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+TEST_NOINLINE void operator delete[](void *ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+TEST_NOINLINE void operator delete(void *ptr,
+                                   const std::nothrow_t &) noexcept {
+  std::free(ptr);
+}
+TEST_NOINLINE void operator delete[](void *ptr,
+                                     const std::nothrow_t &) noexcept {
+  std::free(ptr);
+}
+TEST_NOINLINE void operator delete(void *ptr, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+TEST_NOINLINE void operator delete[](void *ptr, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+TEST_NOINLINE void operator delete(void *ptr, std::size_t,
+                                   std::align_val_t) noexcept {
+  std::free(ptr);
+}
+TEST_NOINLINE void operator delete[](void *ptr, std::size_t,
+                                     std::align_val_t) noexcept {
+  std::free(ptr);
+}
+TEST_NOINLINE void operator delete(void *ptr, std::align_val_t,
+                                   const std::nothrow_t &) noexcept {
+  std::free(ptr);
+}
+TEST_NOINLINE void operator delete[](void *ptr, std::align_val_t,
+                                     const std::nothrow_t &) noexcept {
+  std::free(ptr);
+}
+
 template <typename T>
 void EXPECT_EQ_BASE(bool equality, int line_num, T expect, T actual) {
   test_count++;
@@ -67,6 +174,20 @@ void EXPECT_EXCEPTION(int line_num, std::string json, value_t type,
   }
 }
 
+template <typename T>
+void EXPECT_EXCEPTION_PATCH(int line_num, JSON_Data &document,
+                            std::string patch, T expected) try {
+  test_count++;
+  document.apply_patch(JSON_parse(patch));
+  std::cerr << line_num << std::endl;
+} catch (T &e) {
+  if (std::string(e.what()) == std::string(expected.what())) {
+    test_pass++;
+  } else {
+    std::cerr << line_num << expected.what() << " : " << e.what() << std::endl;
+  }
+}
+
 template <typename T>
 void EXPECT_EQ_INT(int line_num, T expect, T actual) {
   EXPECT_EQ_BASE(expect == actual, line_num, expect, actual);
@@ -586,6 +707,1352 @@ void test_API() {
   EXPECT_EQ_INT(__LINE__, false, obj2.get<bool>("boolean"));
 }
 
+void test_validate() {
+  EXPECT_EQ_INT(__LINE__, true, JSON_validate("null"));
+  EXPECT_EQ_INT(__LINE__, true, JSON_validate(" -1.5e+10 "));
+  EXPECT_EQ_INT(__LINE__, true, JSON_validate("\"\\u20AC \xE2\x82\xAC\""));
+  EXPECT_EQ_INT(__LINE__, true, JSON_validate("[ ]"));
+  EXPECT_EQ_INT(__LINE__, true, JSON_validate("{\t}"));
+  EXPECT_EQ_INT(__LINE__, true,
+                JSON_validate("{\"a\":[1,{\"b\":null},\"\\uD834\\uDD1E\"],"
+                              "\r\n\"c\\\"\":{}}"));
+  EXPECT_EQ_INT(__LINE__, false, JSON_validate(""));
+  EXPECT_EQ_INT(__LINE__, false, JSON_validate("[1,]"));
+  EXPECT_EQ_INT(__LINE__, false, JSON_validate("{\"a\" 1}"));
+  EXPECT_EQ_INT(__LINE__, false, JSON_validate("{\"a\":1,}"));
+  EXPECT_EQ_INT(__LINE__, false, JSON_validate("[1] 2"));
+  EXPECT_EQ_INT(__LINE__, false, JSON_validate("[1}"));
+  EXPECT_EQ_INT(__LINE__, false, JSON_validate("[\"abc"));
+  EXPECT_EQ_INT(__LINE__, false, JSON_validate("tru"));
+  EXPECT_EQ_INT(__LINE__, false, JSON_validate("01"));
+  EXPECT_EQ_INT(__LINE__, false, JSON_validate("\"\x01\""));
+  EXPECT_EQ_INT(__LINE__, false, JSON_validate("\"\\uD800\""));
+  EXPECT_EQ_INT(__LINE__, false, JSON_validate("\"\xC0\x80\""));  // overlong
+  EXPECT_EQ_INT(__LINE__, false, JSON_validate("\"\xED\xA0\x80\""));
+  EXPECT_EQ_INT(__LINE__, false, JSON_validate("\"\xF4\x90\x80\x80\""));
+  EXPECT_EQ_INT(__LINE__, false, JSON_validate("\"\xE2\x82\""));
+  // long enough to go through the 16 bytes blocks
+  EXPECT_EQ_INT(__LINE__, true,
+                JSON_validate("\"0123456789abcdef0123456789\xC2\xA2\""));
+  EXPECT_EQ_INT(__LINE__, false,
+                JSON_validate("\"0123456789abcdef0123456789\xFF\""));
+  std::string deep(S2UJSON_MAX_DEPTH, '[');
+  deep += std::string(S2UJSON_MAX_DEPTH, ']');
+  EXPECT_EQ_INT(__LINE__, true, JSON_validate(deep));
+  EXPECT_EQ_INT(__LINE__, false, JSON_validate("[" + deep + "]"));
+}
+
+void test_to_string() {
+  EXPECT_EQ_INT(__LINE__, std::string("\"a\\\"b\\\\c\\nd\\u0001\""),
+                JSON_Data("a\"b\\c\nd\x01").to_string());
+  std::string text = "0123456789abcdef\t0123456789abcdef\xE2\x82\xAC";
+  EXPECT_EQ_INT(
+      __LINE__,
+      std::string("\"0123456789abcdef\\t0123456789abcdef\xE2\x82\xAC\""),
+      JSON_Data(text).to_string());
+  EXPECT_EQ_INT(
+      __LINE__, std::string("\"0123456789abcdef\\t0123456789abcdef\\u20AC\""),
+      JSON_Data(text).to_string(true));
+  EXPECT_EQ_INT(__LINE__, std::string("\"\\uD834\\uDD1E\""),
+                JSON_Data("\xF0\x9D\x84\x9E").to_string(true));
+  JSON_Object object;
+  object["k\"ey"] = "v";
+  object["empty"] = std::vector<JSON_Data>();
+  object["object"] = JSON_Object();
+  EXPECT_EQ_INT(
+      __LINE__,
+      std::string("{\"empty\":[],\"k\\\"ey\":\"v\",\"object\":{}}"),
+      object.to_string());
+  EXPECT_EQ_INT(__LINE__, std::string("a\"b\\c\nd\x01"),
+                JSON_parse_string(JSON_Data("a\"b\\c\nd\x01").to_string()));
+}
+
+void test_reformat() {
+  std::string json =
+      " { \"a\" : [ 1 , 2.5 , \"x y\" ] ,\r\n\t\"b\" : { } , \"c\" : [ ] , "
+      "\"d\" : { \"e\" : null } } ";
+  std::string output;
+  EXPECT_EQ_INT(__LINE__, true, JSON_minify(json, output));
+  EXPECT_EQ_INT(__LINE__,
+                std::string("{\"a\":[1,2.5,\"x y\"],\"b\":{},\"c\":[],"
+                            "\"d\":{\"e\":null}}"),
+                output);
+  output.clear();
+  EXPECT_EQ_INT(__LINE__, true, JSON_prettify(json, output, 2));
+  EXPECT_EQ_INT(__LINE__,
+                std::string("{\n"
+                            "  \"a\": [\n"
+                            "    1,\n"
+                            "    2.5,\n"
+                            "    \"x y\"\n"
+                            "  ],\n"
+                            "  \"b\": {},\n"
+                            "  \"c\": [],\n"
+                            "  \"d\": {\n"
+                            "    \"e\": null\n"
+                            "  }\n"
+                            "}"),
+                output);
+  std::ostringstream minified;
+  EXPECT_EQ_INT(__LINE__, true, JSON_minify(output, minified));
+  EXPECT_EQ_INT(__LINE__, true, JSON_validate(minified.str()));
+  output.clear();
+  EXPECT_EQ_INT(__LINE__, false, JSON_minify("[1, 2", output));
+  EXPECT_EQ_INT(__LINE__, false, JSON_prettify("{\"a\" 1}", output));
+}
+
+void test_patch() {
+  JSON_Data document = JSON_parse(
+      R"({"a" : {"b" : [1, 2, 3]}, "c" : "x", "e" : {"f" : true}, "~/" : 1})");
+  std::string before = document.to_string();
+  document.apply_patch(JSON_parse(R"([
+      {"op" : "add", "path" : "/a/b/1", "value" : 9},
+      {"op" : "remove", "path" : "/a/b/0"},
+      {"op" : "replace", "path" : "/c", "value" : {"d" : null}},
+      {"op" : "move", "from" : "/e/f", "path" : "/a/b/-"},
+      {"op" : "copy", "from" : "/a", "path" : "/g"},
+      {"op" : "test", "path" : "/~0~1", "value" : 1}
+    ])"));
+  EXPECT_EQ_INT(__LINE__,
+                std::string("{\"a\":{\"b\":[9.000000,2.000000,3.000000,true]},"
+                            "\"c\":{\"d\":null},\"e\":{},"
+                            "\"g\":{\"b\":[9.000000,2.000000,3.000000,true]},"
+                            "\"~/\":1.000000}"),
+                document.to_string());
+  // the copy doesn't share anything with the source
+  document.apply_patch(
+      JSON_parse(R"([{"op" : "remove", "path" : "/g/b/3"}])"));
+  EXPECT_EQ_INT(__LINE__, true,
+                document["a"]["b"].get_array()[3].get_bool());
+
+  // the failed test undoes every operation before it
+  document = JSON_parse(before);
+  EXPECT_EXCEPTION_PATCH(__LINE__, document, R"([
+      {"op" : "add", "path" : "/a/b/0", "value" : 0},
+      {"op" : "remove", "path" : "/c"},
+      {"op" : "move", "from" : "/e", "path" : "/a/e"},
+      {"op" : "replace", "path" : "", "value" : []},
+      {"op" : "test", "path" : "", "value" : {}}
+    ])",
+                         std::invalid_argument("patch test failed"));
+  EXPECT_EQ_INT(__LINE__, before, document.to_string());
+  EXPECT_EXCEPTION_PATCH(
+      __LINE__, document,
+      R"([{"op" : "add", "path" : "/a/b/0", "value" : 0},
+          {"op" : "move", "from" : "/c", "path" : "/x/y"}])",
+      std::invalid_argument("path is not found"));
+  EXPECT_EQ_INT(__LINE__, before, document.to_string());
+  EXPECT_EXCEPTION_PATCH(__LINE__, document,
+                         R"([{"op" : "move", "from" : "/a", "path" : "/a/b"}])",
+                         std::invalid_argument("patch is invalid"));
+  // moving to itself is a no-op only if the value exists
+  EXPECT_EXCEPTION_PATCH(__LINE__, document,
+                         R"([{"op" : "move", "from" : "/x", "path" : "/x"}])",
+                         std::invalid_argument("path is not found"));
+  document.apply_patch(
+      JSON_parse(R"([{"op" : "move", "from" : "/c", "path" : "/c"}])"));
+  EXPECT_EQ_INT(__LINE__, before, document.to_string());
+  EXPECT_EXCEPTION_PATCH(__LINE__, document,
+                         R"([{"op" : "add", "path" : "/a/b/4", "value" : 0}])",
+                         std::invalid_argument("path is not found"));
+
+  // the example of RFC 7396
+  document = JSON_parse(R"({"title" : "Goodbye!",
+      "author" : {"givenName" : "John", "familyName" : "Doe"},
+      "tags" : ["example", "sample"], "content" : "This will be unchanged"})");
+  document.apply_merge_patch(JSON_parse(R"({"title" : "Hello!",
+      "phoneNumber" : "+01-555-1234", "author" : {"familyName" : null},
+      "tags" : ["example"], "new" : {"a" : null, "b" : "c"}})"));
+  EXPECT_EQ_INT(__LINE__,
+                std::string("{\"author\":{\"givenName\":\"John\"},"
+                            "\"content\":\"This will be unchanged\","
+                            "\"new\":{\"b\":\"c\"},"
+                            "\"phoneNumber\":\"+01-555-1234\","
+                            "\"tags\":[\"example\"],\"title\":\"Hello!\"}"),
+                document.to_string());
+
+  // a copy of a patch shares its objects, so a moved copy leaves them alone
+  JSON_Data patch = JSON_parse(
+      R"([{"op" : "add", "path" : "/n", "value" : {"k" : [1, "x"]}}])");
+  std::string patch_text = patch.to_string();
+  JSON_Data copy = patch;
+  document.apply_patch(std::move(copy));
+  EXPECT_EQ_INT(__LINE__, patch_text, patch.to_string());
+  document["n"]["k"] = 2;
+  EXPECT_EQ_INT(__LINE__, patch_text, patch.to_string());
+  document.apply_patch(std::move(patch));
+  EXPECT_EQ_INT(__LINE__, std::string("{\"k\":[1.000000,\"x\"]}"),
+                document["n"].to_string());
+  JSON_Data merge = JSON_parse(R"({"m" : {"x" : {"y" : "z"}}, "t" : "u"})");
+  std::string merge_text = merge.to_string();
+  copy = merge;
+  document.apply_merge_patch(std::move(copy));
+  EXPECT_EQ_INT(__LINE__, merge_text, merge.to_string());
+  EXPECT_EQ_INT(__LINE__, std::string("{\"x\":{\"y\":\"z\"}}"),
+                document["m"].to_string());
+}
+
+void test_hash_and_diff() {
+  JSON_Data a = JSON_parse(R"({"a" : [1, "x", {"b" : null}], "c" : 2})");
+  JSON_Data b = JSON_parse(R"({"c" : 2, "a" : [1, "x", {"b" : null}]})");
+  EXPECT_EQ_INT(__LINE__, true, a == b);
+  EXPECT_EQ_INT(__LINE__, a.hash(), b.hash());
+  EXPECT_EQ_INT(__LINE__, std::hash<JSON_Data>()(a), std::hash<JSON_Data>()(b));
+  EXPECT_EQ_INT(__LINE__, JSON_Data(1).hash(), JSON_Data(1.0).hash());
+  EXPECT_EQ_INT(__LINE__, true, JSON_Data(1) == JSON_Data(1.0));
+  EXPECT_EQ_INT(__LINE__, false, JSON_Data("1") == JSON_Data(1));
+
+  // changes through `[]` reach the hash of the whole document
+  std::uint64_t before = b.hash();
+  b["a"].get_array()[2]["b"] = false;
+  EXPECT_EQ_INT(__LINE__, true, a != b);
+  EXPECT_EQ_INT(__LINE__, true, before != b.hash());
+  b["a"].get_array()[2]["b"] = nullptr;
+  EXPECT_EQ_INT(__LINE__, before, b.hash());
+
+  b["c"] = 3;
+  b["d"] = "new";
+  b["a"].get_array().pop_back();
+  b["a"].get_array().push_back(JSON_Data(true));
+  b["a"].get_array().push_back(JSON_Data(false));
+  JSON_Data patch = JSON_diff(a, b);
+  EXPECT_EQ_INT(__LINE__,
+                std::string("[{\"op\":\"replace\",\"path\":\"/a/2\","
+                            "\"value\":true},"
+                            "{\"op\":\"add\",\"path\":\"/a/-\","
+                            "\"value\":false},"
+                            "{\"op\":\"replace\",\"path\":\"/c\","
+                            "\"value\":3},"
+                            "{\"op\":\"add\",\"path\":\"/d\","
+                            "\"value\":\"new\"}]"),
+                patch.to_string());
+  a.apply_patch(patch);
+  EXPECT_EQ_INT(__LINE__, true, a == b);
+  EXPECT_EQ_INT(__LINE__, a.hash(), b.hash());
+  EXPECT_EQ_INT(__LINE__, std::string("[]"), JSON_diff(a, b).to_string());
+  // containers are walked, values of another type are replaced
+  EXPECT_EQ_INT(__LINE__,
+                std::string("[{\"op\":\"replace\",\"path\":\"/x\","
+                            "\"value\":[1.000000]}]"),
+                JSON_diff(JSON_parse(R"({"x": {"y": 1}, "z": [1, "s"]})"),
+                          JSON_parse(R"({"x": [1], "z": [1.0, "s"]})"))
+                    .to_string());
+  JSON_Data shared = b;
+  EXPECT_EQ_INT(__LINE__, std::string("[]"),
+                JSON_diff(shared, b).to_string());
+
+  // an object shared with another document is changed through it
+  JSON_Data inner = JSON_parse(R"({"k" : 1, "l" : [1, 2]})");
+  JSON_Data document;
+  document["shared"] = inner;
+  JSON_Data snapshot = document.clone();
+  EXPECT_EQ_INT(__LINE__, document.hash(), snapshot.hash());
+  inner["k"] = 2;
+  EXPECT_EQ_INT(__LINE__, true, document.hash() != snapshot.hash());
+  EXPECT_EQ_INT(__LINE__, false, document == snapshot);
+  EXPECT_EQ_INT(__LINE__,
+                std::string("[{\"op\":\"replace\",\"path\":\"/shared/k\","
+                            "\"value\":2}]"),
+                JSON_diff(snapshot, document).to_string());
+  inner["k"] = 1;
+  EXPECT_EQ_INT(__LINE__, true, document == snapshot);
+  EXPECT_EQ_INT(__LINE__, snapshot.hash(), document.hash());
+  EXPECT_EQ_INT(__LINE__, std::string("[]"),
+                JSON_diff(snapshot, document).to_string());
+
+  // references kept from before the hash
+  JSON_Data &kept = document["shared"]["k"];
+  std::vector<JSON_Data> &list = document["shared"]["l"].get_array();
+  EXPECT_EQ_INT(__LINE__, snapshot.hash(), document.hash());
+  kept = 3;
+  EXPECT_EQ_INT(__LINE__, false, document == snapshot);
+  EXPECT_EQ_INT(__LINE__, true, document.hash() != snapshot.hash());
+  kept = 1;
+  EXPECT_EQ_INT(__LINE__, snapshot.hash(), document.hash());
+  list.push_back(JSON_Data(3));
+  EXPECT_EQ_INT(__LINE__, true, document.hash() != snapshot.hash());
+  list.pop_back();
+  int &number = list[0].get_int();
+  EXPECT_EQ_INT(__LINE__, snapshot.hash(), document.hash());
+  number = 5;
+  EXPECT_EQ_INT(__LINE__, true, document.hash() != snapshot.hash());
+  EXPECT_EQ_INT(__LINE__,
+                std::string("[{\"op\":\"replace\",\"path\":\"/shared/l/0\","
+                            "\"value\":5}]"),
+                JSON_diff(snapshot, document).to_string());
+}
+
+void test_const_access() {
+  const JSON_Data document =
+      JSON_parse(R"({"i" : 1.5, "s" : "str", "a" : [1, 2], "o" : {"k" : 2}})");
+  EXPECT_EQ_INT(__LINE__, 1, document["i"].get_int());
+  EXPECT_EQ_INT(__LINE__, 1, document["i"].get<int>());
+  EXPECT_EQ_INT(__LINE__, 1.5, document["i"].get_double());
+  EXPECT_EQ_INT(__LINE__, std::string("str"), document["s"].get_string());
+  EXPECT_EQ_INT(__LINE__, std::size_t(2), document["a"].get_array().size());
+  EXPECT_EQ_INT(__LINE__, true, document["i"].get_type() == value_t::NUMBER);
+  const JSON_Object &object = document.get_object();
+  EXPECT_EQ_INT(__LINE__, 2, object.get_object("o").get_int("k"));
+  EXPECT_EQ_INT(__LINE__, 2, object.get_object("o").get<int>("k"));
+  EXPECT_EQ_INT(__LINE__, 2.0, object["o"]["k"].get_double());
+  EXPECT_EQ_INT(__LINE__, true, object.find("x") == object.end());
+  int count = 0;
+  for (auto &i : object) count += i.second.is_number();
+  EXPECT_EQ_INT(__LINE__, 1, count);
+  // reading never converts the stored number
+  EXPECT_EQ_INT(__LINE__, std::string("1.500000"), document["i"].to_string());
+  bool thrown = false;
+  try {
+    object["x"];
+  } catch (std::invalid_argument &) {
+    thrown = true;
+  }
+  EXPECT_EQ_INT(__LINE__, true, thrown);
+  EXPECT_EQ_INT(__LINE__, std::size_t(4), object.size());
+}
+
+void test_lazy_numbers() {
+  JSON_Parse_Options options;
+  options.lazy_numbers = true;
+  const JSON_Data document = JSON_parse(
+      R"({"id" : 18446744073709551615, "min" : -9223372036854775808,
+          "big" : 123456789012345678901234567890, "f" : 1.50, "n" : [1, 2.0]})",
+      options);
+  EXPECT_EQ_INT(__LINE__, std::uint64_t(18446744073709551615ULL),
+                document["id"].get_uint64());
+  EXPECT_EQ_INT(__LINE__, std::numeric_limits<std::int64_t>::min(),
+                document["min"].get_int64());
+  EXPECT_EQ_INT(__LINE__, std::string("123456789012345678901234567890"),
+                document["big"].get<JSON_Number>().get_raw());
+  EXPECT_EQ_INT(__LINE__, 1.5, document["f"].get_double());
+  EXPECT_EQ_INT(__LINE__, std::int64_t(1), document["f"].get_int64());
+  // numbers are written back as they were
+  EXPECT_EQ_INT(__LINE__,
+                std::string("{\"big\":123456789012345678901234567890,"
+                            "\"f\":1.50,\"id\":18446744073709551615,"
+                            "\"min\":-9223372036854775808,\"n\":[1,2.0]}"),
+                document.to_string());
+  // numbers are equal by value, whatever they are stored as
+  EXPECT_EQ_INT(__LINE__, true, document["n"] == JSON_parse("[1, 2]"));
+  EXPECT_EQ_INT(__LINE__, true,
+                document["n"].hash() == JSON_parse("[1, 2]").hash());
+  const std::uint64_t max = 18446744073709551615ULL;
+  EXPECT_EQ_INT(__LINE__, true, document["id"] == JSON_Data(max));
+  EXPECT_EQ_INT(__LINE__, false, document["id"] == JSON_Data(max - 1));
+  EXPECT_EQ_INT(__LINE__, false, document["f"] == JSON_Data(1));
+  bool thrown = false;
+  try {
+    document["id"].get_int64();
+  } catch (std::out_of_range &) {
+    thrown = true;
+  }
+  EXPECT_EQ_INT(__LINE__, true, thrown);
+  // the mutable getters convert as before
+  JSON_Data number(JSON_Number("42"));
+  EXPECT_EQ_INT(__LINE__, 42, number.get_int());
+  EXPECT_EQ_INT(__LINE__, std::string("42"), number.to_string());
+  JSON_Data large(std::int64_t(-9007199254740993));
+  EXPECT_EQ_INT(__LINE__, std::string("-9007199254740993"), large.to_string());
+}
+
+#ifdef S2UJSON_STATS
+static std::size_t callback_calls = 0;
+void test_stats() {
+  JSON_stats_reset();
+  JSON_set_stats_callback([](const JSON_Stats &) { callback_calls++; });
+  const std::string json =
+      R"({"s" : "a\nb", "a" : [1, true, false, null, [[2]]], "o" : {}})";
+  JSON_Data document = JSON_parse(json);
+  JSON_Stats parse = JSON_stats();
+  EXPECT_EQ_INT(__LINE__, std::size_t(1), parse.calls);
+  EXPECT_EQ_INT(__LINE__, json.size(), parse.bytes_consumed);
+  EXPECT_EQ_INT(__LINE__, std::size_t(2), parse.node_count(value_t::OBJECT));
+  EXPECT_EQ_INT(__LINE__, std::size_t(3), parse.node_count(value_t::ARRAY));
+  EXPECT_EQ_INT(__LINE__, std::size_t(2), parse.node_count(value_t::NUMBER));
+  EXPECT_EQ_INT(__LINE__, std::size_t(1), parse.node_count(value_t::TRUE));
+  EXPECT_EQ_INT(__LINE__, std::size_t(1),
+                parse.node_count(value_t::NULL_DATA));
+  EXPECT_EQ_INT(__LINE__, std::size_t(4), parse.max_depth);
+  EXPECT_EQ_INT(__LINE__, std::size_t(3), parse.string_bytes_unescaped);
+  EXPECT_EQ_INT(__LINE__, true, parse.estimated_allocations > 0);
+  // nothing is counted without a counter
+  EXPECT_EQ_INT(__LINE__, std::size_t(0), parse.allocations);
+  EXPECT_EQ_INT(__LINE__, std::uint64_t(0), parse.serialize_nanoseconds);
+
+  // the allocations of the call, counted by the `operator new` of the test
+  JSON_set_allocation_counter([] {
+    return JSON_Allocation_Count{allocation_count, allocation_bytes};
+  });
+  JSON_stats_reset();
+  std::size_t count_before = allocation_count;
+  std::size_t bytes_before = allocation_bytes;
+  JSON_Data counted = JSON_parse(json);
+  parse = JSON_stats();
+  EXPECT_EQ_INT(__LINE__, allocation_count - count_before, parse.allocations);
+  EXPECT_EQ_INT(__LINE__, allocation_bytes - bytes_before,
+                parse.bytes_allocated);
+  EXPECT_EQ_INT(__LINE__, true, parse.allocations > 0);
+  JSON_set_allocation_counter(nullptr);
+
+  JSON_stats_reset();
+  std::string output = document.to_string();
+  JSON_Stats dump = JSON_stats();
+  EXPECT_EQ_INT(__LINE__, std::size_t(1), dump.calls);
+  EXPECT_EQ_INT(__LINE__, output.size(), dump.bytes_written);
+  EXPECT_EQ_INT(__LINE__, std::size_t(2), dump.node_count(value_t::OBJECT));
+  EXPECT_EQ_INT(__LINE__, std::size_t(4), dump.max_depth);
+  EXPECT_EQ_INT(__LINE__, std::size_t(3), callback_calls);
+  JSON_set_stats_callback(nullptr);
+  JSON_stats_reset();
+}
+#endif
+
+void test_memory_usage() {
+  const std::string long_string(100, 'x');
+  JSON_Data document = JSON_parse("{\"" + long_string + "\" : [\"" +
+                                  long_string + "\", 1, 2], \"k\" : {}}");
+  JSON_Memory_Usage usage = document.memory_usage();
+  EXPECT_EQ_INT(__LINE__, true, usage.keys >= long_string.size());
+  EXPECT_EQ_INT(__LINE__, true, usage.strings >= long_string.size());
+  // two values in the root object, three in the array
+  EXPECT_EQ_INT(__LINE__, 5 * sizeof(JSON_Data), usage.nodes);
+  EXPECT_EQ_INT(__LINE__, true, usage.overhead > 0);
+  EXPECT_EQ_INT(__LINE__, usage.nodes + usage.keys + usage.strings +
+                              usage.overhead + usage.slack,
+                usage.total());
+  // capacity left from editing
+  auto &array = document.get_object().find(long_string)->second.get_array();
+  array.reserve(64);
+  array[0].get_string().reserve(1000);
+  JSON_Memory_Usage reserved = document.memory_usage();
+  EXPECT_EQ_INT(__LINE__, true,
+                reserved.slack >= 900 + 61 * sizeof(JSON_Data));
+  EXPECT_EQ_INT(__LINE__, usage.total() - usage.slack,
+                reserved.total() - reserved.slack);
+
+  const std::string before = document.to_string();
+  std::uint64_t hash = document.hash();
+  document.shrink_to_fit();
+  JSON_Memory_Usage shrunk = document.memory_usage();
+  EXPECT_EQ_INT(__LINE__, std::size_t(0), shrunk.slack);
+  EXPECT_EQ_INT(__LINE__, usage.total() - usage.slack, shrunk.total());
+  EXPECT_EQ_INT(__LINE__, before, document.to_string());
+  EXPECT_EQ_INT(__LINE__, hash, document.hash());
+  EXPECT_EQ_INT(__LINE__, std::size_t(0), JSON_Data(1).memory_usage().total());
+}
+
+void test_parse_depth() {
+  std::string deep;
+  for (int i = 0; i < 5000; i++) deep += "[{\"k\":";
+  deep += "1";
+  for (int i = 0; i < 5000; i++) deep += "}]";
+  bool thrown = false;
+  try {
+    JSON_parse(deep);
+  } catch (std::invalid_argument &e) {
+    thrown = std::string(e.what()) == "nesting is too deep";
+  }
+  EXPECT_EQ_INT(__LINE__, true, thrown);
+  // no recursion, so it only takes a larger limit
+  JSON_Parse_Options options;
+  options.max_depth = 10000;
+  JSON_Data document = JSON_parse(deep, options);
+  const JSON_Data *node = &document;
+  for (int i = 0; i < 5000; i++) node = &node->get_array()[0]["k"];
+  EXPECT_EQ_INT(__LINE__, 1, node->get_int());
+  options.max_depth = 2;
+  EXPECT_EQ_INT(__LINE__, std::size_t(1),
+                JSON_parse("[[1]]", options).get_array().size());
+
+  // the stack of the thread is reused after a failure
+  EXPECT_EQ_INT(__LINE__, true,
+                JSON_parse("{\t\"a\"\r\n:\t[1\t,true]}") ==
+                    JSON_parse("{\"a\":[1,true]}"));
+  EXPECT_EXCEPTION(__LINE__, "[1,]", value_t::ARRAY,
+                   std::invalid_argument("array is invalid"));
+  EXPECT_EXCEPTION(__LINE__, "[1 2]", value_t::ARRAY,
+                   std::invalid_argument("array is invalid"));
+  EXPECT_EXCEPTION(__LINE__, "[[1]", value_t::ARRAY,
+                   std::invalid_argument("array is invalid"));
+  EXPECT_EXCEPTION(__LINE__, "{\"a\":1,}", value_t::OBJECT,
+                   std::invalid_argument("object is invalid"));
+  EXPECT_EXCEPTION(__LINE__, "{\"a\" 1}", value_t::OBJECT,
+                   std::invalid_argument("object is invalid"));
+}
+
+void test_tokenizer() {
+  // escaped keys are unescaped like string values
+  JSON_Object object = JSON_parse_object("{\"a\\nb\":1,\"\\u00e9\":2}");
+  EXPECT_EQ_INT(__LINE__, true, object.find("a\nb") != object.end());
+  EXPECT_EQ_INT(__LINE__, true, object.find("\xC3\xA9") != object.end());
+  // raw UTF-8 is kept as it is
+  EXPECT_EQ_INT(__LINE__, std::string("\xE4\xB8\xAD"),
+                JSON_parse_string("\"\xE4\xB8\xAD\""));
+  EXPECT_EQ_INT(__LINE__, std::size_t(3),
+                JSON_parse("\r\n\t [true ,false,\tnull]\r\n")
+                    .get_array()
+                    .size());
+  // the literals are not read past the end of the text
+  EXPECT_EXCEPTION(__LINE__, "[tru", value_t::ARRAY,
+                   std::invalid_argument("literial \"true\" is not correct"));
+  EXPECT_EXCEPTION(__LINE__, "[fals", value_t::ARRAY,
+                   std::invalid_argument("literial \"false\" is not correct"));
+  EXPECT_EXCEPTION(__LINE__, "[1", value_t::ARRAY,
+                   std::invalid_argument("array is invalid"));
+  EXPECT_EQ_INT(__LINE__, 12.5,
+                JSON_parse("[12.5]").get_array()[0].get_double());
+}
+
+void test_parser() {
+  std::string message =
+      "{\"request identifier\":\"0123456789abcdef0123\",\"values\":"
+      "[1,2.5,true,null,\"a string longer than the small buffer\"],"
+      "\"nested object\":{\"an escaped \\\"key\\\"\":[[],{}]}}";
+  JSON_Parser parser;
+  JSON_Data result;
+  parser.parse_into(result, message);
+  EXPECT_EQ_INT(__LINE__, true, result == JSON_parse(message));
+  parser.parse_into(result, message);
+  std::size_t before = allocation_count;
+  parser.parse_into(result, message);
+  EXPECT_EQ_INT(__LINE__, std::size_t(0), allocation_count - before);
+  EXPECT_EQ_INT(__LINE__, true, result == JSON_parse(message));
+
+  // a copy shares the objects, which are not used again while it lives
+  JSON_Data copy = result;
+  parser.parse_into(result, "[\"other\"]");
+  EXPECT_EQ_INT(__LINE__, true, copy == JSON_parse(message));
+  EXPECT_EQ_INT(__LINE__, std::string("other"),
+                result.get_array()[0].get_string());
+  bool thrown = false;
+  try {
+    parser.parse_into(result, "{\"a\":[1,}");
+  } catch (std::invalid_argument &) {
+    thrown = true;
+  }
+  EXPECT_EQ_INT(__LINE__, true, thrown);
+  parser.parse_into(result, " {\"a\":1,\"a\":2}");
+  EXPECT_EQ_INT(__LINE__, 1, result["a"].get_int());
+}
+
+void test_gather_dump() {
+  std::string plain(100, 'a');
+  std::string escaped = std::string(100, 'b') + "\n";
+  std::string key(80, 'k');
+  JSON_Data document = {{"short", "abc"},
+                        {"plain", plain},
+                        {"escaped", escaped},
+                        {key, JSON_Data({1, 2.5, true, nullptr, plain})}};
+  JSON_Gather_Output output;
+  document.dump(output);
+  EXPECT_EQ_INT(__LINE__, document.to_string(), output.to_string());
+  EXPECT_EQ_INT(__LINE__, document.to_string().size(), output.size());
+  // the long key and the two long plain strings
+  EXPECT_EQ_INT(__LINE__, std::size_t(3), output.reference_count());
+  bool in_place = false;
+  output.for_each([&](const char *data, std::size_t) {
+    in_place = in_place || data == document["plain"].get_string().data();
+  });
+  EXPECT_EQ_INT(__LINE__, true, in_place);
+  output.clear();
+  JSON_Data(std::vector<JSON_Data>()).dump(output);
+  EXPECT_EQ_INT(__LINE__, std::string("[]"), output.to_string());
+  output.clear();
+  document.dump(output, true);
+  EXPECT_EQ_INT(__LINE__, document.to_string(true), output.to_string());
+#ifdef S2UJSON_HAS_WRITEV
+  output.clear();
+  document.dump(output);
+  std::FILE *file = std::tmpfile();
+  EXPECT_EQ_INT(__LINE__, output.size(), JSON_writev(fileno(file), output));
+  std::rewind(file);
+  std::string written(output.size(), '\0');
+  std::fread(&written[0], 1, written.size(), file);
+  std::fclose(file);
+  EXPECT_EQ_INT(__LINE__, document.to_string(), written);
+#endif
+}
+
+void test_array_reader() {
+  std::string json =
+      " [1, \"two ] \\\" ,\" ,{\"a\":[3,{\"b\":\"}\"}]},[],null,-2.5e1,"
+      "true]";
+  JSON_Data expect = JSON_parse(json);
+  auto read_all = [&](JSON_ArrayReader &reader) {
+    std::vector<JSON_Data> result;
+    JSON_Data element;
+    while (reader.next(element)) result.push_back(element);
+    return result;
+  };
+  JSON_ArrayReader reader(json);
+  EXPECT_EQ_INT(__LINE__, true, read_all(reader) == expect.get_array());
+  EXPECT_EQ_INT(__LINE__, std::size_t(7), reader.index());
+  // chunks of 3 bytes, so most elements are split
+  std::istringstream input(json);
+  JSON_ArrayReader stream_reader(input, {}, 3);
+  EXPECT_EQ_INT(__LINE__, true, read_all(stream_reader) == expect.get_array());
+
+  JSON_Data element;
+  JSON_ArrayReader empty(" [ ] \n");
+  EXPECT_EQ_INT(__LINE__, false, empty.next(element));
+  EXPECT_EQ_INT(__LINE__, false, empty.next(element));
+  // a truncated or concatenated text is not taken for the array
+  for (const char *invalid : {"[1 2]", "[1,]", "[1,", "[[1]", "{}", "[1a]",
+                              "[1,2] garbage {", "[1]]", "[] []"}) {
+    JSON_ArrayReader invalid_reader(invalid);
+    bool thrown = false;
+    try {
+      while (invalid_reader.next(element)) {
+      }
+    } catch (std::invalid_argument &) {
+      thrown = true;
+    }
+    EXPECT_EQ_INT(__LINE__, true, thrown);
+  }
+#ifdef S2UJSON_HAS_MMAP
+  auto path = std::filesystem::temp_directory_path() / "s2ujson_reader.json";
+  std::ofstream(path) << json;
+  {
+    JSON_Mapped_File file(path.string());
+    JSON_ArrayReader file_reader(file.view());
+    EXPECT_EQ_INT(__LINE__, true, read_all(file_reader) == expect.get_array());
+  }
+  std::filesystem::remove(path);
+#endif
+}
+
+void test_schema() {
+  JSON_Schema schema(JSON_parse(R"({
+    "type": "object",
+    "required": ["id", "email", "tags"],
+    "properties": {
+      "id": {"type": "integer", "minimum": 1, "exclusiveMaximum": 1000},
+      "email": {"type": "string", "format": "email", "maxLength": 64},
+      "name": {"type": ["string", "null"], "minLength": 2},
+      "tags": {"type": "array", "maxItems": 3,
+               "items": {"enum": ["a", "b", 1.5, null]}},
+      "created": {"format": "date-time"},
+      "address": {"type": "string", "format": "ipv4"},
+      "uuid": {"format": "uuid"},
+      "extra": {"type": "object", "maxProperties": 1, "required": ["é"]}
+    }
+  })"));
+  auto expect = [&](int line, bool valid, const std::string &json) {
+    EXPECT_EQ_INT(line, valid, schema.validate(JSON_parse(json)));
+    EXPECT_EQ_INT(line, valid, schema.validate_text(json));
+  };
+  expect(__LINE__, true,
+         R"({"id": 1, "email": "a.b@example.com", "tags": ["a", 1.5, null],
+            "name": null, "created": "2024-02-29T23:59:60.5+08:00",
+            "address": "192.168.0.1", "other": [1, {"x": 2}],
+            "uuid": "123e4567-e89b-12d3-a456-426614174000",
+            "extra": {"é": {}}})");
+  expect(__LINE__, true, R"({"id": 999.0, "email": "x@y", "tags": []})");
+  expect(__LINE__, false, R"({"id": 1, "email": "x@y"})");
+  expect(__LINE__, false, R"({"id": 0, "email": "x@y", "tags": []})");
+  expect(__LINE__, false, R"({"id": 1000, "email": "x@y", "tags": []})");
+  expect(__LINE__, false, R"({"id": 1.5, "email": "x@y", "tags": []})");
+  expect(__LINE__, false, R"({"id": 1, "email": "x@@y", "tags": []})");
+  expect(__LINE__, false, R"({"id": 1, "email": "x@y", "tags": ["c"]})");
+  expect(__LINE__, false,
+         R"({"id": 1, "email": "x@y", "tags": [1, 1, 1, 1]})");
+  // the length is counted in code points
+  expect(__LINE__, false,
+         R"({"id": 1, "email": "x@y", "tags": [], "name": "é"})");
+  expect(__LINE__, false, R"({"id": 1, "email": "x@y", "tags": [],
+                              "created": "2023-02-29T00:00:00Z"})");
+  expect(__LINE__, false, R"({"id": 1, "email": "x@y", "tags": [],
+                              "address": "1.02.3.4"})");
+  expect(__LINE__, false, R"({"id": 1, "email": "x@y", "tags": [],
+                              "extra": {"e": 1}})");
+  expect(__LINE__, false, R"([1])");
+  EXPECT_EQ_INT(__LINE__, false, schema.validate_text(R"({"id": 1,})"));
+
+  // escaped keys and strings are compared by their text
+  JSON_Schema keys(JSON_parse(
+      R"({"required": ["a\"b"], "properties": {"a\"b": {"enum": ["\n"]}}})"));
+  EXPECT_EQ_INT(__LINE__, true, keys.validate_text(R"({"a\"b": "\u000A"})"));
+  EXPECT_EQ_INT(__LINE__, false, keys.validate_text(R"({"a\"b": "n"})"));
+  // arrays and objects in an `enum` are compared as data
+  JSON_Schema containers(
+      JSON_parse(R"({"items": {"enum": [[1, {"a": 2}]]}})"));
+  EXPECT_EQ_INT(__LINE__, true,
+                containers.validate_text(R"([[1, {"a": 2.0}]])"));
+  EXPECT_EQ_INT(__LINE__, false,
+                containers.validate_text(R"([[1, {"a": 3}]])"));
+  // while the text is walked, in any key order and with the first value of
+  // a repeated key, like the parsed data
+  JSON_Schema members(JSON_parse(R"({"properties": {"x": {"enum": [
+      {"b": [true, null], "a": "\n", "c": {}}, [], 2]}}})"));
+  auto expect_members = [&](int line, bool valid, const std::string &json) {
+    EXPECT_EQ_INT(line, valid, members.validate(JSON_parse(json)));
+    EXPECT_EQ_INT(line, valid, members.validate_text(json));
+  };
+  expect_members(__LINE__, true,
+                 R"({"x": {"c": {}, "a": "\u000a", "b": [true, null]}})");
+  expect_members(__LINE__, true, R"({"x": {"a": "\n", "c": {},
+                                        "b": [true, null], "a": 1}})");
+  expect_members(__LINE__, false, R"({"x": {"a": 1, "c": {},
+                                         "b": [true, null], "a": "\n"}})");
+  expect_members(__LINE__, false, R"({"x": {"a": "\n", "b": [true]}})");
+  expect_members(__LINE__, false,
+                 R"({"x": {"a": "\n", "b": [true, null], "c": {"d": 1}}})");
+  expect_members(__LINE__, true, R"({"x": [], "y": [[1], {"z": 2}]})");
+  expect_members(__LINE__, true, R"({"x": 2.0})");
+  expect_members(__LINE__, false, R"({"x": [2]})");
+  EXPECT_EQ_INT(__LINE__, true,
+                JSON_Schema(JSON_parse(R"({"enum": [{"a": [1, 2]}]})"))
+                    .validate_text(R"({"a": [1.0, 2e0]})"));
+
+  std::string request =
+      R"({"id": 7, "email": "someone@example.com", "tags": ["a", "b"]})";
+  JSON_Data data = schema.parse(request);
+  EXPECT_EQ_INT(__LINE__, 7, data["id"].get_int());
+  std::string message;
+  try {
+    schema.parse(R"({"id": 7})");
+  } catch (std::invalid_argument &e) {
+    message = e.what();
+  }
+  EXPECT_EQ_INT(__LINE__, std::string("JSON doesn't match the schema"),
+                message);
+  std::size_t before = allocation_count;
+  for (int i = 0; i < 10; i++) schema.validate_text(request);
+  schema.validate(data);
+  EXPECT_EQ_INT(__LINE__, std::size_t(0), allocation_count - before);
+  bool thrown = false;
+  try {
+    JSON_Schema invalid(JSON_parse(R"({"type": "text"})"));
+  } catch (std::invalid_argument &e) {
+    thrown = std::string(e.what()) == "schema is invalid";
+  }
+  EXPECT_EQ_INT(__LINE__, true, thrown);
+}
+
+void test_shred() {
+  std::vector<JSON_Column> columns = {
+      {"/price", JSON_Column::type_t::DOUBLE},
+      {"/count", JSON_Column::type_t::INT64},
+      {"/name", JSON_Column::type_t::STRING},
+      {"/user/active", JSON_Column::type_t::BOOLEAN},
+      {"/a~1b", JSON_Column::type_t::STRING}};
+  std::string json = R"([
+    {"price": 1.5, "count": 3, "name": "apple", "user": {"active": true},
+     "a/b": "x", "skip": [{"price": 9}]},
+    {"price": -2, "count": 1e2, "name": "b\"anana", "user": {"id": 1},
+     "price": 100},
+    {"count": null, "name": null, "user": {"active": false}}
+  ])";
+  EXPECT_EQ_INT(__LINE__, std::size_t(3), JSON_shred(json, columns));
+  auto &price = columns[0], &count = columns[1], &name = columns[2];
+  auto &active = columns[3], &escaped = columns[4];
+  EXPECT_EQ_INT(__LINE__, std::size_t(3), price.size());
+  EXPECT_EQ_INT(__LINE__, 1.5, price.doubles[0]);
+  // a repeated key keeps the first value
+  EXPECT_EQ_INT(__LINE__, -2.0, price.doubles[1]);
+  EXPECT_EQ_INT(__LINE__, true, price.is_null(2));
+  EXPECT_EQ_INT(__LINE__, std::int64_t(100), count.integers[1]);
+  EXPECT_EQ_INT(__LINE__, true, count.is_null(2));
+  EXPECT_EQ_INT(__LINE__, false, count.is_null(0));
+  EXPECT_EQ_INT(__LINE__, std::string("b\"anana"),
+                std::string(name.get_string(1)));
+  EXPECT_EQ_INT(__LINE__, true, name.is_null(2) && name.get_string(2).empty());
+  EXPECT_EQ_INT(__LINE__, std::uint8_t(0), active.booleans[2]);
+  EXPECT_EQ_INT(__LINE__, true, active.is_null(1));
+  EXPECT_EQ_INT(__LINE__, std::string("x"), std::string(escaped.get_string(0)));
+
+  // the columns are cleared and used again
+  EXPECT_EQ_INT(__LINE__, std::size_t(0), JSON_shred(" [] ", columns));
+  EXPECT_EQ_INT(__LINE__, std::size_t(0), price.size());
+  std::vector<std::string> messages;
+  for (const char *invalid : {R"({"price": 1})", R"([1])",
+                              R"([{"price": "1"}])", R"([{"count": 1.5}])",
+                              R"([{"name": {}}])", R"([{"price": 1},])"}) {
+    try {
+      JSON_shred(invalid, columns);
+      messages.push_back("");
+    } catch (std::invalid_argument &e) {
+      messages.push_back(e.what());
+    }
+  }
+  std::vector<std::string> expected = {
+      "records are invalid",       "records are invalid",
+      "column type doesn't match", "column type doesn't match",
+      "column type doesn't match", "JSON is invalid"};
+  EXPECT_EQ_INT(__LINE__, true, messages == expected);
+}
+
+// parsed by the compiler, a syntax error would not compile
+static constexpr auto static_document = static_json(R"({
+  "name": "s2ujson", "version": [1, 2.5e1, -0.125],
+  "escaped": "tab\té😀", "flags": {"on": true, "off": false},
+  "none": null, "empty": []
+})");
+static_assert(static_document["version"][1].get_double() == 25);
+static_assert(static_document["flags"]["on"].get_bool());
+static_assert(static_document["escaped"].get_string() ==
+              "tab\t\xC3\xA9\xF0\x9F\x98\x80");
+
+void test_static_json() {
+  EXPECT_EQ_INT(__LINE__, true,
+                static_document.to_data() == JSON_parse(R"({
+  "name": "s2ujson", "version": [1, 25, -0.125],
+  "escaped": "tab\té😀", "flags": {"on": true, "off": false},
+  "none": null, "empty": []})"));
+  EXPECT_EQ_INT(__LINE__, std::size_t(6), static_document.size());
+  EXPECT_EQ_INT(__LINE__, -0.125,
+                static_document["version"][2].get_double());
+  EXPECT_EQ_INT(__LINE__, true, static_document.contains("none"));
+  EXPECT_EQ_INT(__LINE__, false, static_document.contains("nothing"));
+  std::string keys;
+  for (auto i : static_document["flags"]) keys += i.key();
+  EXPECT_EQ_INT(__LINE__, std::string("onoff"), keys);
+  EXPECT_EQ_INT(__LINE__, std::size_t(0), static_document["empty"].size());
+  bool thrown = false;
+  try {
+    static_document["name"].get_double();
+  } catch (std::bad_variant_access &) {
+    thrown = true;
+  }
+  EXPECT_EQ_INT(__LINE__, true, thrown);
+}
+
+void test_key_set() {
+  enum { ID, NAME, PRICE, TAGS };
+  static const JSON_Key_Set keys = {"id", "name", "price", "tags"};
+  EXPECT_EQ_INT(__LINE__, std::size_t(4), keys.size());
+  EXPECT_EQ_INT(__LINE__, std::size_t(PRICE), keys.find("price"));
+  EXPECT_EQ_INT(__LINE__, JSON_Key_Set::npos, keys.find("prices"));
+  EXPECT_EQ_INT(__LINE__, JSON_Key_Set::npos, keys.find(""));
+  // a larger set has a slot for every key
+  std::vector<std::string> names;
+  for (int i = 0; i < 200; i++) names.push_back("key" + std::to_string(i));
+  JSON_Key_Set large(names);
+  bool all_found = true;
+  for (std::size_t i = 0; i < names.size(); i++) {
+    all_found = all_found && large.find(names[i]) == i;
+  }
+  EXPECT_EQ_INT(__LINE__, true, all_found);
+  EXPECT_EQ_INT(__LINE__, JSON_Key_Set::npos, large.find("key200"));
+
+  JSON_Key_Binding binding(keys);
+  auto same = JSON_parse(R"({"tags": [], "price": 2.5, "name": "a", "id": 7})");
+  EXPECT_EQ_INT(__LINE__, true, binding.bind(same.get_object()));
+  EXPECT_EQ_INT(__LINE__, 7.0, binding[ID].get_double());
+  EXPECT_EQ_INT(__LINE__, std::string("a"), binding[NAME].get_string());
+  EXPECT_EQ_INT(__LINE__, 2.5, binding[PRICE].get_double());
+  // binding the same shape again doesn't allocate
+  std::size_t before = allocation_count;
+  binding.bind(same.get_object());
+  EXPECT_EQ_INT(__LINE__, before, allocation_count);
+
+  // other shapes fall back to the hash, missing keys are nullptr
+  auto other = JSON_parse(R"({"a": 1, "id": 8, "extra": 0, "tags": [1]})");
+  EXPECT_EQ_INT(__LINE__, false, binding.bind(other.get_object()));
+  EXPECT_EQ_INT(__LINE__, 8.0, binding[ID].get_double());
+  EXPECT_EQ_INT(__LINE__, std::size_t(1), binding[TAGS].get_array().size());
+  EXPECT_EQ_INT(__LINE__, true, binding.find(NAME) == nullptr);
+  bool thrown = false;
+  try {
+    binding[PRICE];
+  } catch (std::invalid_argument &) {
+    thrown = true;
+  }
+  EXPECT_EQ_INT(__LINE__, true, thrown);
+  thrown = false;
+  try {
+    JSON_Key_Set repeated = {"a", "b", "a"};
+  } catch (std::invalid_argument &) {
+    thrown = true;
+  }
+  EXPECT_EQ_INT(__LINE__, true, thrown);
+}
+
+void test_try_get() {
+  const JSON_Data document = JSON_parse(R"({
+    "a rather long key name": 1, "flag": true, "big": 9223372036854775808,
+    "text": "x", "list": [0, {"a/b": {"m~n": null}}], "": 2.5})");
+  const JSON_Object &object = document.get_object();
+  // keys longer than a short string are looked up without a temporary
+  std::size_t before = allocation_count;
+  std::string_view key = "a rather long key name";
+  int found = object.get_int(key) + object.count("a rather long key name") +
+              (object.find(key) != object.end()) +
+              document["a rather long key name"].get_int();
+  EXPECT_EQ_INT(__LINE__, before, allocation_count);
+  EXPECT_EQ_INT(__LINE__, 4, found);
+
+  EXPECT_EQ_INT(__LINE__, true, object.try_get<bool>("flag").value());
+  EXPECT_EQ_INT(__LINE__, false, object.try_get<int>("flag").has_value());
+  EXPECT_EQ_INT(__LINE__, false, object.try_get<bool>("none").has_value());
+  EXPECT_EQ_INT(__LINE__, 2.5, *object.try_get<double>(""));
+  EXPECT_EQ_INT(__LINE__, std::uint64_t(9223372036854775808ULL),
+                *object.try_get<std::uint64_t>("big"));
+  // out of range is empty rather than thrown
+  EXPECT_EQ_INT(__LINE__, false,
+                object.try_get<std::int64_t>("big").has_value());
+  // integers are empty when the number doesn't fit or has a fraction
+  const JSON_Data numbers = JSON_parse(
+      "[5000000000, 1e20, 2.5, -2147483648, -1, 3.0, -9223372036854775808]");
+  auto &values = numbers.get_array();
+  EXPECT_EQ_INT(__LINE__, false, values[0].try_get<int>().has_value());
+  EXPECT_EQ_INT(__LINE__, std::int64_t(5000000000LL),
+                *values[0].try_get<std::int64_t>());
+  EXPECT_EQ_INT(__LINE__, false, values[1].try_get<int>().has_value());
+  EXPECT_EQ_INT(__LINE__, false,
+                values[1].try_get<std::uint64_t>().has_value());
+  EXPECT_EQ_INT(__LINE__, 1e20, *values[1].try_get<double>());
+  EXPECT_EQ_INT(__LINE__, false, values[2].try_get<int>().has_value());
+  EXPECT_EQ_INT(__LINE__, false,
+                values[2].try_get<std::int64_t>().has_value());
+  EXPECT_EQ_INT(__LINE__, -2147483647 - 1, *values[3].try_get<int>());
+  EXPECT_EQ_INT(__LINE__, false,
+                values[4].try_get<std::uint64_t>().has_value());
+  EXPECT_EQ_INT(__LINE__, 3, *values[5].try_get<int>());
+  EXPECT_EQ_INT(__LINE__, std::numeric_limits<std::int64_t>::min(),
+                *values[6].try_get<std::int64_t>());
+  JSON_Parse_Options lazy;
+  lazy.lazy_numbers = true;
+  const JSON_Data huge = JSON_parse("[1e999, 18446744073709551616]", lazy);
+  EXPECT_EQ_INT(__LINE__, false,
+                huge.get_array()[0].try_get<double>().has_value());
+  EXPECT_EQ_INT(__LINE__, false,
+                huge.get_array()[1].try_get<std::uint64_t>().has_value());
+  EXPECT_EQ_INT(__LINE__, std::string("x"),
+                *object.try_get<std::string>("text"));
+  EXPECT_EQ_INT(__LINE__, true,
+                object.try_get<std::vector<JSON_Data>>("text") == nullptr);
+  EXPECT_EQ_INT(__LINE__, std::size_t(2),
+                object.try_get<std::vector<JSON_Data>>("list")->size());
+  EXPECT_EQ_INT(__LINE__, true,
+                object.try_get<JSON_Data>("text") == &document["text"]);
+
+  EXPECT_EQ_INT(__LINE__, true, document.find_pointer("") == &document);
+  EXPECT_EQ_INT(__LINE__, 2.5, document.find_pointer("/")->get_double());
+  EXPECT_EQ_INT(__LINE__, true,
+                document.find_pointer("/list/1/a~1b/m~0n")->is_null());
+  bool all_missing = true;
+  for (const char *missing : {"/list/2", "/list/01", "/list/-", "/text/0",
+                              "/list/1/a~1b/m~0n/x", "/none"}) {
+    all_missing = all_missing && document.find_pointer(missing) == nullptr;
+  }
+  EXPECT_EQ_INT(__LINE__, true, all_missing);
+  bool thrown = false;
+  try {
+    document.find_pointer("/list/1/a~2b");
+  } catch (std::invalid_argument &) {
+    thrown = true;
+  }
+  EXPECT_EQ_INT(__LINE__, true, thrown);
+}
+
+void test_insitu() {
+  std::string text = R"( {"name": "plain", "escaped": "a\"b\\cé😀",
+    "k\ney": [1, -2.5e3, true, false, null, [], {}], "last": {"x": "y"}} )";
+  const std::string copy = text;
+  JSON_Insitu_Document document(text);
+  EXPECT_EQ_INT(__LINE__, true, document.to_data() == JSON_parse(copy));
+  EXPECT_EQ_INT(__LINE__, std::size_t(4), document.size());
+  // the strings are views of the buffer
+  std::string_view name = document["name"].get_string();
+  EXPECT_EQ_INT(__LINE__, true,
+                name.data() > text.data() &&
+                    name.data() < text.data() + text.size());
+  EXPECT_EQ_INT(__LINE__, std::string("a\"b\\c\xC3\xA9\xF0\x9F\x98\x80"),
+                std::string(document["escaped"].get_string()));
+  EXPECT_EQ_INT(__LINE__, -2500.0, document["k\ney"][1].get_double());
+  EXPECT_EQ_INT(__LINE__, true, document.contains("last"));
+
+  // parsing again in the same document doesn't allocate
+  std::string buffer = copy;
+  document.parse(buffer);
+  std::size_t before = allocation_count;
+  buffer = copy;
+  document.parse(buffer);
+  EXPECT_EQ_INT(__LINE__, before, allocation_count);
+  EXPECT_EQ_INT(__LINE__, std::string("y"),
+                std::string(document["last"]["x"].get_string()));
+  // a node is smaller than a `JSON_Data` with its string, the rest is the
+  // scratch of the parser, kept for the next parse
+  EXPECT_EQ_INT(__LINE__, true,
+                document.memory_usage().nodes <
+                    JSON_parse(copy).memory_usage().total());
+
+  std::vector<std::string> messages;
+  for (const char *invalid : {"1", R"({"a" 1})", "[1,]", R"({"a": })",
+                              R"(["a)", "[1 2]", "[tru]"}) {
+    std::string input = invalid;
+    try {
+      document.parse(input);
+      messages.push_back("");
+    } catch (std::invalid_argument &e) {
+      messages.push_back(e.what());
+    }
+  }
+  std::vector<std::string> expected = {
+      "array is invalid",    "object is invalid", "array is invalid",
+      "object is invalid",   "miss quotation mark", "array is invalid",
+      "literial \"true\" is not correct"};
+  EXPECT_EQ_INT(__LINE__, true, messages == expected);
+  // a failed parse leaves an empty document, which can be read
+  std::string invalid = "  x";
+  try {
+    document.parse(invalid);
+  } catch (std::invalid_argument &) {
+  }
+  EXPECT_EQ_INT(__LINE__, true, document.get_type() == value_t::NULL_DATA);
+  EXPECT_EQ_INT(__LINE__, std::size_t(0), document.size());
+  EXPECT_EQ_INT(__LINE__, false, document.root().begin() != document.end());
+  EXPECT_EQ_INT(__LINE__, true, document.to_data().is_null());
+
+  // elements are indexed directly, and each is at its place
+  std::string large = "[";
+  for (int i = 0; i < 100000; i++) {
+    large += (i == 0 ? "" : ",") + std::string(i % 2 ? "[" : "") +
+             std::to_string(i) + (i % 2 ? "]" : "");
+  }
+  large += "]";
+  document.parse(large);
+  bool in_place = document.size() == 100000;
+  for (std::size_t i = 0; i < document.size(); i++) {
+    auto value = i % 2 ? document[i][0] : document[i];
+    in_place = in_place && value.get_double() == static_cast<double>(i);
+  }
+  EXPECT_EQ_INT(__LINE__, true, in_place);
+}
+
+#if defined(S2UJSON_STATS) && defined(S2UJSON_CACHED_DUMP)
+void test_cached_dump() {
+  JSON_Data document;
+  document["count"] = 0;
+  std::vector<JSON_Data> list;
+  for (int i = 0; i < 20; i++) {
+    JSON_Object item;
+    item["id"] = i;
+    item["name"] = std::string(150, 'a' + i % 26);
+    list.push_back(std::move(item));
+  }
+  document["items"] = std::move(list);
+  auto objects_written = [&](bool escape_unicode = false) {
+    JSON_stats_reset();
+    std::string output = document.to_string(escape_unicode);
+    std::size_t count = JSON_stats().node_count(value_t::OBJECT);
+    EXPECT_EQ_INT(__LINE__, true, JSON_parse(output) == document);
+    return count;
+  };
+  EXPECT_EQ_INT(__LINE__, std::size_t(21), objects_written());
+  // nothing changed, the root is copied
+  EXPECT_EQ_INT(__LINE__, std::size_t(0), objects_written());
+  // the path to a change is written again, the rest is copied
+  document["count"].set(5);
+  EXPECT_EQ_INT(__LINE__, std::size_t(1), objects_written());
+  // the array handed out by `get_array()` can change without the document
+  // knowing, so neither is cached until the array gets a new value
+  document["items"].get_array()[3]["name"] = "changed";
+  EXPECT_EQ_INT(__LINE__, std::size_t(2), objects_written());
+  EXPECT_EQ_INT(__LINE__, std::size_t(2), objects_written());
+  // the changed item is too short to be cached, so it is written with the
+  // array
+  list = std::move(document["items"].get_array());
+  list.pop_back();
+  document["items"] = std::move(list);
+  EXPECT_EQ_INT(__LINE__, std::size_t(2), objects_written());
+  // the other mode doesn't use the text
+  EXPECT_EQ_INT(__LINE__, std::size_t(20), objects_written(true));
+  EXPECT_EQ_INT(__LINE__, std::size_t(0), objects_written());
+
+  // changes through a reference kept from before the dump
+  auto &items = document["items"].get_array();
+  std::string before = document.to_string();
+  items.push_back(JSON_Data(1));
+  EXPECT_EQ_INT(__LINE__, true, document.to_string() != before);
+  EXPECT_EQ_INT(__LINE__, document.clone().to_string(), document.to_string());
+  JSON_Data &name = items[5]["name"];
+  int &id = items[6]["id"].get_int();
+  document.to_string();
+  name = "renamed";
+  EXPECT_EQ_INT(__LINE__, document.clone().to_string(), document.to_string());
+  id = 60;
+  EXPECT_EQ_INT(__LINE__, document.clone().to_string(), document.to_string());
+  EXPECT_EQ_INT(__LINE__, 60, JSON_parse(document.to_string())["items"]
+                                  .get_array()[6]["id"]
+                                  .get_int());
+
+  // changes through another handle to a shared object
+  JSON_Data inner;
+  inner["k"] = 1;
+  inner["text"] = std::string(150, 'x');
+  JSON_Data shared;
+  shared["shared"] = inner;
+  shared["other"] = std::string(150, 'y');
+  before = shared.to_string();
+  EXPECT_EQ_INT(__LINE__, std::size_t(0), [&] {
+    JSON_stats_reset();
+    shared.to_string();
+    return JSON_stats().node_count(value_t::OBJECT);
+  }());
+  inner["k"] = 2;
+  EXPECT_EQ_INT(__LINE__, true, shared.to_string() != before);
+  EXPECT_EQ_INT(__LINE__, 2, JSON_parse(shared.to_string())["shared"]["k"]
+                                 .get_int());
+  EXPECT_EQ_INT(__LINE__, shared.clone().to_string(), shared.to_string());
+  JSON_stats_reset();
+}
+#endif
+
+void test_canonical() {
+  // the example of RFC 8785
+  JSON_Data document = JSON_parse(R"({
+    "numbers": [333333333.33333329, 1E30, 4.50, 2e-3,
+                0.000000000000000000000000001],
+    "string": "\u20ac$\u000F\u000aA'\u0042\u0022\u005c\\\"\/",
+    "literals": [null, true, false]})");
+  EXPECT_EQ_INT(__LINE__,
+                std::string(R"({"literals":[null,true,false],)"
+                            R"("numbers":[333333333.3333333,1e+30,4.5,0.002,)"
+                            R"(1e-27],"string":"€$\u000f\nA'B\"\\\\\"/"})"),
+                JSON_canonical(document));
+  // the numbers of appendix B, by their bits
+  std::vector<std::pair<std::uint64_t, std::string>> numbers = {
+      {0x0000000000000000, "0"},
+      {0x8000000000000000, "0"},
+      {0x0000000000000001, "5e-324"},
+      {0x8000000000000001, "-5e-324"},
+      {0x7fefffffffffffff, "1.7976931348623157e+308"},
+      {0x4340000000000000, "9007199254740992"},
+      {0xc340000000000000, "-9007199254740992"},
+      {0x4430000000000000, "295147905179352830000"},
+      {0x44b52d02c7e14af5, "9.999999999999997e+22"},
+      {0x44b52d02c7e14af6, "1e+23"},
+      {0x444b1ae4d6e2ef50, "1e+21"},
+      {0x444b1ae4d6e2ef4f, "999999999999999900000"},
+      {0x3eb0c6f7a0b5ed8d, "0.000001"},
+      {0x3eb0c6f7a0b5ed8c, "9.999999999999997e-7"},
+      {0x41b3de4355555555, "333333333.3333333"},
+      {0x3ff0000000000001, "1.0000000000000002"}};
+  std::vector<std::string> written, expected;
+  for (auto &i : numbers) {
+    double number;
+    std::memcpy(&number, &i.first, sizeof(number));
+    written.push_back(JSON_canonical(JSON_Data(number)));
+    expected.push_back(i.second);
+  }
+  EXPECT_EQ_INT(__LINE__, true, written == expected);
+  EXPECT_EQ_INT(__LINE__, std::string("[-12,100]"),
+                JSON_canonical(JSON_parse("[-12, 1e2]")));
+  // keys by UTF-16 code units, the emoji is a surrogate pair before U+FB33
+  EXPECT_EQ_INT(__LINE__,
+                std::string("{\"\\r\":1,\"1\":2,\"\xC2\x80\":3,\"\xC3\xB6\":4,"
+                            "\"\xE2\x82\xAC\":5,\"\xF0\x9F\x98\x80\":6,"
+                            "\"\xEF\xAC\xB3\":7}"),
+                JSON_canonical(JSON_parse(
+                    R"({"\u20ac": 5, "\r": 1, "\ufb33": 7, "1": 2,
+                        "\ud83d\ude00": 6, "\u0080": 3, "\u00f6": 4})")));
+
+  JSON_SHA256 empty;
+  EXPECT_EQ_INT(__LINE__,
+                std::string("e3b0c44298fc1c149afbf4c8996fb924"
+                            "27ae41e4649b934ca495991b7852b855"),
+                empty.hex_digest());
+  JSON_SHA256 abc;
+  abc("a", 1);
+  abc("bc", 2);
+  EXPECT_EQ_INT(__LINE__,
+                std::string("ba7816bf8f01cfea414140de5dae2223"
+                            "b00361a396177a9cb410ff61f20015ad"),
+                abc.hex_digest());
+  // the canonical form is hashed as it is written, in blocks
+  JSON_Data large = std::vector<JSON_Data>();
+  for (int i = 0; i < 2000; i++) large.get_array().push_back(i * 0.5);
+  large.get_array().push_back(std::string(5000, 'x'));
+  JSON_SHA256 streamed, whole;
+  JSON_canonicalize(large, streamed);
+  std::string text = JSON_canonical(large);
+  whole(text.data(), text.size());
+  EXPECT_EQ_INT(__LINE__, whole.hex_digest(), streamed.hex_digest());
+
+  bool thrown = false;
+  try {
+    JSON_canonical(JSON_Data(std::numeric_limits<double>::infinity()));
+  } catch (std::invalid_argument &) {
+    thrown = true;
+  }
+  EXPECT_EQ_INT(__LINE__, true, thrown);
+}
+
+void test_packed_array() {
+  JSON_Parse_Options options;
+  options.packed_numbers = true;
+  std::string text = "[[1.5, -2, 3e2], [1, \"x\"], [], {\"n\": [4, 5]}]";
+  JSON_Data packed = JSON_parse(text, options);
+  const JSON_Data plain = JSON_parse(text);
+  auto &numbers = packed.get_array()[0];
+  EXPECT_EQ_INT(__LINE__, true, numbers.is_packed());
+  EXPECT_EQ_INT(__LINE__, false, packed.get_array()[1].is_packed());
+  EXPECT_EQ_INT(__LINE__, false, packed.get_array()[2].is_packed());
+  EXPECT_EQ_INT(__LINE__, true, packed.get_array()[3]["n"].is_packed());
+  EXPECT_EQ_INT(__LINE__, plain.to_string(), packed.to_string());
+  EXPECT_EQ_INT(__LINE__, true, plain == packed);
+  EXPECT_EQ_INT(__LINE__, plain.hash(), packed.hash());
+
+  const JSON_Data &view = numbers;
+  auto values = view.get_packed().get<double>();
+  EXPECT_EQ_INT(__LINE__, std::size_t(3), values.size());
+  EXPECT_EQ_INT(__LINE__, 300.0, values[2]);
+  JSON_Data scratch;
+  EXPECT_EQ_INT(__LINE__, -2, view.element(1, scratch).get_int());
+  // there is no plain array for the const getter to give
+  bool no_array = false;
+  try {
+    view.get_array();
+  } catch (std::bad_variant_access &) {
+    no_array = true;
+  }
+  EXPECT_EQ_INT(__LINE__, true, no_array);
+  // a JSON Pointer to an element makes it in the scratch value
+  EXPECT_EQ_INT(__LINE__, 300.0,
+                packed.find_pointer("/0/2", scratch)->get_double());
+  EXPECT_EQ_INT(__LINE__, true,
+                packed.find_pointer("/0/3", scratch) == nullptr);
+  EXPECT_EQ_INT(__LINE__, true,
+                packed.find_pointer("/0/2/x", scratch) == nullptr);
+  no_array = false;
+  try {
+    packed.find_pointer("/0/2");
+  } catch (std::bad_variant_access &) {
+    no_array = true;
+  }
+  EXPECT_EQ_INT(__LINE__, true, no_array);
+  // a packed array is only a `JSON_Packed_Array` to `try_get`
+  EXPECT_EQ_INT(__LINE__, true,
+                view.try_get<std::vector<JSON_Data>>() == nullptr);
+  EXPECT_EQ_INT(__LINE__, true, view.try_get<JSON_Packed_Array>() != nullptr);
+  bool thrown = false;
+  try {
+    view.get_packed().get<std::int64_t>();
+  } catch (std::bad_variant_access &) {
+    thrown = true;
+  }
+  EXPECT_EQ_INT(__LINE__, true, thrown);
+
+  // copies share the packed array, a change turns only one of them plain
+  JSON_Data copy = numbers;
+  numbers.get_array().push_back(JSON_Data("y"));
+  EXPECT_EQ_INT(__LINE__, false, numbers.is_packed());
+  EXPECT_EQ_INT(__LINE__, true, copy.is_packed());
+  EXPECT_EQ_INT(__LINE__, std::string("[1.500000,-2.000000,300.000000,\"y\"]"),
+                numbers.to_string());
+  EXPECT_EQ_INT(__LINE__, std::string("[1.500000,-2.000000,300.000000]"),
+                copy.to_string());
+
+  // lazy numbers only pack integers, which are written back the same
+  options.lazy_numbers = true;
+  JSON_Data lazy =
+      JSON_parse("[[1, -20, 9223372036854775807], [1, 2.0], [-0]]", options);
+  EXPECT_EQ_INT(__LINE__, true, lazy.get_array()[0].is_packed());
+  EXPECT_EQ_INT(__LINE__, false, lazy.get_array()[1].is_packed());
+  EXPECT_EQ_INT(__LINE__, false, lazy.get_array()[2].is_packed());
+  EXPECT_EQ_INT(__LINE__, std::int64_t(9223372036854775807LL),
+                lazy.get_array()[0].get_packed().get<std::int64_t>()[2]);
+  EXPECT_EQ_INT(
+      __LINE__,
+      std::string("[[1,-20,9223372036854775807],[1,2.0],[-0]]"),
+      lazy.to_string());
+  EXPECT_EQ_INT(
+      __LINE__, true,
+      lazy == JSON_parse("[[1.0, -20, 9223372036854775807], [1, 2], [0]]",
+                         options));
+
+  // built by hand, it is the same as a plain array of the numbers
+  JSON_Data built(JSON_Packed_Array(std::vector<std::int64_t>{1, 2, 3}));
+  EXPECT_EQ_INT(__LINE__, 3 * sizeof(std::int64_t),
+                built.memory_usage().nodes);
+  EXPECT_EQ_INT(__LINE__, true, built == JSON_Data({1, 2, 3}));
+  EXPECT_EQ_INT(__LINE__, std::string("[1,2,3]"), built.to_string());
+  EXPECT_EQ_INT(__LINE__, true, built.clone().is_packed());
+
+  // reading it const doesn't build the plain array
+  const JSON_Data &series = built;
+  const JSON_Data other_plain({1, 2, 4});
+  EXPECT_EQ_INT(__LINE__, false, series == other_plain);
+  EXPECT_EQ_INT(__LINE__, false, other_plain == series);
+  EXPECT_EQ_INT(__LINE__, std::string("[{\"op\":\"replace\",\"path\":\"/2\","
+                                      "\"value\":4}]"),
+                JSON_diff(series, other_plain).to_string());
+  EXPECT_EQ_INT(__LINE__, std::string("[]"),
+                JSON_diff(other_plain, JSON_Data({1, 2, 4})).to_string());
+  EXPECT_EQ_INT(__LINE__, std::string("[1,2,3]"), JSON_canonical(series));
+  JSON_Schema schema(JSON_parse(
+      "{\"type\": \"array\", \"items\": {\"enum\": [1, 2, 3]}}", options));
+  EXPECT_EQ_INT(__LINE__, true, schema.validate(series));
+  EXPECT_EQ_INT(__LINE__, false, schema.validate(other_plain));
+  for (std::size_t i = 0; i < series.array_size(); i++) {
+    JSON_Data scratch;
+    EXPECT_EQ_INT(__LINE__, static_cast<int>(i + 1),
+                  series.element(i, scratch).get_int());
+  }
+  EXPECT_EQ_INT(__LINE__, 3 * sizeof(std::int64_t),
+                series.memory_usage().nodes);
+}
+
+void test_parallel_dump() {
+  // a large array of objects inside a small object, a large object and a
+  // large packed array
+  JSON_Data document;
+  std::vector<JSON_Data> items;
+  JSON_Object index;
+  for (int i = 0; i < 1000; i++) {
+    JSON_Data item;
+    item["id"] = i;
+    item["name"] = "n\xc3\xa9" + std::to_string(i);
+    item["tags"] = {1, "a", nullptr};
+    items.push_back(item);
+    index.add("k" + std::to_string(i), JSON_Data(i * 0.5));
+  }
+  document["items"] = items;
+  document["index"] = index;
+  document["empty"] = std::vector<JSON_Data>();
+  JSON_Parse_Options packed;
+  packed.packed_numbers = true;
+  document["series"] = JSON_parse("[[1.5, 2, 3, 4, 5, 6, 7, 8]]", packed);
+
+  JSON_Dump_Options options;
+  options.threads = 4;
+  options.min_size = 8;
+  EXPECT_EQ_INT(__LINE__, document.to_string(),
+                JSON_dump_parallel(document, options));
+  options.escape_unicode = true;
+  EXPECT_EQ_INT(__LINE__, document.to_string(true),
+                JSON_dump_parallel(document, options));
+  options.escape_unicode = false;
+  // below the size nothing is split
+  options.min_size = 2000;
+  JSON_Parallel_Output output;
+  JSON_dump_parallel(document, output, options);
+  EXPECT_EQ_INT(__LINE__, std::size_t(1), output.piece_count());
+  EXPECT_EQ_INT(__LINE__, document.to_string(), output.to_string());
+  options.min_size = 8;
+  options.threads = 1;
+  JSON_dump_parallel(document, output, options);
+  EXPECT_EQ_INT(__LINE__, std::size_t(1), output.piece_count());
+  options.threads = 3;
+  JSON_dump_parallel(document, output, options);
+  EXPECT_EQ_INT(__LINE__, true, output.piece_count() > 3);
+  EXPECT_EQ_INT(__LINE__, document.to_string().size(), output.size());
+  std::string appended = "x";
+  JSON_dump_parallel(JSON_Data(std::vector<JSON_Data>()), appended, options);
+  EXPECT_EQ_INT(__LINE__, std::string("x[]"), appended);
+#ifdef S2UJSON_HAS_WRITEV
+  std::FILE *file = std::tmpfile();
+  EXPECT_EQ_INT(__LINE__, output.size(), JSON_writev(fileno(file), output));
+  std::rewind(file);
+  std::string written(output.size(), '\0');
+  std::fread(&written[0], 1, written.size(), file);
+  std::fclose(file);
+  EXPECT_EQ_INT(__LINE__, document.to_string(), written);
+#endif
+}
+
 int main(int argc, char const *argv[]) {
   test_parse_null();
   test_parse_false();
@@ -598,7 +2065,35 @@ int main(int argc, char const *argv[]) {
   test_parse_array();
   test_parse_object();
   test_API();
+  test_validate();
+  test_to_string();
+  test_reformat();
+  test_patch();
+  test_hash_and_diff();
+  test_const_access();
+  test_lazy_numbers();
+#ifdef S2UJSON_STATS
+  test_stats();
+#endif
+  test_memory_usage();
+  test_parse_depth();
+  test_tokenizer();
+  test_parser();
+  test_gather_dump();
+  test_array_reader();
+  test_schema();
+  test_shred();
+  test_static_json();
+  test_key_set();
+  test_try_get();
+  test_insitu();
+#if defined(S2UJSON_STATS) && defined(S2UJSON_CACHED_DUMP)
+  test_cached_dump();
+#endif
+  test_canonical();
+  test_packed_array();
+  test_parallel_dump();
   std::cout << "test count:" << test_count << ",test_pass:" << test_pass
             << std::endl;
-  return 0;
+  return test_pass == test_count ? 0 : 1;
 }